@@ -3,10 +3,12 @@ package main
 import (
 	"encoding/json"
 	"fmt"
+	"io"
 	"log"
 	"net/http"
 	"os"
 	"os/signal"
+	"sync"
 	"syscall"
 
 	"github.com/ketsuna-org/bot-creator-api/internal"
@@ -40,6 +42,14 @@ func main() {
 			ProcessID: fmt.Sprint(len(botList) + 5555), // or any unique identifier
 		}
 
+		// An optional body sets the cluster options: intents, cache policy and shards.
+		options, err := readClusterOptions(r)
+		if err != nil {
+			http.Error(w, "Invalid JSON", http.StatusBadRequest)
+			return
+		}
+		bot.ClusterOptions = options
+
 		// Let's check if this discord bot exists
 		if _, ok := botList[botToken]; ok {
 			log.Printf("[SERVER] Bot already running: %s", botToken)
@@ -103,6 +113,34 @@ func main() {
 		w.Write([]byte("Bot stopped successfully"))
 	})
 
+	// Route POST /configure/{bot_token}
+	// Rebuilds the bot with new cluster options; its commands are kept.
+	mux.HandleFunc("POST /configure/{bot_token}", func(w http.ResponseWriter, r *http.Request) {
+		botToken := r.PathValue("bot_token")
+		bot, ok := botList[botToken]
+		if !ok {
+			http.Error(w, "Bot not found", http.StatusNotFound)
+			return
+		}
+		options, err := readClusterOptions(r)
+		if err != nil {
+			http.Error(w, "Invalid JSON", http.StatusBadRequest)
+			return
+		}
+		if err := bot.Reconfigure(options); err != nil {
+			log.Printf("[SERVER] Error reconfiguring bot: %v", err)
+			if !bot.Running() {
+				// Neither the new options nor the previous ones brought it back: forget it, so it can be created again.
+				delete(botList, botToken)
+			}
+			http.Error(w, "Error reconfiguring bot", http.StatusInternalServerError)
+			return
+		}
+		log.Printf("[SERVER] Bot reconfigured successfully")
+		w.WriteHeader(http.StatusOK)
+		w.Write([]byte("Bot reconfigured successfully"))
+	})
+
 	// Route POST /update/{bot_token}
 	mux.HandleFunc("POST /update/{bot_token}", func(w http.ResponseWriter, r *http.Request) {
 		// Extraire le token du bot de l'URL
@@ -112,18 +150,13 @@ func main() {
 			http.Error(w, "Bot not found", http.StatusNotFound)
 			return
 		}
-		body := make(map[string]interface{})
-		if err := json.NewDecoder(r.Body).Decode(&body); err != nil {
+		// The body is forwarded as is: the bot parses it, there is no need to decode and re-encode it here.
+		data, err := io.ReadAll(r.Body)
+		if err != nil || !json.Valid(data) {
 			log.Printf("[SERVER] Error decoding JSON: %v", err)
 			http.Error(w, "Invalid JSON", http.StatusBadRequest)
 			return
 		}
-		data, err := json.Marshal(body)
-		if err != nil {
-			log.Printf("[SERVER] Error marshaling JSON: %v", err)
-			http.Error(w, "Error marshaling JSON", http.StatusInternalServerError)
-			return
-		}
 		if err := bot.SendMessage(string(data)); err != nil {
 			log.Printf("[SERVER] Error sending message: %v", err)
 			http.Error(w, "Error sending message", http.StatusInternalServerError)
@@ -134,6 +167,46 @@ func main() {
 		w.Write([]byte("Bot updated successfully"))
 	})
 
+	// Route PATCH /update/{bot_token}
+	// The body is an RFC 7396 merge-patch of the command map: only the commands it names are
+	// sent to the bot and recompiled, `null` removes a command. The patch itself must be an object.
+	mux.HandleFunc("PATCH /update/{bot_token}", func(w http.ResponseWriter, r *http.Request) {
+		botToken := r.PathValue("bot_token")
+		bot, ok := botList[botToken]
+		if !ok {
+			http.Error(w, "Bot not found", http.StatusNotFound)
+			return
+		}
+		patch, err := io.ReadAll(r.Body)
+		if err != nil || !json.Valid(patch) {
+			log.Printf("[SERVER] Error decoding JSON patch: %v", err)
+			http.Error(w, "Invalid JSON", http.StatusBadRequest)
+			return
+		}
+		// The bot rejects anything but an object; a whole new map is an update.
+		var commands map[string]json.RawMessage
+		if err := json.Unmarshal(patch, &commands); err != nil || commands == nil {
+			http.Error(w, "The patch must be an object of command names", http.StatusBadRequest)
+			return
+		}
+		message, err := json.Marshal(struct {
+			Command string          `json:"command"`
+			Data    json.RawMessage `json:"data"`
+		}{"patch", patch})
+		if err != nil {
+			http.Error(w, "Invalid JSON", http.StatusBadRequest)
+			return
+		}
+		if err := bot.SendMessage(string(message)); err != nil {
+			log.Printf("[SERVER] Error sending message: %v", err)
+			http.Error(w, "Error sending message", http.StatusInternalServerError)
+			return
+		}
+		log.Printf("[SERVER] Bot patched successfully")
+		w.WriteHeader(http.StatusOK)
+		w.Write([]byte("Bot patched successfully"))
+	})
+
 	// Gestion des signaux pour l'arrêt propre
 	signals := make(chan os.Signal, 1)
 	signal.Notify(signals, os.Interrupt)
@@ -141,12 +214,23 @@ func main() {
 	go func() {
 		sig := <-signals
 		log.Printf("Received signal: %s", sig)
-		// Arrêter tous les bots en cours
+		// Arrêter tous les bots en cours, en parallèle : chacun attend la fin de ses interactions
+		var stopping sync.WaitGroup
 		for _, bot := range botList {
-			if err := bot.Stop(); err != nil {
-				log.Printf("[SERVER] Error stopping bot: %v", err)
-			}
-			delete(botList, bot.BotToken)
+			stopping.Add(1)
+			go func(bot *internal.Bot) {
+				defer stopping.Done()
+				if err := bot.Stop(); err != nil {
+					log.Printf("[SERVER] Error stopping bot: %v", err)
+				}
+			}(bot)
+		}
+		stopping.Wait()
+		for token := range botList {
+			delete(botList, token)
+		}
+		if internal.HostMode {
+			internal.StopHost()
 		}
 		// Quitter l'application
 		os.Exit(0)
@@ -156,3 +240,19 @@ func main() {
 	log.Printf("[SERVER] Starting server on :2030")
 	log.Fatal(http.ListenAndServe(":2030", mux))
 }
+
+// readClusterOptions returns the request body as cluster options, or nil when the body is empty.
+// The options are validated by the bot itself.
+func readClusterOptions(r *http.Request) (json.RawMessage, error) {
+	data, err := io.ReadAll(r.Body)
+	if err != nil {
+		return nil, err
+	}
+	if len(data) == 0 {
+		return nil, nil
+	}
+	if !json.Valid(data) {
+		return nil, fmt.Errorf("invalid JSON")
+	}
+	return json.RawMessage(data), nil
+}
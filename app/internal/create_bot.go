@@ -1,29 +1,75 @@
 package internal
 
 import (
+	"encoding/json"
 	"fmt"
+	"io"
 	"log"
 	"net/http"
 	"os"
 	"os/exec"
+	"strconv"
 	"strings"
 	"syscall"
+	"time"
 )
 
+// Keep one persistent connection per bot instead of a TCP handshake per push. The idle
+// timeout stays below the bot's own (60s) so we never reuse a connection it just closed.
+var botTransport = &http.Transport{
+	MaxIdleConnsPerHost: 2,
+	IdleConnTimeout:     30 * time.Second,
+}
+
 type Bot struct {
 	BotToken  string    `json:"bot_token"`
 	Cmd       *exec.Cmd // Ajouter une référence à la commande
 	ProcessID string
-	client    *http.Client
+	// Intents, cache policy and shard layout of the bot's cluster; empty keeps the bot's defaults.
+	ClusterOptions json.RawMessage
+	client         *http.Client
+}
+
+// startMessage is the host command that creates this bot with its cluster options.
+func (b *Bot) startMessage(command string) (string, error) {
+	message, err := json.Marshal(struct {
+		Command string          `json:"command"`
+		Cluster json.RawMessage `json:"cluster,omitempty"`
+	}{command, b.ClusterOptions})
+	return string(message), err
 }
 
 func Start(b *Bot) (*Bot, error) {
+	client := http.Client{Transport: botTransport}
+	b.client = &client
+
+	if HostMode {
+		cmd, err := ensureHost()
+		if err != nil {
+			return nil, err
+		}
+		message, err := b.startMessage("start")
+		if err != nil {
+			return nil, fmt.Errorf("failed to start bot: %w", err)
+		}
+		if err := postToHost(b.client, b.BotToken, message); err != nil {
+			return nil, fmt.Errorf("failed to start bot: %w", err)
+		}
+		b.Cmd = cmd
+		b.ProcessID = hostPort
+		log.Printf("[SERVER] Bot %s started successfully in host %d", b.BotToken, cmd.Process.Pid)
+		return b, nil
+	}
+
 	// Create a new ZeroMQ socket specifically for this bot
 	// Configuration du bot
 	cmd := exec.Command("./discord-bot", b.BotToken, b.ProcessID) // Passer le port unique
 	cmd.SysProcAttr = &syscall.SysProcAttr{
 		Setpgid: true, // Permet de tuer le processus enfant si nécessaire
 	}
+	if len(b.ClusterOptions) > 0 {
+		cmd.Env = append(os.Environ(), "BOT_CLUSTER_OPTIONS="+string(b.ClusterOptions))
+	}
 
 	// Redirection des sorties pour le débogage
 	cmd.Stdout = os.Stdout
@@ -34,23 +80,93 @@ func Start(b *Bot) (*Bot, error) {
 	}
 	b.Cmd = cmd
 
-	client := http.Client{}
-	// Send data to the bot
-	b.client = &client
 	log.Printf("[SERVER] Bot %s started successfully with PID %d", b.BotToken, cmd.Process.Pid)
 	return b, nil
 }
 
 func (b *Bot) Stop() error {
+	if HostMode {
+		if err := postToHost(b.client, b.BotToken, `{"command": "stop"}`); err != nil {
+			return fmt.Errorf("[SERVER] failed to stop bot: %w", err)
+		}
+		log.Printf("[SERVER] Bot %s stopped successfully", b.BotToken)
+		return nil
+	}
 	if b.Cmd != nil && b.Cmd.Process.Pid != 0 {
 		if err := syscall.Kill(-b.Cmd.Process.Pid, syscall.SIGTERM); err != nil {
 			return fmt.Errorf("[SERVER] failed to stop bot: %w", err)
 		}
+		// The bot lets its running interactions finish and disconnects before it exits.
+		exited := make(chan struct{})
+		go func() {
+			b.Cmd.Wait()
+			close(exited)
+		}()
+		select {
+		case <-exited:
+		case <-time.After(stopTimeout()):
+			log.Printf("[SERVER] Bot %s did not exit in time, killing it", b.BotToken)
+			syscall.Kill(-b.Cmd.Process.Pid, syscall.SIGKILL)
+			<-exited
+		}
 		log.Printf("[SERVER] Bot %s stopped successfully", b.BotToken)
 	}
 	return nil
 }
 
+// stopTimeout is how long a bot process gets to exit after SIGTERM: its BOT_SHUTDOWN_GRACE, which
+// it inherits from us, plus time to disconnect from the gateway.
+func stopTimeout() time.Duration {
+	grace := 10 * time.Second
+	if seconds, err := strconv.ParseFloat(os.Getenv("BOT_SHUTDOWN_GRACE"), 64); err == nil && seconds >= 0 && seconds <= 3600 {
+		grace = time.Duration(seconds * float64(time.Second))
+	}
+	return grace + 15*time.Second
+}
+
+// Reconfigure rebuilds the bot's cluster with new options. The bot reloads its commands from its
+// config snapshot, so the control plane does not need to push them again. On failure the bot keeps
+// its previous options; check Running to know whether it is still up.
+func (b *Bot) Reconfigure(options json.RawMessage) error {
+	previous := b.ClusterOptions
+	b.ClusterOptions = options
+	if HostMode {
+		// The host starts the new cluster before dropping the old one, so a failed restart leaves the bot as it was.
+		message, err := b.startMessage("restart")
+		if err == nil {
+			err = postToHost(b.client, b.BotToken, message)
+		}
+		if err != nil {
+			b.ClusterOptions = previous
+			return fmt.Errorf("[SERVER] failed to reconfigure bot: %w", err)
+		}
+		log.Printf("[SERVER] Bot %s reconfigured successfully", b.BotToken)
+		return nil
+	}
+	// A process reads its options at launch: replace it; Stop waits for the old one to free the port.
+	if err := b.Stop(); err != nil {
+		b.ClusterOptions = previous
+		return err
+	}
+	if _, err := Start(b); err != nil {
+		// Bring the bot back as it was rather than leave it down.
+		b.ClusterOptions = previous
+		if _, restartErr := Start(b); restartErr != nil {
+			log.Printf("[SERVER] Bot %s could not be restarted with its previous options: %v", b.BotToken, restartErr)
+		}
+		return fmt.Errorf("[SERVER] failed to reconfigure bot: %w", err)
+	}
+	return nil
+}
+
+// Running reports whether the bot's process is still alive.
+func (b *Bot) Running() bool {
+	if b.Cmd == nil || b.Cmd.Process == nil || b.Cmd.ProcessState != nil {
+		return false
+	}
+	return b.Cmd.Process.Signal(syscall.Signal(0)) == nil
+}
+
 func (b *Bot) SendMessage(message string) error {
 	// Check if the bot process is still running
 	if err := b.Cmd.Process.Signal(syscall.Signal(0)); err != nil {
@@ -62,12 +178,18 @@ func (b *Bot) SendMessage(message string) error {
 		return fmt.Errorf("[SERVER] message is empty")
 	}
 
-	// Send the message
-	resp, err := b.client.Post("http://localhost:"+b.ProcessID, "application/json", strings.NewReader(message))
+	// Send the message; in host mode the token in the path selects the bot
+	url := "http://localhost:" + b.ProcessID
+	if HostMode {
+		url += "/bots/" + b.BotToken
+	}
+	resp, err := b.client.Post(url, "application/json", strings.NewReader(message))
 	if err != nil {
 		return fmt.Errorf("[SERVER] failed to send message: %w", err)
 	}
 	defer resp.Body.Close()
+	// The body must be drained for the connection to go back to the idle pool.
+	io.Copy(io.Discard, resp.Body)
 	if resp.StatusCode != http.StatusOK {
 		return fmt.Errorf("[SERVER] failed to send message: %s", resp.Status)
 	}
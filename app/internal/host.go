@@ -0,0 +1,91 @@
+package internal
+
+import (
+	"fmt"
+	"io"
+	"log"
+	"net/http"
+	"os"
+	"os/exec"
+	"strings"
+	"sync"
+	"syscall"
+	"time"
+)
+
+// HostMode runs every bot inside one shared `discord-bot --host <port>` process instead of
+// one process per bot. Enable it with BOT_HOST_MODE=1; BOT_HOST_PORT picks the control port.
+var HostMode = os.Getenv("BOT_HOST_MODE") != ""
+
+var (
+	hostMu   sync.Mutex
+	hostCmd  *exec.Cmd
+	hostPort = hostPortFromEnv()
+)
+
+func hostPortFromEnv() string {
+	if port := os.Getenv("BOT_HOST_PORT"); port != "" {
+		return port
+	}
+	return "5554"
+}
+
+// ensureHost starts the shared bot host once and waits for its control port to answer.
+func ensureHost() (*exec.Cmd, error) {
+	hostMu.Lock()
+	defer hostMu.Unlock()
+
+	if hostCmd != nil && hostCmd.Process.Signal(syscall.Signal(0)) == nil {
+		return hostCmd, nil
+	}
+
+	cmd := exec.Command("./discord-bot", "--host", hostPort)
+	cmd.SysProcAttr = &syscall.SysProcAttr{
+		Setpgid: true,
+	}
+	cmd.Stdout = os.Stdout
+	cmd.Stderr = os.Stderr
+	if err := cmd.Start(); err != nil {
+		return nil, fmt.Errorf("failed to start bot host: %w", err)
+	}
+	go cmd.Wait()
+
+	client := http.Client{Transport: botTransport, Timeout: time.Second}
+	for i := 0; i < 50; i++ {
+		resp, err := client.Get("http://localhost:" + hostPort + "/bots")
+		if err == nil {
+			io.Copy(io.Discard, resp.Body)
+			resp.Body.Close()
+			hostCmd = cmd
+			log.Printf("[SERVER] Bot host started with PID %d on port %s", cmd.Process.Pid, hostPort)
+			return cmd, nil
+		}
+		time.Sleep(100 * time.Millisecond)
+	}
+	syscall.Kill(-cmd.Process.Pid, syscall.SIGTERM)
+	return nil, fmt.Errorf("bot host did not open port %s", hostPort)
+}
+
+// StopHost terminates the shared bot host, if one is running.
+func StopHost() {
+	hostMu.Lock()
+	defer hostMu.Unlock()
+	if hostCmd != nil {
+		syscall.Kill(-hostCmd.Process.Pid, syscall.SIGTERM)
+		hostCmd = nil
+	}
+}
+
+// postToHost sends a control command for one bot to the shared host.
+func postToHost(client *http.Client, token string, message string) error {
+	resp, err := client.Post("http://localhost:"+hostPort+"/bots/"+token, "application/json", strings.NewReader(message))
+	if err != nil {
+		return err
+	}
+	defer resp.Body.Close()
+	io.Copy(io.Discard, resp.Body)
+	if resp.StatusCode != http.StatusOK {
+		return fmt.Errorf("bot host answered %s", resp.Status)
+	}
+	return nil
+}
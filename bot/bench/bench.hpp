@@ -0,0 +1,56 @@
+// bench.hpp
+// A small self-registering micro-benchmark harness for bot-bench.
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    /**
+     * @brief One timed operation; returns a size that is folded into a sink so the work isn't optimized away
+     */
+    using operation = std::function<size_t()>;
+
+    /**
+     * @brief Builds the fixture once and returns the operation to time
+     *
+     * Anything the setup throws is reported as a failed benchmark.
+     */
+    using setup = std::function<operation()>;
+
+    struct result
+    {
+        std::string name;
+        size_t iterations = 0;       // Per sample
+        size_t samples = 0;
+        double ns_per_op = 0;        // Median over the samples
+        double min_ns_per_op = 0;
+        double max_ns_per_op = 0;
+        double size_per_op = 0;      // Average size returned by the operation (bytes, keys, requests...)
+        std::string error;
+    };
+
+    /**
+     * @brief Adds a benchmark to the global registry; used through static registrar objects
+     */
+    struct registrar
+    {
+        registrar(std::string name, setup fixture);
+    };
+
+    struct options
+    {
+        std::string filter;          // Substring of the benchmark name; empty runs everything
+        size_t samples = 5;
+        double min_sample_ms = 100;  // Iterations per sample are calibrated to take at least this long
+        bool json = false;
+    };
+
+    /**
+     * @brief Runs every registered benchmark matching the options, in name order
+     */
+    std::vector<result> run_all(const options &opts);
+}
@@ -0,0 +1,99 @@
+// bench_autocomplete.cpp
+// Times app::choice_index lookups on a large choice list against the linear scan they replace.
+#include <cctype>
+#include <string>
+#include <vector>
+#include "bench.hpp"
+#include "../include/choice_index.hpp"
+
+namespace
+{
+    constexpr size_t choice_count = 10000;
+
+    // Names spread over the alphabet like real lists (cities, items, tags): mixed case, shared prefixes.
+    nlohmann::json choices_json()
+    {
+        static const char *const stems[] = {"San", "Saint", "Port", "New", "North", "Lake", "Mount", "Fort", "East", "West"};
+        nlohmann::json choices = nlohmann::json::array();
+        uint32_t state = 2463534242u;
+        for (size_t i = 0; i < choice_count; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            std::string name = stems[state % std::size(stems)];
+            name += ' ';
+            name += static_cast<char>('A' + (state >> 8) % 26);
+            for (int j = 0; j < 6; ++j)
+            {
+                name += static_cast<char>('a' + (state >> (j * 4)) % 26);
+            }
+            choices.push_back({{"name", name}, {"value", "id-" + std::to_string(i)}});
+        }
+        return choices;
+    }
+
+    // What answering would cost without an index: fold and compare every name on every keystroke.
+    size_t scan(const std::vector<std::string> &names, const std::string &typed)
+    {
+        size_t found = 0;
+        for (const std::string &name : names)
+        {
+            if (name.size() < typed.size())
+            {
+                continue;
+            }
+            size_t i = 0;
+            while (i < typed.size() && std::tolower(static_cast<unsigned char>(name[i])) == std::tolower(static_cast<unsigned char>(typed[i])))
+            {
+                ++i;
+            }
+            if (i == typed.size() && ++found == app::choice_index::max_choices)
+            {
+                break;
+            }
+        }
+        return found;
+    }
+
+    std::vector<std::string> names_of(const nlohmann::json &choices)
+    {
+        std::vector<std::string> names;
+        for (const auto &choice : choices)
+        {
+            names.push_back(choice["name"].get<std::string>());
+        }
+        return names;
+    }
+
+    // Typed the way users do, in lower case: the first 8 characters of a name from the middle of the list.
+    std::string typed_prefix()
+    {
+        std::string prefix = choices_json()[choice_count / 2]["name"].get<std::string>().substr(0, 8);
+        for (char &c : prefix)
+        {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return prefix;
+    }
+
+    const bench::registrar compile("autocomplete/compile/10k", []
+                                   {
+        return [choices = choices_json()]
+        { return app::choice_index::from_json(choices).size(); }; });
+
+    const bench::registrar complete_short("autocomplete/complete/10k/1_char", []
+                                          {
+        return [index = app::choice_index::from_json(choices_json())]
+        { return index.complete("s").size(); }; });
+
+    const bench::registrar complete_long("autocomplete/complete/10k/8_chars", []
+                                         {
+        return [index = app::choice_index::from_json(choices_json()), typed = typed_prefix()]
+        { return index.complete(typed).size(); }; });
+
+    const bench::registrar scan_long("autocomplete/linear_scan/10k/8_chars", []
+                                     {
+        return [names = names_of(choices_json()), typed = typed_prefix()]
+        { return scan(names, typed); }; });
+}
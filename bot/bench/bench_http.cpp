@@ -0,0 +1,133 @@
+// bench_http.cpp
+// Times the webhook server's request parser and response serializer on control-plane traffic.
+#include <stdexcept>
+#include <string>
+#include "bench.hpp"
+#include "../include/http_request_parser.hpp"
+#include "../include/http_webhook_server.hpp"
+
+namespace
+{
+    // What the Go control plane sends for a command update: a large JSON body, a handful of headers.
+    std::string update_body()
+    {
+        std::string body = "{\"command\":\"update\",\"data\":{";
+        for (int i = 0; i < 200; ++i)
+        {
+            if (i)
+            {
+                body += ',';
+            }
+            body += "\"cmd" + std::to_string(i) + "\":{\"response\":\"Hello ((userName)), this is command " + std::to_string(i) + "\"}";
+        }
+        body += "}}";
+        return body;
+    }
+
+    std::string post_request(const std::string &body)
+    {
+        return "POST / HTTP/1.1\r\n"
+               "Host: localhost:5555\r\n"
+               "User-Agent: Go-http-client/1.1\r\n"
+               "Content-Type: application/json\r\n"
+               "Accept-Encoding: gzip\r\n"
+               "Content-Length: " +
+               std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    std::string chunked_request(const std::string &body, size_t chunk)
+    {
+        std::string request = "POST / HTTP/1.1\r\n"
+                              "Host: localhost:5555\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Transfer-Encoding: chunked\r\n\r\n";
+        char size_line[32];
+        for (size_t pos = 0; pos < body.size(); pos += chunk)
+        {
+            size_t length = std::min(chunk, body.size() - pos);
+            snprintf(size_line, sizeof(size_line), "%zx\r\n", length);
+            request += size_line;
+            request.append(body, pos, length);
+            request += "\r\n";
+        }
+        request += "0\r\n\r\n";
+        return request;
+    }
+
+    size_t parse_once(HttpRequestParser &parser, std::string &buffer)
+    {
+        parser.reset();
+        if (parser.parse(buffer.data(), buffer.size()) != HttpRequestParser::Status::Complete)
+        {
+            throw std::runtime_error("fixture did not parse as one complete request");
+        }
+        return parser.request().body.size();
+    }
+
+    const bench::registrar parse_small("http/parse/status_request", []
+                                       {
+        auto parser = std::make_shared<HttpRequestParser>();
+        auto buffer = std::make_shared<std::string>(post_request("{\"command\":\"update_status\",\"status\":\"online\",\"activity\":\"Watching you\"}"));
+        parse_once(*parser, *buffer);
+        return [parser, buffer]
+        { return parse_once(*parser, *buffer); }; });
+
+    const bench::registrar parse_large("http/parse/update_200_commands", []
+                                       {
+        auto parser = std::make_shared<HttpRequestParser>();
+        auto buffer = std::make_shared<std::string>(post_request(update_body()));
+        parse_once(*parser, *buffer);
+        return [parser, buffer]
+        { return parse_once(*parser, *buffer); }; });
+
+    // Chunked bodies are decoded in place, so every iteration starts from a fresh copy of the wire bytes.
+    const bench::registrar parse_chunked("http/parse/update_chunked_4k", []
+                                         {
+        auto parser = std::make_shared<HttpRequestParser>();
+        auto wire = std::make_shared<const std::string>(chunked_request(update_body(), 4096));
+        auto buffer = std::make_shared<std::string>(*wire);
+        parse_once(*parser, *buffer);
+        return [parser, wire, buffer]
+        {
+            buffer->assign(*wire);
+            return parse_once(*parser, *buffer);
+        }; });
+
+    // Ten keep-alive requests arriving in one read, parsed back to back as the server loop does.
+    const bench::registrar parse_pipelined("http/parse/pipelined_10", []
+                                           {
+        auto parser = std::make_shared<HttpRequestParser>();
+        auto buffer = std::make_shared<std::string>();
+        for (int i = 0; i < 10; ++i)
+        {
+            *buffer += post_request("{\"command\":\"update_status\",\"status\":\"idle\"}");
+        }
+        return [parser, buffer]
+        {
+            size_t offset = 0;
+            size_t requests = 0;
+            while (offset < buffer->size())
+            {
+                parser->reset();
+                if (parser->parse(buffer->data() + offset, buffer->size() - offset) != HttpRequestParser::Status::Complete)
+                {
+                    break;
+                }
+                offset += parser->consumed();
+                ++requests;
+            }
+            return requests;
+        }; });
+
+    const bench::registrar build_response("http/build_response/ok", []
+                                          {
+        HttpWebhookServer::HttpResponse response;
+        response.headers["Content-Type"] = "application/json";
+        response.body = "{\"status\":\"ok\",\"message\":\"Commands updated\"}";
+        return [response, output = std::string()]() mutable
+        {
+            output.clear();
+            HttpWebhookServer::buildHttpResponse(response, output);
+            return output.size();
+        }; });
+}
@@ -0,0 +1,48 @@
+// bench_json.cpp
+// Times loading a large command configuration: parsing it and building the command table.
+#include <string>
+#include "bench.hpp"
+#include "json_fixtures.hpp"
+
+namespace
+{
+    using bench::command_map;
+    using bench::update_dom;
+    using bench::update_stream;
+
+    const bench::registrar parse_config("json/parse/500_commands", []
+                                        {
+        return [raw = command_map(500)]
+        { return app::json_from_string(raw).size(); }; });
+
+    // The baseline json_from_string falls back to.
+    const bench::registrar parse_config_nlohmann("json/parse_nlohmann/500_commands", []
+                                                 {
+        return [raw = command_map(500)]
+        { return nlohmann::json::parse(raw).size(); }; });
+
+    // An `update` of a large bot (~1.5 MB), end to end, against the reader streaming it.
+    const bench::registrar update_dom_time("json/update_dom/5000_commands", []
+                                           {
+        return [raw = command_map(5000)]
+        { return update_dom(raw); }; });
+
+    const bench::registrar update_stream_time("json/update_stream/5000_commands", []
+                                              {
+        return [raw = command_map(5000)]
+        { return update_stream(raw); }; });
+
+    const bench::registrar build_table("json/command_table_build/500_commands", []
+                                       {
+        return [config = app::json_from_string(command_map(500))["data"]]
+        { return app::command_table::build(config)->size(); }; });
+
+    const bench::registrar find_command("json/command_table_find/500_commands", []
+                                        {
+        auto table = app::command_table::build(app::json_from_string(command_map(500))["data"]);
+        return [table, i = size_t(0)]() mutable
+        {
+            i = (i + 7) % 500;
+            return table->find("command" + std::to_string(i)) ? size_t(1) : size_t(0);
+        }; });
+}
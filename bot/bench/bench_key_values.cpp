@@ -0,0 +1,123 @@
+// bench_key_values.cpp
+// Times app::generate_key_values on a synthetic slash command carrying every option type.
+#include <memory>
+#include <string>
+#include "bench.hpp"
+#include "../include/utils.hpp"
+#include "../include/response_template.hpp"
+
+namespace
+{
+    constexpr uint64_t guild_id = 825407338755653642;
+    constexpr uint64_t channel_id = 825411707521728511;
+
+    nlohmann::json user_json(const std::string &id, const std::string &name, bool bot = false)
+    {
+        return {{"id", id}, {"username", name}, {"discriminator", "0"}, {"global_name", name}, {"avatar", "a_1269e74af4df7417b13759eae50c83dc"}, {"bot", bot}};
+    }
+
+    // The interaction payload Discord sends for `/ticket open` with one option of each type.
+    std::string slashcommand_payload()
+    {
+        nlohmann::json invoker = user_json("53908232506183680", "ketsuna");
+        nlohmann::json target = user_json("80351110224678912", "nelly");
+        nlohmann::json options = nlohmann::json::array({
+            {{"name", "reason"}, {"type", 3}, {"value", "Spam in the general channel, several links"}},
+            {{"name", "amount"}, {"type", 4}, {"value", 42}},
+            {{"name", "urgent"}, {"type", 5}, {"value", true}},
+            {{"name", "weight"}, {"type", 10}, {"value", 0.75}},
+            {{"name", "target"}, {"type", 6}, {"value", "80351110224678912"}},
+            {{"name", "where"}, {"type", 7}, {"value", "41771983423143937"}},
+            {{"name", "notify"}, {"type", 8}, {"value", "41771983423143936"}},
+            {{"name", "who"}, {"type", 9}, {"value", "80351110224678912"}},
+            {{"name", "proof"}, {"type", 11}, {"value", "1065723211349340230"}},
+        });
+        nlohmann::json payload = {
+            {"id", "1065723211349340231"},
+            {"application_id", "775799577604522054"},
+            {"type", 2},
+            {"token", std::string(180, 'x')},
+            {"version", 1},
+            {"guild_id", std::to_string(guild_id)},
+            {"channel_id", std::to_string(channel_id)},
+            {"app_permissions", "562949953421311"},
+            {"locale", "en-US"},
+            {"guild_locale", "en-US"},
+            {"member", {{"user", invoker}, {"roles", {"41771983423143936"}}, {"joined_at", "2021-03-26T15:04:05.000000+00:00"}, {"nick", nullptr}, {"permissions", "562949953421311"}}},
+            {"data", {
+                {"id", "1065700000000000000"},
+                {"name", "ticket"},
+                {"type", 1},
+                {"options", {{{"name", "open"}, {"type", 1}, {"options", options}}}},
+                {"resolved", {
+                    {"users", {{"80351110224678912", target}}},
+                    {"members", {{"80351110224678912", {{"roles", nlohmann::json::array()}, {"joined_at", "2022-01-01T00:00:00.000000+00:00"}, {"nick", "Nelly"}, {"permissions", "104320577"}}}}},
+                    {"channels", {{"41771983423143937", {{"id", "41771983423143937"}, {"name", "moderation-log"}, {"type", 0}, {"permissions", "104320577"}}}}},
+                    {"roles", {{"41771983423143936", {{"id", "41771983423143936"}, {"name", "Moderators"}, {"color", 3447003}, {"hoist", true}, {"position", 3}, {"permissions", "104320577"}, {"managed", false}, {"mentionable", true}}}}},
+                    {"attachments", {{"1065723211349340230", {{"id", "1065723211349340230"}, {"filename", "screenshot.png"}, {"size", 48213}, {"url", "https://cdn.discordapp.com/attachments/1/2/screenshot.png"}, {"proxy_url", "https://media.discordapp.net/attachments/1/2/screenshot.png"}}}}},
+                }},
+            }},
+        };
+        return payload.dump();
+    }
+
+    // get_guild()/get_channel() read the cache, as they do for a live bot.
+    void seed_cache()
+    {
+        static bool seeded = false;
+        if (seeded)
+        {
+            return;
+        }
+        seeded = true;
+        auto *g = new dpp::guild();
+        g->id = guild_id;
+        g->name = "Bot Creator";
+        g->member_count = 15234;
+        g->owner_id = 53908232506183680;
+        g->premium_tier = 2;
+        g->premium_subscription_count = 14;
+        dpp::get_guild_cache()->store(g);
+
+        auto *c = new dpp::channel();
+        c->id = channel_id;
+        c->guild_id = guild_id;
+        c->name = "general";
+        dpp::get_channel_cache()->store(c);
+    }
+
+    std::shared_ptr<dpp::slashcommand_t> make_event()
+    {
+        seed_cache();
+        std::string raw = slashcommand_payload();
+        auto event = std::make_shared<dpp::slashcommand_t>(nullptr, raw);
+        nlohmann::json payload = nlohmann::json::parse(raw);
+        event->command.fill_from_json(&payload);
+        return event;
+    }
+
+    const bench::registrar generate_all("key_values/generate/all", []
+                                        {
+        return [event = make_event()]
+        {
+            app::key_values values;
+            app::generate_key_values(*event, values);
+            return values.size();
+        }; });
+
+    // What a command actually pays for: only the keys its response references.
+    const bench::registrar generate_wanted("key_values/generate/response_keys", []
+                                           {
+        app::placeholder_set wanted;
+        app::response_template response("((userName)) opened a ticket in ((channelName)): ((opts.reason)) (((opts.amount)) messages, ((opts.target.id)))");
+        for (const auto &key : response.keys())
+        {
+            wanted.add(key);
+        }
+        return [event = make_event(), wanted]
+        {
+            app::key_values values;
+            app::generate_key_values(*event, values, wanted);
+            return values.size();
+        }; });
+}
@@ -0,0 +1,202 @@
+// bench_main.cpp
+// Runner for bot-bench: calibrates, samples and reports every registered benchmark.
+//
+// Usage: bot-bench [--json] [--filter <substring>] [--samples <n>] [--min-time-ms <ms>]
+// With --json the report is a single JSON document on stdout, stable enough to diff between releases.
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <dpp/nlohmann/json.hpp>
+#include "bench.hpp"
+
+namespace bench
+{
+    namespace
+    {
+        std::map<std::string, setup> &registry()
+        {
+            static std::map<std::string, setup> benchmarks;
+            return benchmarks;
+        }
+
+        // Written after every sample so the compiler has to keep the operation's result.
+        volatile size_t sink = 0;
+
+        double time_sample(const operation &op, size_t iterations, size_t &bytes)
+        {
+            size_t total = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                total += op();
+            }
+            auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            sink = sink + total;
+            bytes = total;
+            return elapsed;
+        }
+
+        result run_one(const std::string &name, const setup &fixture, const options &opts)
+        {
+            result res;
+            res.name = name;
+            try
+            {
+                operation op = fixture();
+                size_t bytes = 0;
+
+                // Grow the iteration count until one sample takes long enough to time reliably.
+                size_t iterations = 1;
+                const double target_ns = opts.min_sample_ms * 1e6;
+                while (true)
+                {
+                    double elapsed = time_sample(op, iterations, bytes);
+                    if (elapsed >= target_ns || iterations >= (size_t(1) << 30))
+                    {
+                        break;
+                    }
+                    double scale = elapsed > 0 ? target_ns / elapsed * 1.2 : 10;
+                    iterations = std::max(iterations + 1, static_cast<size_t>(iterations * std::min(scale, 10.0)));
+                }
+
+                std::vector<double> per_op;
+                per_op.reserve(opts.samples);
+                double total_size = 0;
+                for (size_t s = 0; s < opts.samples; ++s)
+                {
+                    per_op.push_back(time_sample(op, iterations, bytes) / static_cast<double>(iterations));
+                    total_size += static_cast<double>(bytes) / static_cast<double>(iterations);
+                }
+                std::sort(per_op.begin(), per_op.end());
+                res.iterations = iterations;
+                res.samples = per_op.size();
+                res.ns_per_op = per_op[per_op.size() / 2];
+                res.min_ns_per_op = per_op.front();
+                res.max_ns_per_op = per_op.back();
+                res.size_per_op = total_size / static_cast<double>(per_op.size());
+            }
+            catch (const std::exception &e)
+            {
+                res.error = e.what();
+            }
+            return res;
+        }
+
+        void print_text(const result &res)
+        {
+            if (!res.error.empty())
+            {
+                std::cout << std::left << std::setw(44) << res.name << " ERROR: " << res.error << std::endl;
+                return;
+            }
+            std::cout << std::left << std::setw(44) << res.name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(14) << res.ns_per_op << " ns/op"
+                      << std::setw(12) << res.min_ns_per_op << " min"
+                      << std::setw(12) << res.max_ns_per_op << " max"
+                      << std::setw(10) << res.iterations << " iters"
+                      << std::setw(14) << res.size_per_op << " size/op" << std::endl;
+        }
+
+        nlohmann::json to_json(const std::vector<result> &results, const options &opts)
+        {
+            nlohmann::json report;
+            report["context"] = {
+                {"compiler", __VERSION__},
+                {"cplusplus", __cplusplus},
+#ifdef NDEBUG
+                {"assertions", false},
+#else
+                {"assertions", true},
+#endif
+                {"samples", opts.samples},
+                {"min_sample_ms", opts.min_sample_ms},
+            };
+            report["benchmarks"] = nlohmann::json::array();
+            for (const auto &res : results)
+            {
+                nlohmann::json entry = {{"name", res.name}};
+                if (!res.error.empty())
+                {
+                    entry["error"] = res.error;
+                }
+                else
+                {
+                    entry["iterations"] = res.iterations;
+                    entry["samples"] = res.samples;
+                    entry["ns_per_op"] = res.ns_per_op;
+                    entry["min_ns_per_op"] = res.min_ns_per_op;
+                    entry["max_ns_per_op"] = res.max_ns_per_op;
+                    entry["size_per_op"] = res.size_per_op;
+                }
+                report["benchmarks"].push_back(std::move(entry));
+            }
+            return report;
+        }
+    }
+
+    registrar::registrar(std::string name, setup fixture)
+    {
+        registry().emplace(std::move(name), std::move(fixture));
+    }
+
+    std::vector<result> run_all(const options &opts)
+    {
+        std::vector<result> results;
+        for (const auto &[name, fixture] : registry())
+        {
+            if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+            {
+                continue;
+            }
+            results.push_back(run_one(name, fixture, opts));
+            if (!opts.json)
+            {
+                print_text(results.back());
+            }
+        }
+        return results;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::options opts;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json")
+        {
+            opts.json = true;
+        }
+        else if (arg == "--filter" && has_value)
+        {
+            opts.filter = argv[++i];
+        }
+        else if (arg == "--samples" && has_value)
+        {
+            opts.samples = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (arg == "--min-time-ms" && has_value)
+        {
+            opts.min_sample_ms = std::stod(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json] [--filter <substring>] [--samples <n>] [--min-time-ms <ms>]" << std::endl;
+            return 2;
+        }
+    }
+
+    auto results = bench::run_all(opts);
+    if (opts.json)
+    {
+        std::cout << bench::to_json(results, opts).dump(2) << std::endl;
+    }
+    bool failed = std::any_of(results.begin(), results.end(), [](const bench::result &res)
+                              { return !res.error.empty(); });
+    return failed ? 1 : 0;
+}
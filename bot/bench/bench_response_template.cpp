@@ -0,0 +1,95 @@
+// bench_response_template.cpp
+// Compares the regex based app::update_string with a precompiled app::response_template.
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "bench.hpp"
+#include "../include/utils.hpp"
+#include "../include/response_template.hpp"
+
+namespace
+{
+    std::unordered_map<std::string, std::string> short_values()
+    {
+        return {
+            {"userName", "ketsuna"},
+            {"userId", "123456789012345678"},
+            {"guildName", "Bot Creator"},
+            {"channelName", "general"},
+            {"opts.amount", "42"},
+        };
+    }
+
+    const std::string short_source = "Hello ((userName)) (((userId))), welcome to ((guildName)) in #((channelName))! "
+                                     "You asked for ((opts.amount|opts.count|userId)) messages, ((opts.missing | nothing)).";
+
+    // A long embed-style response: 64 placeholders, a quarter of them falling back through `|`.
+    std::string many_source()
+    {
+        std::string source;
+        for (int i = 0; i < 64; ++i)
+        {
+            source += "Field " + std::to_string(i) + ": ";
+            source += i % 4 == 0 ? "((opts.missing" + std::to_string(i) + "|key" + std::to_string(i) + "))" : "((key" + std::to_string(i) + "))";
+            source += i % 8 == 7 ? "\n" : ", ";
+        }
+        return source;
+    }
+
+    std::unordered_map<std::string, std::string> many_values()
+    {
+        auto values = short_values();
+        for (int i = 0; i < 64; ++i)
+        {
+            values["key" + std::to_string(i)] = "value number " + std::to_string(i);
+        }
+        return values;
+    }
+
+    // The same values as an interaction's map; shared, since key_values can't be copied into a lambda.
+    std::shared_ptr<app::key_values> interned(const std::unordered_map<std::string, std::string> &values)
+    {
+        auto kv = std::make_shared<app::key_values>();
+        for (const auto &[key, value] : values)
+        {
+            kv->set(app::intern_key(key), value);
+        }
+        return kv;
+    }
+
+    void check_agree(const std::string &source, const std::unordered_map<std::string, std::string> &values)
+    {
+        if (app::response_template(source).render(*interned(values)) != app::update_string(source, values))
+        {
+            throw std::runtime_error("response_template and update_string disagree");
+        }
+    }
+
+    const bench::registrar update_string_short("template/update_string/short", []
+                                               {
+        check_agree(short_source, short_values());
+        return [values = short_values()]
+        { return app::update_string(short_source, values).size(); }; });
+
+    const bench::registrar render_short("template/render/short", []
+                                        {
+        return [compiled = app::response_template(short_source), values = interned(short_values())]
+        { return compiled.render(*values).size(); }; });
+
+    const bench::registrar update_string_many("template/update_string/64_placeholders", []
+                                              {
+        check_agree(many_source(), many_values());
+        return [source = many_source(), values = many_values()]
+        { return app::update_string(source, values).size(); }; });
+
+    const bench::registrar render_many("template/render/64_placeholders", []
+                                       {
+        return [compiled = app::response_template(many_source()), values = interned(many_values())]
+        { return compiled.render(*values).size(); }; });
+
+    const bench::registrar compile_many("template/compile/64_placeholders", []
+                                        {
+        return [source = many_source()]
+        { return app::response_template(source).keys().size(); }; });
+}
@@ -0,0 +1,45 @@
+// json_fixtures.hpp
+// The large command configurations loaded by the json benchmarks of bot-bench and bot-bench-memory.
+#pragma once
+
+#include <string>
+#include "../include/utils.hpp"
+#include "../include/command_table.hpp"
+#include "../include/config_reader.hpp"
+
+namespace bench
+{
+    // Commands shaped like the ones the control plane pushes; every fifth one purges messages.
+    inline std::string command_map(size_t count)
+    {
+        nlohmann::json commands = nlohmann::json::object();
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string name = "command" + std::to_string(i);
+            nlohmann::json command = {
+                {"response", "Hey ((userName)), ((opts.target|userName)) ran " + name + " in ((channelName)) of ((guildName))."},
+            };
+            if (i % 5 == 0)
+            {
+                command["actions"] = nlohmann::json::array({
+                    {{"id", "purge"}, {"type", "delete_messages"}, {"depend_on", "opts.amount"}, {"error", "Could not delete messages in ((channelName))."}},
+                });
+            }
+            commands[name] = std::move(command);
+        }
+        return nlohmann::json{{"command", "update"}, {"data", commands}}.dump();
+    }
+
+    // An `update` of a large bot end to end: the whole DOM, then a table copied from it...
+    inline size_t update_dom(const std::string &raw)
+    {
+        nlohmann::json body = nlohmann::json::parse(raw);
+        return app::command_table::build(body["data"])->size();
+    }
+
+    // ...or the reader compiling each command as it streams by.
+    inline size_t update_stream(const std::string &raw)
+    {
+        return app::read_command_body(raw, "update").table->size();
+    }
+}
@@ -0,0 +1,18 @@
+// memory.hpp
+// Peak memory measurement for bot-bench-memory, the only binary with the counting operator new.
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include "../bench.hpp"
+
+namespace bench
+{
+    /**
+     * @brief The most memory fn had allocated at once, above what was live when it started
+     *
+     * Counted by bot-bench-memory's replacement operator new. Reports 0 where the C library can't give
+     * block sizes, and counts allocations from every thread, so only use it single-threaded.
+     */
+    size_t peak_bytes(const std::function<void()> &fn);
+}
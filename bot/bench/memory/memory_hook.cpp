@@ -0,0 +1,68 @@
+// memory_hook.cpp
+// Replaces the global operator new/delete of bot-bench-memory, so it never skews bot-bench's timings.
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "memory.hpp"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define BENCH_BLOCK_SIZE(p) malloc_usable_size(p)
+#else
+#define BENCH_BLOCK_SIZE(p) size_t(0)
+#endif
+
+namespace
+{
+    // Signed: blocks allocated before tracking started may be freed while it runs.
+    std::atomic<long long> live{0};
+    std::atomic<long long> high{0};
+    std::atomic<bool> tracking{false};
+
+    void *allocate(size_t size)
+    {
+        void *p = std::malloc(size ? size : 1);
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        if (tracking.load(std::memory_order_relaxed))
+        {
+            long long now = live.fetch_add(static_cast<long long>(BENCH_BLOCK_SIZE(p)), std::memory_order_relaxed) + static_cast<long long>(BENCH_BLOCK_SIZE(p));
+            long long seen = high.load(std::memory_order_relaxed);
+            while (now > seen && !high.compare_exchange_weak(seen, now, std::memory_order_relaxed))
+            {
+            }
+        }
+        return p;
+    }
+
+    void release(void *p)
+    {
+        if (p && tracking.load(std::memory_order_relaxed))
+        {
+            live.fetch_sub(static_cast<long long>(BENCH_BLOCK_SIZE(p)), std::memory_order_relaxed);
+        }
+        std::free(p);
+    }
+}
+
+void *operator new(size_t size) { return allocate(size); }
+void *operator new[](size_t size) { return allocate(size); }
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+
+namespace bench
+{
+    size_t peak_bytes(const std::function<void()> &fn)
+    {
+        live = 0;
+        high = 0;
+        tracking = true;
+        fn();
+        tracking = false;
+        return static_cast<size_t>(std::max(0LL, high.load()));
+    }
+}
@@ -0,0 +1,18 @@
+// memory_json.cpp
+// The most memory loading a large command configuration allocates at once, reported as size/op.
+#include <string>
+#include "memory.hpp"
+#include "../json_fixtures.hpp"
+
+namespace
+{
+    const bench::registrar update_dom_memory("json/update_dom/5000_commands/peak_bytes", []
+                                             {
+        return [raw = bench::command_map(5000)]
+        { return bench::peak_bytes([&raw] { bench::update_dom(raw); }); }; });
+
+    const bench::registrar update_stream_memory("json/update_stream/5000_commands/peak_bytes", []
+                                                {
+        return [raw = bench::command_map(5000)]
+        { return bench::peak_bytes([&raw] { bench::update_stream(raw); }); }; });
+}
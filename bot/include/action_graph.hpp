@@ -0,0 +1,79 @@
+// action_graph.hpp
+#pragma once
+
+#include <dpp/nlohmann/json.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "key_values.hpp"
+
+namespace app
+{
+    /**
+     * @brief Values an action publishes for the actions that run after it
+     *
+     * An output `deleted` of the action with id `purge` becomes the placeholder
+     * `action.purge.deleted` once purge's level is done: every action of a later level and the
+     * command's final response can use it.
+     */
+    using action_outputs = std::unordered_map<std::string, std::string>;
+
+    /**
+     * @brief An action's config, checked and prepared when the graph compiles; each action type derives its own
+     */
+    struct action_settings
+    {
+        virtual ~action_settings() = default;
+
+        // The outputs the action may publish; anything else it sets is dropped with a warning.
+        std::vector<std::string> outputs;
+    };
+
+    struct action_node
+    {
+        // The action's `id`, or its position in the array when it has none.
+        std::string id;
+        std::string type;
+        nlohmann::json config;
+        // Set for every action type the bot runs; unknown types keep null and are skipped.
+        std::shared_ptr<const action_settings> settings;
+        // Each of settings->outputs with the id of its `action.<id>.<output>` key, interned when the graph compiles.
+        std::vector<std::pair<std::string, key_id>> output_keys;
+        // The `depend_on` placeholder, interned when the graph compiles; no_key when there is none.
+        key_id depend_on = no_key;
+        // Indices of the actions listed in `after`; this one starts once they all succeeded.
+        std::vector<size_t> after;
+    };
+
+    /**
+     * @brief A command's `actions` array compiled into a dependency graph
+     *
+     * Each action may declare `"id"` and `"after": ["other-id", ...]`. Actions are grouped into
+     * levels: every action of a level only depends on earlier levels, so a whole level can run
+     * concurrently. Actions without `after` all start right away.
+     */
+    class action_graph
+    {
+    public:
+        action_graph() = default;
+
+        /**
+         * @brief Compiles an `actions` array
+         *
+         * @param actions The array from the command config
+         * @return action_graph The compiled graph
+         * @throws std::invalid_argument on duplicate ids, unknown dependencies, cycles or a malformed action config
+         */
+        static action_graph compile(const nlohmann::json &actions);
+
+        const std::vector<action_node> &nodes() const { return nodes_; }
+        const std::vector<std::vector<size_t>> &levels() const { return levels_; }
+        bool empty() const { return nodes_.empty(); }
+
+    private:
+        std::vector<action_node> nodes_;
+        std::vector<std::vector<size_t>> levels_;
+    };
+} // namespace app
@@ -1,3 +1,30 @@
+#pragma once
+
 #include <dpp/dpp.h>
+#include "../action_graph.hpp"
+#include "../interaction_reply.hpp"
+#include "../response_template.hpp"
+
+/**
+ * @brief A `delete_messages` action's config, checked once when the command compiles
+ */
+struct delete_settings : app::action_settings
+{
+    uint64_t max_amount;
+    std::string error;
+    std::string error_amount;
+    std::string error_perm_channel;
+    // Rendered over the interaction's values, plus ((deleted)) and ((amount)).
+    app::response_template progress;
+};
+
+/**
+ * @brief Reads a `delete_messages` action's config
+ *
+ * `max_amount` is clamped to 1..10000 (the default).
+ *
+ * @throws std::invalid_argument when a field has the wrong type
+ */
+std::shared_ptr<const delete_settings> compile_delete_settings(const nlohmann::json &action);
 
-dpp::task<bool> delete_action(const dpp::slashcommand_t &event, const nlohmann::json &action, const std::unordered_map<std::string, std::string> &key_values, dpp::user &user_ptr, dpp::cluster *cluster);
+dpp::task<bool> delete_action(const dpp::slashcommand_t &event, const app::action_node &action, const app::key_values &key_values, dpp::user &user_ptr, dpp::cluster *cluster, app::action_outputs &outputs, app::interaction_reply &reply, app::rest_api &rest);
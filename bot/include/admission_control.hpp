@@ -0,0 +1,126 @@
+// admission_control.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "response_template.hpp"
+
+namespace app
+{
+    /**
+     * @brief `count` invocations per `per` seconds, refilled continuously (a token bucket)
+     */
+    struct rate_limit
+    {
+        uint32_t count = 0;
+        double per_seconds = 0;
+
+        bool enabled() const { return count > 0 && per_seconds > 0; }
+    };
+
+    /**
+     * @brief A command's `rate_limit` config, compiled with the command
+     *
+     * ```
+     * "rate_limit": {
+     *     "user": {"count": 2, "per": 10},     // each user, for this command
+     *     "guild": {"count": 20, "per": 60},   // each guild, for this command
+     *     "command": {"count": 100, "per": 60}, // the whole bot, for this command
+     *     "message": "Slow down, try again in ((retryAfter)) seconds."
+     * }
+     * ```
+     * Every scope is optional; a scope that is present needs a count of at least 1. The message is sent as an ephemeral reply and may use
+     * ((retryAfter)), ((userName)), ((userId)) and ((commandName)).
+     */
+    struct admission_policy
+    {
+        rate_limit user;
+        rate_limit guild;
+        rate_limit command;
+        response_template message{"You are using this command too often, try again in ((retryAfter)) seconds."};
+
+        /**
+         * @return std::optional<admission_policy> The policy, or std::nullopt when no scope is limited
+         * @throws std::invalid_argument when a limit is malformed
+         */
+        static std::optional<admission_policy> from_json(const nlohmann::json &j);
+    };
+
+    /**
+     * @brief The token buckets of one bot, checked before an interaction does any work
+     *
+     * Buckets live in a table split into shards, each behind its own mutex, so concurrent
+     * interactions rarely contend. A bucket that has refilled completely is indistinguishable
+     * from a missing one, so shards drop such buckets as they grow: memory follows the number of
+     * recently active users, not the number ever seen.
+     */
+    class admission_control
+    {
+    public:
+        struct decision
+        {
+            bool admitted = true;
+            // Seconds until the limiting bucket has a token again.
+            double retry_after = 0;
+        };
+
+        /**
+         * @brief Takes one token from each limited scope, or none if any of them is empty
+         */
+        decision admit(const std::string &command, const admission_policy &policy, dpp::snowflake user_id, dpp::snowflake guild_id);
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        enum class scope : uint8_t
+        {
+            user,
+            guild,
+            command
+        };
+
+        struct bucket_key
+        {
+            uint64_t id;
+            uint64_t command;
+            scope kind;
+            bool operator==(const bucket_key &other) const = default;
+        };
+
+        struct bucket_key_hash
+        {
+            size_t operator()(const bucket_key &key) const;
+        };
+
+        struct bucket
+        {
+            double tokens;
+            double capacity;
+            double per_second;
+            clock::time_point updated;
+        };
+
+        struct alignas(64) shard
+        {
+            std::mutex mutex;
+            std::unordered_map<bucket_key, bucket, bucket_key_hash> buckets;
+            size_t inserts_since_sweep = 0;
+        };
+
+        static constexpr size_t shard_count = 32;
+
+        shard &shard_for(const bucket_key &key);
+        // On success a token is taken; otherwise retry_after is set and nothing changes.
+        bool take(const bucket_key &key, const rate_limit &limit, clock::time_point now, double &retry_after);
+        void give_back(const bucket_key &key);
+        static void sweep(shard &s, clock::time_point now);
+
+        std::array<shard, shard_count> shards;
+    };
+} // namespace app
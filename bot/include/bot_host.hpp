@@ -0,0 +1,86 @@
+// bot_host.hpp
+#pragma once
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bot_instance.hpp"
+#include "http_webhook_server.hpp"
+
+namespace app
+{
+    /**
+     * @brief Answers a control request aimed at a single bot
+     *
+     * POST bodies carry the same commands in both modes (`update`, `patch`, `update_status`, `log_level`);
+     * `GET /metrics` serves the process's metrics in the Prometheus text format.
+     *
+     * @param bot The bot the request is for
+     * @param req The webhook request
+     * @param command The body's `command`, when the caller has peeked it already (see peek_command)
+     * @return HttpWebhookServer::HttpResponse The JSON response for the control plane
+     */
+    HttpWebhookServer::HttpResponse handle_bot_request(bot_instance &bot, const HttpWebhookServer::HttpRequest &req, std::optional<std::string> command = std::nullopt);
+
+    /**
+     * @brief Runs many bots inside one process behind a single control endpoint
+     *
+     * Requests are routed by path:
+     * - `POST /bots/<token>` with `{"command": "start"}` creates and connects a bot; an optional
+     *   `"cluster"` object sets its intents, cache policy and shards (see cluster_options)
+     * - `POST /bots/<token>` with `{"command": "restart"}` rebuilds a bot with new `"cluster"` options,
+     *   keeping its command config; the new cluster replaces the old one only once it has started, and
+     *   the old one then leaves new interactions to it and disconnects once its own have finished
+     * - `POST /bots/<token>` with `{"command": "stop"}` disconnects and removes it
+     * - `POST /bots/<token>` with any other command is forwarded to handle_bot_request
+     * - `GET /bots` reports how many bots are running
+     * - `GET /metrics` serves the metrics of every bot in the process
+     *
+     * A bot that is stopped or restarted is retired in the background: it is drained (see
+     * bot_instance::drain), disconnected, and destroyed only once none of its interactions runs
+     * anymore. The control request is answered right away.
+     */
+    class bot_host
+    {
+    public:
+        /**
+         * @param drain_grace How long a stopping bot's running interactions get to finish
+         */
+        explicit bot_host(std::chrono::steady_clock::duration drain_grace = std::chrono::seconds(10));
+        ~bot_host();
+
+        HttpWebhookServer::HttpResponse handle(const HttpWebhookServer::HttpRequest &req);
+
+        /**
+         * @brief Removes every bot and retires them in the background; the destructor waits for them
+         */
+        void stop_all();
+
+        /**
+         * @brief Removes every bot, drains them all within one drain_grace and disconnects them, before the process exits
+         *
+         * Unlike stop_all, it returns once they are stopped; interactions that outlive the grace are abandoned.
+         */
+        void shutdown();
+
+    private:
+        std::shared_ptr<bot_instance> find(const std::string &token);
+        HttpWebhookServer::HttpResponse restart(const std::string &token, const cluster_options &options);
+        // Drains, stops and destroys a bot removed from bots on its own thread.
+        void retire(std::shared_ptr<bot_instance> bot);
+
+        const std::chrono::steady_clock::duration drain_grace;
+        // Only taken by control requests; interactions go straight to their own bot_instance.
+        std::shared_mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<bot_instance>> bots;
+        std::mutex retiring_mutex;
+        // One per bot being retired; finished ones are dropped by the next retire().
+        std::vector<std::future<void>> retiring;
+    };
+} // namespace app
@@ -0,0 +1,177 @@
+// bot_instance.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "admission_control.hpp"
+#include "cluster_options.hpp"
+#include "command_table.hpp"
+#include "presence_scheduler.hpp"
+#include "rest_api.hpp"
+#include "update_sequencer.hpp"
+
+namespace app
+{
+    /**
+     * @brief One Discord bot: its cluster, its published command table and its event handlers
+     *
+     * A process runs a single instance in the classic `discord-bot <token> <port>` mode, or many
+     * of them side by side in host mode (see bot_host), sharing one DPP runtime and webhook port.
+     */
+    class bot_instance
+    {
+    public:
+        /**
+         * @param token The bot token
+         * @param options Intents, cache policy and shard layout of the underlying cluster
+         */
+        explicit bot_instance(const std::string &token, const cluster_options &options = {});
+        ~bot_instance();
+
+        bot_instance(const bot_instance &) = delete;
+        bot_instance &operator=(const bot_instance &) = delete;
+
+        /**
+         * @brief Connects to the gateway and returns
+         */
+        void start();
+
+        /**
+         * @brief Disconnects every shard; the instance can be destroyed afterwards
+         */
+        void stop();
+
+        /**
+         * @brief Stops taking interactions and waits for the running ones to send their final response
+         *
+         * Interactions arriving from now on get a short ephemeral "restarting" reply. The shards stay
+         * connected, so the final responses still go out; stop() the instance afterwards.
+         *
+         * @param grace How long to wait at most
+         * @return false when interactions were still running at the deadline
+         */
+        bool drain(std::chrono::steady_clock::duration grace);
+
+        /**
+         * @brief Waits until no interaction is running, without refusing new ones
+         *
+         * Interactions and their REST callbacks use the instance until they end, so it must not be
+         * destroyed before this returned true after stop(); see bot_host.
+         *
+         * @return false when interactions were still running at the deadline
+         */
+        bool wait_idle(std::chrono::steady_clock::duration timeout);
+
+        /**
+         * @brief Interactions that started and haven't sent their final response yet
+         */
+        size_t running_interactions();
+
+        /**
+         * @brief Serves the command table another instance of the same bot publishes, e.g. the one it replaces
+         */
+        void adopt_commands(bot_instance &previous);
+
+        /**
+         * @brief Leaves new interactions to the instance that replaces this one, e.g. after a restart
+         *
+         * Both clusters are connected with the same token until this one is retired, so Discord
+         * delivers every interaction to both: from now on this one ignores them instead of answering
+         * "restarting", and only finishes those it already runs. Call it once the successor has started.
+         */
+        void hand_over();
+
+        /**
+         * @brief Applies a control command sent by the control plane (`update`, `patch`, `update_status`, `log_level`)
+         *
+         * @param body The parsed webhook body
+         * @return Extra fields for the success response (e.g. `presence` for `update_status`), or
+         * std::nullopt if the body held no command
+         * @throws std::exception when the command is malformed
+         *
+         * Config changes are applied in the order they arrived, even when an older `update` finishes
+         * compiling last: it is then dropped (see update_sequencer).
+         */
+        std::optional<nlohmann::json> handle_command(const nlohmann::json &body);
+
+        /**
+         * @brief Same as handle_command, from the raw webhook body
+         *
+         * An `update` is compiled while its body is read, so a large config never exists as a
+         * whole DOM next to the table built from it; see read_command_body.
+         *
+         * @param command The body's `command`, as peek_command found it
+         */
+        std::optional<nlohmann::json> handle_request(std::string_view body, std::string_view command);
+
+        /**
+         * @brief Answers a slash command; the cluster's handler, public so recorded interactions can be replayed
+         */
+        dpp::task<void> on_slashcommand(const dpp::slashcommand_t &event);
+
+        /**
+         * @brief Offers the choices of the command's `autocomplete` list that start with what the user typed
+         *
+         * Answered straight from the published table's prefix index, without REST lookups or placeholders.
+         */
+        void on_autocomplete(const dpp::autocomplete_t &event);
+
+        /**
+         * @brief Sends this bot's interaction REST calls somewhere else, e.g. the replay harness's stub
+         *
+         * Only safe before the first interaction is dispatched.
+         */
+        void set_rest(std::shared_ptr<rest_api> api) { rest = std::move(api); }
+
+        dpp::cluster &cluster() { return bot; }
+
+    private:
+        // ticket was taken when the body arrived.
+        std::optional<nlohmann::json> handle_command(const nlohmann::json &body, const update_sequencer::ticket &ticket);
+        presence_scheduler::outcome update_status(const nlohmann::json &body);
+        // Swaps in a new table unless a newer one was published meanwhile; started is when its body arrived, for the reload metric.
+        void publish(std::shared_ptr<const command_table> table, std::chrono::steady_clock::time_point started, const update_sequencer::ticket &ticket);
+        // Called under the update lock, so the snapshot writer's latest table is the last one published.
+        void save_snapshot(std::shared_ptr<const command_table> table);
+        // Counts an interaction as running until the returned handle and its copies are released;
+        // accepted is false once draining, and the interaction should then only be told to retry.
+        // nullptr after hand_over: the interaction is the successor's to answer and isn't counted.
+        std::shared_ptr<void> track_interaction(bool &accepted);
+
+        // Shared with the handles of running interactions, which may outlive the instance after a drain timed out.
+        struct in_flight_count
+        {
+            std::mutex mutex;
+            std::condition_variable idle;
+            size_t count = 0;
+            // Set by drain; from then on new interactions are only counted until they are refused.
+            bool draining = false;
+            // Set by hand_over; new interactions are then ignored rather than refused.
+            bool handed_over = false;
+        };
+
+        dpp::cluster bot;
+        std::shared_ptr<rest_api> rest = rest_api::for_cluster(bot);
+        // Decoded from the token, for log records.
+        const uint64_t id;
+        // Published by the webhook thread on `update`, read by interactions as immutable snapshots.
+        std::atomic<std::shared_ptr<const command_table>> commands{std::make_shared<const command_table>()};
+        // Orders and serializes `update` and `patch`; readers never wait for it.
+        update_sequencer updates;
+        // Per-command rate limit buckets; they outlive config updates, so a reload doesn't reset anyone's budget.
+        admission_control admission;
+        // Empty when the token doesn't name a bot id; snapshots are then disabled.
+        std::string snapshot_path;
+        std::shared_ptr<in_flight_count> in_flight = std::make_shared<in_flight_count>();
+        // Declared after bot, so it is destroyed (and stops flushing) before the cluster.
+        presence_scheduler presence{bot};
+        bool started = false;
+    };
+} // namespace app
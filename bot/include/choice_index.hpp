@@ -0,0 +1,68 @@
+// choice_index.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace app
+{
+    /**
+     * @brief The autocomplete choices of one command option, indexed by the prefix of their name
+     *
+     * Autocomplete fires on every keystroke, so the list is prepared when the config loads: names
+     * are case-folded once into a single buffer and sorted, and a lookup is a binary search over
+     * that array followed by a walk over the matches it needs. Its cost depends on the length of
+     * what was typed and the log of the list size, never on a scan of the choices.
+     *
+     * Folding is ASCII only: other UTF-8 text matches when it is typed exactly.
+     */
+    class choice_index
+    {
+    public:
+        // Discord shows at most this many choices per autocomplete response.
+        static constexpr size_t max_choices = 25;
+
+        choice_index() = default;
+
+        /**
+         * @brief Compiles a choice list from the command config
+         *
+         * Each item is a string or a number, which is both the name shown and the value sent, or
+         * an object `{"name": "Paris", "value": "fr-par"}` whose value is a string or a number.
+         * Names and string values are limited to 100 characters, counted as UTF-8 code points like Discord does.
+         *
+         * @throws std::invalid_argument when the list isn't an array or an item is malformed
+         */
+        static choice_index from_json(const nlohmann::json &choices);
+
+        /**
+         * @brief The choices whose name starts with typed, ignoring ASCII case and leading spaces
+         *
+         * Matches come in case-folded name order. With nothing typed, the first choices are
+         * returned in the order of the config, so it decides what is offered up front.
+         */
+        std::vector<const dpp::command_option_choice *> complete(std::string_view typed, size_t limit = max_choices) const;
+
+        size_t size() const { return choices.size(); }
+
+    private:
+        struct entry
+        {
+            uint32_t key_offset;
+            uint32_t key_length;
+            uint32_t choice;
+        };
+
+        std::string_view key_of(const entry &e) const { return std::string_view(keys).substr(e.key_offset, e.key_length); }
+
+        // In config order.
+        std::vector<dpp::command_option_choice> choices;
+        // Every folded name, back to back.
+        std::string keys;
+        // Sorted by folded name, then config order.
+        std::vector<entry> sorted;
+    };
+} // namespace app
@@ -0,0 +1,43 @@
+// cluster_options.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <string>
+
+namespace app
+{
+    /**
+     * @brief How a bot's dpp::cluster is built: gateway intents, cache policy and shard layout
+     *
+     * The defaults are DPP's own. A bot that only answers static commands can drop the member
+     * cache and privileged intents entirely, e.g.
+     * `{"intents": ["guilds"], "cache": {"users": "none", "roles": "none", "channels": "lazy"}}`;
+     * permission checks and placeholders then fall back to the interaction payload and REST.
+     */
+    struct cluster_options
+    {
+        uint32_t intents = dpp::i_default_intents;
+        // 0 lets Discord recommend a shard count.
+        uint32_t shards = 0;
+        uint32_t cluster_id = 0;
+        uint32_t max_clusters = 1;
+        dpp::cache_policy_t cache_policy = {};
+
+        /**
+         * @brief Reads options from JSON, keeping the defaults for absent fields
+         *
+         * Fields: `intents` (a number, or an array of names such as "guilds", "guild_members",
+         * "guild_messages", "message_content", "default", "all"), `shards`, `cluster_id`,
+         * `max_clusters`, and `cache`, an object mapping `users` (alias `members`), `roles`,
+         * `channels`, `guilds` and `emojis` to "aggressive", "lazy" or "none".
+         *
+         * @throws std::invalid_argument on an unknown intent, cache field or policy
+         */
+        static cluster_options from_json(const nlohmann::json &j);
+
+        /**
+         * @brief Reads options from the JSON in BOT_CLUSTER_OPTIONS, or the defaults when unset
+         */
+        static cluster_options from_env();
+    };
+} // namespace app
@@ -0,0 +1,128 @@
+// command_table.hpp
+#pragma once
+
+#include <dpp/nlohmann/json.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "action_graph.hpp"
+#include "admission_control.hpp"
+#include "choice_index.hpp"
+#include "placeholder_set.hpp"
+#include "response_template.hpp"
+
+namespace app
+{
+    /**
+     * @brief Everything needed to answer one slash command, prepared when the config loads
+     */
+    struct command_entry
+    {
+        std::string name;
+        // The command's config object as last received; `patch` merges into it.
+        nlohmann::json source;
+        action_graph graph;
+        std::optional<response_template> response;
+        // Every placeholder the response and actions can reference, see generate_key_values.
+        placeholder_set placeholders;
+        // The command's `rate_limit`, checked before any placeholder or action work.
+        std::optional<admission_policy> admission;
+        // The command's `autocomplete` choice lists, keyed by option name and indexed for prefix lookups.
+        std::unordered_map<std::string, choice_index> autocomplete;
+
+        bool has_actions() const { return !graph.empty(); }
+    };
+
+    /**
+     * @brief An immutable, flat view of a bot's command config
+     *
+     * A table is built once per `update` or `patch` and never modified afterwards, so it can be
+     * shared between the webhook thread and any number of in-flight interactions without locking.
+     * Publish it through an std::atomic<std::shared_ptr<const command_table>>: readers load a
+     * snapshot and keep it alive for as long as they need it.
+     *
+     * Entries are immutable too and shared between a table and the tables patched from it, so a
+     * patch only compiles the commands it touches.
+     */
+    class command_table
+    {
+    public:
+        command_table() = default;
+
+        /**
+         * @brief Builds a table one command at a time, e.g. while an `update` body is still being read
+         */
+        class builder
+        {
+        public:
+            explicit builder(size_t expected = 0);
+
+            /**
+             * @brief Compiles a command and adds it, replacing any command of the same name
+             *
+             * The config is moved into the entry, not copied. A config that isn't an object removes the
+             * command instead, as in build().
+             *
+             * @throws std::invalid_argument when the command's actions cannot be scheduled, or its rate limit or autocomplete choices are malformed
+             */
+            void add(const std::string &name, nlohmann::json command_data);
+
+            std::shared_ptr<const command_table> finish() { return std::move(table); }
+
+        private:
+            std::shared_ptr<command_table> table;
+        };
+
+        /**
+         * @brief Builds a table from the `data` object of an `update` webhook command
+         *
+         * @param data The command map, keyed by command name
+         * @return std::shared_ptr<const command_table> The compiled, immutable table
+         * @throws std::invalid_argument when a command's actions cannot be scheduled, or its rate limit or autocomplete choices are malformed
+         */
+        static std::shared_ptr<const command_table> build(const nlohmann::json &data);
+
+        /**
+         * @brief Builds a new table from this one and the body of a `patch` webhook command
+         *
+         * The body may hold any of, applied in this order:
+         * - `data`: an RFC 7396 merge-patch of the command map, which must be an object; `null`
+         *   removes a command, an object is merged into the command's current config
+         * - `upsert`: commands to add or replace whole, keyed by name
+         * - `delete`: an array of command names to remove
+         *
+         * Only the commands named in the patch are recompiled; every other entry is shared.
+         *
+         * @param body The parsed webhook body
+         * @return std::shared_ptr<const command_table> The patched table; this one is left untouched
+         * @throws std::invalid_argument when `data` isn't an object or a patched command's actions cannot be scheduled
+         */
+        std::shared_ptr<const command_table> patch(const nlohmann::json &body) const;
+
+        /**
+         * @brief Looks up a command by name
+         *
+         * @param name The command name as sent by Discord
+         * @return const command_entry* The command, or nullptr when it is not configured
+         */
+        const command_entry *find(const std::string &name) const;
+
+        size_t size() const { return commands_.size(); }
+
+        template <typename Fn>
+        void for_each(Fn &&fn) const
+        {
+            for (const auto &[name, entry] : commands_)
+            {
+                fn(*entry);
+            }
+        }
+
+    private:
+        // nullptr when the config isn't an object, i.e. not a command.
+        static std::shared_ptr<const command_entry> compile(const std::string &command_name, nlohmann::json command_data);
+
+        std::unordered_map<std::string, std::shared_ptr<const command_entry>> commands_;
+    };
+} // namespace app
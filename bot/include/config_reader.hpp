@@ -0,0 +1,53 @@
+// config_reader.hpp
+#pragma once
+
+#include <dpp/nlohmann/json.hpp>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "command_table.hpp"
+
+namespace app
+{
+    /**
+     * @brief A webhook body, read in one pass
+     */
+    struct command_body
+    {
+        // The body's members, except the `data` of an `update` when it was streamed into `table`.
+        nlohmann::json envelope;
+        // An `update`'s command map, compiled while it was read; nullptr for every other body.
+        std::shared_ptr<const command_table> table;
+    };
+
+    /**
+     * @brief Parses JSON with the bot's own reader, falling back to nlohmann::json::parse on anything it rejects
+     *
+     * The reader builds the same nlohmann::json values nlohmann's parser would, but scans strings 16
+     * bytes at a time (SSE2 or NEON) and copies unescaped runs whole. Malformed or unusual input,
+     * e.g. nesting deeper than the reader allows, goes through nlohmann, so errors read the same.
+     *
+     * @throws nlohmann::json::parse_error when the text isn't valid JSON
+     */
+    nlohmann::json parse_json(std::string_view text);
+
+    /**
+     * @brief The top-level `command` string of a body without parsing the rest, or "" when there is none
+     *
+     * Other members are skipped structurally; nothing is allocated for them.
+     */
+    std::string peek_command(std::string_view body);
+
+    /**
+     * @brief Reads a webhook body; an `update`'s `data` is compiled command by command as it streams by
+     *
+     * Each command's config is moved into its table entry as soon as it has been read, so the
+     * command map never exists as a whole DOM next to the table: peak memory is about the body
+     * plus the table, instead of twice the config. Bodies the reader rejects are parsed once by
+     * nlohmann and come back whole, without a table; an invalid body is a null envelope.
+     *
+     * @param command The body's `command` from peek_command, which the caller needed anyway
+     * @throws std::invalid_argument when a streamed command cannot be compiled
+     */
+    command_body read_command_body(std::string_view body, std::string_view command);
+} // namespace app
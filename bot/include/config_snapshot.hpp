@@ -0,0 +1,95 @@
+// config_snapshot.hpp
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include "command_table.hpp"
+
+namespace app
+{
+    /**
+     * @brief The last accepted command config, persisted in a flat binary file for warm starts
+     *
+     * Layout, native endianness (the file never leaves the host):
+     * - header: magic, format version, command count, data size and a checksum of the data
+     * - index: one {name offset, name length, config offset, config length} per command, sorted by name
+     * - data: the names, then each command's config encoded as CBOR
+     *
+     * Loading maps the file and decodes the binary configs straight into a command table, so a
+     * restarted bot answers with its last config before the control plane pushes anything and
+     * without parsing any JSON text. Files are replaced atomically, so a crash mid-write leaves
+     * the previous snapshot in place; a truncated or corrupt file is ignored.
+     */
+    namespace config_snapshot
+    {
+        /**
+         * @brief Where the snapshot of a bot lives, under BOT_SNAPSHOT_DIR (default `snapshots`)
+         *
+         * @param bot_id The bot's user id; the token is never used in file names
+         */
+        std::string path_for(uint64_t bot_id);
+
+        /**
+         * @brief Writes the table to path, replacing any previous snapshot
+         *
+         * @return false when the file could not be written; the error has been logged
+         */
+        bool save(const std::string &path, const command_table &table);
+
+        /**
+         * @brief Replaces the file at path with contents, atomically and durably
+         *
+         * The contents go to a temporary file next to it, created with mode 0600 and fsynced, which
+         * is renamed over path before the directory is fsynced too. Missing directories are created.
+         *
+         * @return false when the file could not be written; the error has been logged
+         */
+        bool write_atomically(const std::string &path, std::string_view contents);
+
+        /**
+         * @brief Saves snapshots on a background thread, so publishing a table never waits for the disk
+         *
+         * Only the latest table submitted for a path is kept until it is written: a burst of
+         * updates costs one write. One writer serves every bot of the process.
+         */
+        class writer
+        {
+        public:
+            static writer &instance();
+            // Writes what is still pending before returning.
+            ~writer();
+
+            void submit(std::string path, std::shared_ptr<const command_table> table);
+
+            /**
+             * @brief Blocks until every table submitted so far has been written, e.g. before the process exits
+             */
+            void flush();
+
+        private:
+            writer();
+            void run();
+
+            std::mutex mutex;
+            // Signals new work to the thread, and finished work to flush().
+            std::condition_variable changed;
+            std::unordered_map<std::string, std::shared_ptr<const command_table>> pending;
+            bool busy = false;
+            bool stopping = false;
+            // Declared last, so it starts once the rest is constructed.
+            std::thread thread;
+        };
+
+        /**
+         * @brief Maps and decodes a snapshot
+         *
+         * @return std::shared_ptr<const command_table> The table, or nullptr when there is no usable snapshot
+         */
+        std::shared_ptr<const command_table> load(const std::string &path);
+    }
+} // namespace app
@@ -0,0 +1,59 @@
+// deadline_queue.hpp
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace app
+{
+    /**
+     * @brief Threads running callbacks at given times
+     *
+     * DPP's own timers tick once per second, too coarse for interaction deadlines and gateway
+     * pacing. Callbacks run on the queue's threads, so they must be short and must not block;
+     * anything that outlives its owner should capture a weak_ptr.
+     */
+    class deadline_queue
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief The process-wide queue, one thread, never destroyed
+         */
+        static deadline_queue &instance();
+
+        /**
+         * @param threads How many callbacks may run at once
+         */
+        explicit deadline_queue(size_t threads);
+        // Pending callbacks are dropped; running ones finish first.
+        ~deadline_queue();
+
+        deadline_queue(const deadline_queue &) = delete;
+        deadline_queue &operator=(const deadline_queue &) = delete;
+
+        void schedule(clock::time_point when, std::function<void()> callback);
+
+    private:
+        struct entry
+        {
+            clock::time_point when;
+            std::function<void()> callback;
+            bool operator>(const entry &other) const { return when > other.when; }
+        };
+
+        void run();
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::priority_queue<entry, std::vector<entry>, std::greater<>> entries;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+    };
+} // namespace app
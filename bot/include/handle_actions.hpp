@@ -1,3 +1,5 @@
 #include <dpp/dpp.h>
+#include "action_graph.hpp"
+#include "interaction_reply.hpp"
 
-dpp::task<bool> handle_actions(const dpp::slashcommand_t& event, const nlohmann::json& actions, const std::unordered_map<std::string, std::string>& key_values);
+dpp::task<bool> handle_actions(const dpp::slashcommand_t& event, const app::action_graph& actions, app::key_values& key_values, app::interaction_reply& reply, app::rest_api& rest);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A parsed HTTP request whose fields are views into the connection's input buffer
+ *
+ * The views stay valid until the buffer they point into is modified, i.e. for the duration
+ * of the request handler.
+ */
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;
+    std::string_view version;
+    std::vector<std::pair<std::string_view, std::string_view>> headers;
+    std::string_view body;
+
+    /**
+     * @brief Case-insensitive header lookup
+     *
+     * @return std::string_view The header value, or an empty view when absent
+     */
+    std::string_view header(std::string_view name) const;
+
+    /**
+     * @brief Whether a comma-separated header such as `Connection` lists the token
+     *
+     * Names and tokens compare case-insensitively, and every field line with that name counts,
+     * e.g. `Connection: keep-alive, Upgrade` lists both `keep-alive` and `upgrade` (RFC 9110 §5.6.1).
+     */
+    bool headerHasToken(std::string_view name, std::string_view token) const;
+};
+
+/**
+ * @brief Incremental HTTP/1.1 request parser
+ *
+ * Feed it the same per-connection buffer each time more bytes arrive; it resumes
+ * where it stopped instead of rescanning, and only reports Complete once the whole body
+ * (Content-Length or chunked) is in the buffer. Chunked bodies are decoded in place so the
+ * body is always a single contiguous view.
+ */
+class HttpRequestParser {
+public:
+    enum class Status { Incomplete, Complete, Error };
+
+    HttpRequestParser() = default;
+    HttpRequestParser(size_t max_body_size, size_t max_header_size)
+        : max_body_size(max_body_size), max_header_size(max_header_size) {}
+
+    /**
+     * @brief Parses whatever new bytes were appended to the buffer since the last call
+     *
+     * @param data The start of the connection's input buffer; chunked bodies are compacted in place
+     * @param size The number of valid bytes at data
+     * @return Status Complete when request() is ready, Error when errorStatus() should be sent
+     */
+    Status parse(char* data, size_t size);
+
+    /**
+     * @brief The completed request, valid after parse() returned Complete
+     */
+    const HttpRequest& request() const { return req; }
+
+    /**
+     * @brief Bytes at the front of the buffer taken by the completed request
+     */
+    size_t consumed() const { return consumed_bytes; }
+
+    /**
+     * @brief The HTTP status to answer with after parse() returned Error
+     */
+    int errorStatus() const { return error_status; }
+
+    /**
+     * @brief Whether the client sent `Expect: 100-continue` and is waiting for an interim response
+     */
+    bool expectsContinue() const { return expect_continue; }
+
+    /**
+     * @brief Total request size once the headers announced a Content-Length, otherwise 0
+     *
+     * Lets the caller grow its buffer once instead of doubling it for a multi-MB body.
+     */
+    size_t expectedSize() const { return state == State::Body ? body_start + content_length : 0; }
+
+    /**
+     * @brief Forgets the current request so the parser can start on the next one
+     */
+    void reset();
+
+private:
+    enum class State { Headers, Body, ChunkSize, ChunkData, ChunkTrailer, Done, Failed };
+
+    struct Span {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    Status fail(int status);
+    bool parseHead(std::string_view head);
+    void materialize(std::string_view data);
+
+    size_t max_body_size = 64 * 1024 * 1024;
+    size_t max_header_size = 64 * 1024;
+
+    State state = State::Headers;
+    size_t scan_pos = 0;       // Next unparsed byte
+    size_t body_start = 0;     // First body byte, right after the header block
+    size_t body_length = 0;    // Bytes of (decoded) body available at body_start
+    size_t content_length = 0;
+    size_t chunk_remaining = 0;
+    size_t trailer_start = 0;  // First byte after the last chunk, where the trailer section begins
+    size_t consumed_bytes = 0;
+    int error_status = 0;
+    bool expect_continue = false;
+
+    Span method, path, version;
+    std::vector<std::pair<Span, Span>> header_spans;
+    HttpRequest req;
+};
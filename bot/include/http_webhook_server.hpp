@@ -2,20 +2,21 @@
 
 #include <sys/epoll.h>
 #include <netinet/in.h>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #include <system_error>
-#include <sstream>
+#include "http_request_parser.hpp"
 
 class HttpWebhookServer {
 public:
-    struct HttpRequest {
-        std::string method;
-        std::string path;
-        std::unordered_map<std::string, std::string> headers;
-        std::string body;
-    };
+    using HttpRequest = ::HttpRequest;
 
     struct HttpResponse {
         int status_code = 200;
@@ -25,31 +26,96 @@ public:
 
     using Handler = std::function<HttpResponse(const HttpRequest&)>;
 
+    struct Options {
+        // Persistent connections with no traffic for this long are closed.
+        std::chrono::milliseconds idle_timeout{60000};
+        // After this many requests the connection is answered with `Connection: close`.
+        size_t max_requests_per_connection = 1000;
+        // Number of epoll loops, each with its own SO_REUSEPORT listener and thread.
+        size_t workers = 1;
+        // Threads running the handler off the loops; 0 runs it inline on the owning loop.
+        // With more than one worker or any handler thread, the handler must be thread-safe.
+        size_t handler_threads = 0;
+    };
+
     HttpWebhookServer(uint16_t port, Handler handler);
+    HttpWebhookServer(uint16_t port, Handler handler, Options options);
     ~HttpWebhookServer();
 
+    /**
+     * @brief Runs the server; the first loop runs on the calling thread until stop()
+     */
     void start();
     void stop();
 
+    /**
+     * @brief Appends the serialized response, so pipelined responses queue up in order
+     */
+    static void buildHttpResponse(const HttpResponse& res, std::string& output);
+
 private:
     struct ClientContext {
+        // One growable buffer per connection; the parser's views point into it. Only the first
+        // input_size bytes are valid, the rest is spare room for the next recv.
         std::string input_buffer;
+        size_t input_size = 0;
+        HttpRequestParser parser;
         std::string output_buffer;
         size_t bytes_written = 0;
+        size_t requests_served = 0;
+        // Distinguishes this connection from a later one that reuses the same fd.
+        uint64_t id = 0;
+        std::chrono::steady_clock::time_point last_activity = std::chrono::steady_clock::now();
+        bool continue_sent = false;
+        bool close_after_flush = false;
+        bool peer_closed = false;
+        // A handler thread is reading input_buffer; the loop must not touch it until it answers.
+        bool in_handler = false;
+        // Reading stopped at a complete or rejected request; the socket may still hold more.
+        bool read_paused = false;
     };
 
-    void setupSocket();
-    void setupEpoll();
-    void handleEvent(struct epoll_event* event);
-    void handleClient(int fd);
-    void closeClient(int fd);
-    void parseHttpRequest(ClientContext& ctx, HttpRequest& req);
-    void buildHttpResponse(const HttpResponse& res, std::string& output);
-
-    int server_fd = -1;
-    int epoll_fd = -1;
-    bool running = false;
+    // A response computed off-loop, posted back to the loop that owns the connection.
+    struct Completion {
+        int fd;
+        uint64_t id;
+        bool keep_alive;
+        HttpResponse response;
+    };
+
+    struct Loop {
+        int server_fd = -1;
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        uint64_t next_id = 0;
+        std::unordered_map<int, ClientContext> clients;
+        std::mutex completed_mutex;
+        std::vector<Completion> completed;
+        std::thread thread;
+    };
+
+    class HandlerPool;
+
+    void setupSocket(Loop& loop);
+    void setupEpoll(Loop& loop);
+    void run(Loop& loop);
+    void handleEvent(Loop& loop, struct epoll_event* event);
+    void handleClient(Loop& loop, int fd, uint32_t events);
+    bool readFromClient(int fd, ClientContext& ctx);
+    void processInput(Loop& loop, int fd, ClientContext& ctx);
+    bool serveInput(Loop& loop, int fd, ClientContext& ctx);
+    void finishRequest(ClientContext& ctx, HttpResponse& res, bool keep_alive);
+    void drainCompleted(Loop& loop);
+    void afterIo(Loop& loop, int fd, ClientContext& ctx);
+    bool flushClient(int fd, ClientContext& ctx);
+    void closeIdleClients(Loop& loop);
+    void closeClient(Loop& loop, int fd);
+
+    std::atomic<bool> running{false};
     uint16_t port;
     Handler request_handler;
-    std::unordered_map<int, ClientContext> clients;
+    Options options;
+    std::vector<std::unique_ptr<Loop>> loops;
+    // Declared after the loops so it is destroyed, and its threads joined, first.
+    std::unique_ptr<HandlerPool> handler_pool;
 };
@@ -0,0 +1,77 @@
+// interaction_reply.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include "metrics.hpp"
+#include "rest_api.hpp"
+
+namespace app
+{
+    /**
+     * @brief Answers a slash command with as few interaction callbacks as possible
+     *
+     * Discord wants an interaction acknowledged within 3 seconds. Deferring straight away costs
+     * an extra REST round trip before the real answer, so instead a deadline is armed when the
+     * command starts: the first message sent before it is the direct reply, and only if nothing
+     * has been sent when it passes is the interaction deferred ("thinking"). Everything after the
+     * acknowledgement edits the original response, in the order it was sent.
+     *
+     * The object is shared with the deadline and the REST callbacks, so it outlives the
+     * interaction's coroutine; it keeps only the ids and token it needs, not the event. It lives
+     * until the final message has been sent, and so does the `until_sent` handle given to start.
+     */
+    class interaction_reply : public std::enable_shared_from_this<interaction_reply>
+    {
+    public:
+        /**
+         * @brief Arms the deferral deadline for an interaction that is about to wait on Discord or run its actions
+         *
+         * @param until_sent Released once the final message is sent, e.g. to count the interaction as in flight
+         */
+        static std::shared_ptr<interaction_reply> start(const dpp::slashcommand_t &event, const metrics::interaction_timer &timer, std::shared_ptr<rest_api> rest, std::shared_ptr<void> until_sent = nullptr);
+
+        /**
+         * @brief Shows an intermediate message, such as a progress report
+         */
+        void update(const std::string &content);
+
+        /**
+         * @brief Shows the final message; later calls are ignored
+         */
+        void finish(const std::string &content);
+
+        interaction_reply(std::shared_ptr<rest_api> rest, uint64_t bot, dpp::snowflake id, const std::string &token, const metrics::interaction_timer &timer, std::shared_ptr<void> until_sent = nullptr);
+
+    private:
+        enum class state
+        {
+            pending,
+            acknowledging,
+            acknowledged
+        };
+
+        void send(const std::string &content, bool final);
+        void defer();
+        void acknowledged();
+        void edit(const std::string &content, bool final);
+
+        const std::shared_ptr<rest_api> rest;
+        // The bot's user id, for logs and metrics.
+        const uint64_t bot;
+        const dpp::snowflake id;
+        const std::string token;
+        const metrics::interaction_timer timer;
+        const std::shared_ptr<void> until_sent;
+
+        std::mutex mutex;
+        state current = state::pending;
+        bool finished = false;
+        // The latest message sent while the acknowledgement was in flight; earlier ones are superseded.
+        std::optional<std::string> queued;
+        bool queued_final = false;
+    };
+} // namespace app
@@ -0,0 +1,130 @@
+// key_values.hpp
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace app
+{
+    /**
+     * @brief A placeholder key interned once, e.g. `userName` or `opts.target.avatar`
+     */
+    using key_id = uint32_t;
+
+    constexpr key_id no_key = UINT32_MAX;
+
+    /**
+     * @brief Interns a placeholder key, for code that runs when a config loads
+     *
+     * Ids are process-wide and never released: the set of keys is bounded by the configs'
+     * vocabulary, not by traffic, and capped at max_keys so a stream of configs with ever new
+     * names cannot grow it without end.
+     *
+     * @throws std::length_error when max_keys keys are interned already and key is a new one
+     */
+    key_id intern_key(std::string_view key);
+
+    // Distinct keys the process interns at most, across every bot and config it has loaded.
+    constexpr size_t max_keys = 1 << 20;
+
+    /**
+     * @brief The id of a key that has already been interned, or no_key; never allocates an id
+     */
+    key_id find_key(std::string_view key);
+
+    /**
+     * @brief The placeholder values of one interaction
+     *
+     * Values are copied into an arena that starts inside the object itself and only falls back to
+     * the heap for unusually large interactions; entries are a flat array scanned by key id. Keep
+     * it a local of the interaction's coroutine: everything it allocated goes away in one step
+     * with the coroutine frame, with no allocation or free per key.
+     *
+     * A map may be layered on a base map it does not own, e.g. an action's inputs on top of the
+     * interaction's values: lookups fall through to the base when the key isn't set here.
+     */
+    class key_values
+    {
+    public:
+        explicit key_values(const key_values *base = nullptr);
+        key_values(const key_values &) = delete;
+        key_values &operator=(const key_values &) = delete;
+
+        /**
+         * @brief Sets a key to a copy of value; a later set of the same key wins. Ignores no_key.
+         */
+        void set(key_id key, std::string_view value);
+
+        /**
+         * @brief Sets a key to a number, formatted as std::to_string would
+         */
+        template <typename T>
+            requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+        void set_number(key_id key, T value)
+        {
+            if (key == no_key)
+            {
+                return;
+            }
+            // Enough for any 64-bit integer and for a double in std::to_string's fixed notation.
+            std::array<char, 320> buffer;
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value, std::chars_format::fixed, 6);
+                if (result.ec != std::errc())
+                {
+                    // Too long in fixed notation (a long double, say): the shortest form always fits.
+                    result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+                }
+            }
+            else
+            {
+                result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            }
+            if (result.ec != std::errc())
+            {
+                return;
+            }
+            set(key, std::string_view(buffer.data(), static_cast<size_t>(result.ptr - buffer.data())));
+        }
+
+        /**
+         * @return const std::string_view* The value, or nullptr when neither this map nor its base has the key
+         */
+        const std::string_view *find(key_id key) const;
+
+        /**
+         * @brief The number of values set on this map, not counting its base
+         */
+        size_t size() const { return entries.size(); }
+
+        /**
+         * @brief The map's arena, for scratch strings that should die with it
+         */
+        std::pmr::memory_resource *arena() { return &memory; }
+
+    private:
+        struct entry
+        {
+            key_id key;
+            std::string_view value;
+        };
+
+        // Comfortably holds the entries and values of a typical command.
+        static constexpr size_t inline_bytes = 2048;
+        static constexpr size_t reserved_entries = 24;
+
+        alignas(std::max_align_t) std::array<std::byte, inline_bytes> buffer;
+        std::pmr::monotonic_buffer_resource memory{buffer.data(), buffer.size()};
+        std::pmr::vector<entry> entries{&memory};
+        const key_values *base;
+    };
+} // namespace app
@@ -0,0 +1,94 @@
+// log.hpp
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace app::log
+{
+    enum class level : uint8_t
+    {
+        trace,
+        debug,
+        info,
+        warning,
+        error,
+        critical,
+        off
+    };
+
+    /**
+     * @brief Who a record is about; empty fields are left out of the line
+     */
+    struct fields
+    {
+        uint64_t bot = 0;
+        uint64_t guild = 0;
+        std::string_view command{};
+    };
+
+    namespace detail
+    {
+        inline std::atomic<level> threshold{level::info};
+    }
+
+    /**
+     * @brief Whether records at this level are kept; a single relaxed load
+     *
+     * Guard any message that needs formatting with it, so disabled levels cost nothing.
+     */
+    inline bool enabled(level lvl)
+    {
+        return lvl >= detail::threshold.load(std::memory_order_relaxed);
+    }
+
+    void set_level(level lvl);
+    level get_level();
+
+    /**
+     * @brief Parses trace, debug, info, warning, error, critical or off
+     */
+    std::optional<level> level_from_string(std::string_view name);
+
+    /**
+     * @brief Queues a record for the writer thread without blocking
+     *
+     * The record is copied into a fixed-size slot of a lock-free ring buffer; overly long
+     * messages are truncated. When the ring is full the record is dropped and counted, and the
+     * writer reports how many were lost.
+     */
+    void write(level lvl, const fields &where, std::string_view message);
+
+    /**
+     * @brief Writes out everything queued so far, on the calling thread
+     */
+    void flush();
+
+    inline void trace(const fields &where, std::string_view message)
+    {
+        if (enabled(level::trace))
+            write(level::trace, where, message);
+    }
+    inline void debug(const fields &where, std::string_view message)
+    {
+        if (enabled(level::debug))
+            write(level::debug, where, message);
+    }
+    inline void info(const fields &where, std::string_view message)
+    {
+        if (enabled(level::info))
+            write(level::info, where, message);
+    }
+    inline void warning(const fields &where, std::string_view message)
+    {
+        if (enabled(level::warning))
+            write(level::warning, where, message);
+    }
+    inline void error(const fields &where, std::string_view message)
+    {
+        if (enabled(level::error))
+            write(level::error, where, message);
+    }
+} // namespace app::log
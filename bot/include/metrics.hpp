@@ -0,0 +1,115 @@
+// metrics.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace app::metrics
+{
+    using clock = std::chrono::steady_clock;
+
+    // Writers are spread over this many cache-line sized stripes, one per thread in practice,
+    // so recording never contends and never takes a lock; render() sums the stripes.
+    inline constexpr size_t stripes = 8;
+
+    /**
+     * @brief Latency histogram with fixed buckets, from 1ms up to past the 15 minute interaction lifetime
+     */
+    class histogram
+    {
+    public:
+        // Upper bounds in microseconds. 3s is Discord's deadline for the first response.
+        static constexpr std::array<uint64_t, 19> bounds_us = {
+            1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+            1000000, 1500000, 2000000, 2500000, 3000000, 5000000, 10000000, 30000000, 60000000, 900000000};
+
+        void observe(clock::duration elapsed);
+        void observe_since(clock::time_point start) { observe(clock::now() - start); }
+
+        struct snapshot
+        {
+            std::array<uint64_t, bounds_us.size() + 1> buckets{}; // Not cumulative; the last one is +Inf
+            uint64_t count = 0;
+            uint64_t sum_us = 0;
+        };
+        snapshot read() const;
+
+    private:
+        struct alignas(64) stripe
+        {
+            std::array<std::atomic<uint64_t>, bounds_us.size() + 1> buckets{};
+            std::atomic<uint64_t> sum_us{0};
+        };
+        std::array<stripe, stripes> data;
+    };
+
+    class counter
+    {
+    public:
+        void add(uint64_t n = 1);
+        uint64_t read() const;
+
+    private:
+        struct alignas(64) stripe
+        {
+            std::atomic<uint64_t> value{0};
+        };
+        std::array<stripe, stripes> data;
+    };
+
+    /**
+     * @brief Times one interaction; cheap to copy into REST callbacks
+     *
+     * The histograms live for the whole process, so a copy stays valid after the interaction's
+     * coroutine has returned.
+     */
+    struct interaction_timer
+    {
+        clock::time_point start = clock::now();
+        histogram *ack = nullptr;
+        histogram *response = nullptr;
+
+        /**
+         * @brief The interaction was acknowledged: replied to or deferred
+         */
+        void acked() const { ack->observe_since(start); }
+
+        /**
+         * @brief The final response is visible: the reply, or the last edit_response
+         */
+        void responded() const { response->observe_since(start); }
+    };
+
+    // Every series carries a `bot` label with the bot's user id: in host mode one process serves many bots.
+
+    /**
+     * @brief Starts timing an interaction for the given command
+     */
+    interaction_timer start_interaction(uint64_t bot, std::string_view command);
+
+    histogram &action_duration(uint64_t bot, std::string_view action);
+
+    /**
+     * @brief Counts one REST call made while answering an interaction, and whether Discord answered with an error
+     */
+    void rest_call(uint64_t bot, std::string_view action, bool error);
+
+    /**
+     * @brief Counts an interaction refused by admission control or during a drain
+     */
+    void interaction_rejected(uint64_t bot, std::string_view command);
+
+    /**
+     * @brief Records an `update`: how long the command table took to build and how many commands it holds
+     */
+    void config_reloaded(uint64_t bot, clock::duration elapsed, size_t commands);
+
+    /**
+     * @brief Every metric in the Prometheus text exposition format, served at GET /metrics
+     */
+    std::string render();
+} // namespace app::metrics
@@ -0,0 +1,82 @@
+// permission_cache.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <array>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace app
+{
+    /**
+     * @brief Computed channel permissions per (guild, channel, member), read from the DPP cache
+     *
+     * Permissions are computed from the cached guild, channel and member without copying the guild
+     * or channel, and the resulting bitmask is remembered until a role, channel, member or guild update
+     * for that guild invalidates it. The DPP cache is process-wide, so is this one; every cluster
+     * feeding it events must be attached.
+     */
+    class permission_cache
+    {
+    public:
+        static permission_cache &instance();
+
+        /**
+         * @brief Subscribes to the events that invalidate cached permissions
+         */
+        void attach(dpp::cluster &cluster);
+
+        /**
+         * @brief Permissions of a member in a channel, including overwrites
+         *
+         * @param guild_id The guild the channel belongs to
+         * @param channel_id The channel to check
+         * @param member_id The member to check
+         * @param fallback Used when the member is not in the cache, e.g. the interaction's own member; such results are not cached
+         * @return std::optional<dpp::permission> The permissions, or nothing when the guild, channel
+         * or member is not cached
+         */
+        std::optional<dpp::permission> channel_permissions(dpp::snowflake guild_id, dpp::snowflake channel_id, dpp::snowflake member_id, const dpp::guild_member *fallback = nullptr);
+
+        void invalidate_guild(dpp::snowflake guild_id);
+        void invalidate_channel(dpp::snowflake guild_id, dpp::snowflake channel_id);
+        void invalidate_member(dpp::snowflake guild_id, dpp::snowflake member_id);
+        void clear();
+
+    private:
+        struct entry_key
+        {
+            dpp::snowflake channel_id;
+            dpp::snowflake member_id;
+            bool operator==(const entry_key &other) const = default;
+        };
+
+        struct entry_key_hash
+        {
+            size_t operator()(const entry_key &key) const
+            {
+                return std::hash<uint64_t>()(uint64_t(key.channel_id) * 0x9E3779B97F4A7C15ull ^ uint64_t(key.member_id));
+            }
+        };
+
+        using guild_entries = std::unordered_map<entry_key, uint64_t, entry_key_hash>;
+
+        // Sharded by guild so lookups in unrelated guilds never contend on one lock.
+        struct shard
+        {
+            std::shared_mutex mutex;
+            std::unordered_map<dpp::snowflake, guild_entries> guilds;
+            // Bumped by every invalidation, so a permission computed across one isn't stored.
+            uint64_t generation = 0;
+        };
+
+        static constexpr size_t shard_count = 16;
+        // A guild's entries are dropped wholesale past this size rather than tracked by age.
+        static constexpr size_t max_entries_per_guild = 4096;
+
+        shard &shard_for(dpp::snowflake guild_id) { return shards[uint64_t(guild_id) % shard_count]; }
+
+        std::array<shard, shard_count> shards;
+    };
+} // namespace app
@@ -0,0 +1,130 @@
+// placeholder_set.hpp
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "key_values.hpp"
+
+namespace app
+{
+    /**
+     * @brief The built-in placeholders generate_key_values knows how to compute
+     */
+    enum class builtin_key : uint8_t
+    {
+        command_name,
+        command_id,
+        command_type,
+        user_name,
+        user_id,
+        user_avatar,
+        guild_name,
+        channel_name,
+        channel_id,
+        channel_type,
+        guild_id,
+        guild_icon,
+        guild_count,
+        guild_owner,
+        guild_created_at,
+        guild_boost_tier,
+        guild_boost_count,
+        count
+    };
+
+    /**
+     * @brief The per-option placeholders, `opts.<name>` and `opts.<name>.<field>`
+     */
+    enum class option_field : uint8_t
+    {
+        value,
+        id,
+        avatar,
+        discriminator,
+        bot,
+        created_at,
+        type,
+        color,
+        hoist,
+        position,
+        nick,
+        joined_at,
+        filename,
+        size,
+        count
+    };
+
+    /**
+     * @brief The interned key of a built-in placeholder
+     */
+    key_id builtin_key_id(builtin_key key);
+
+    /**
+     * @brief The interned keys of one option's fields, no_key for the fields nobody references
+     */
+    using option_keys = std::array<key_id, static_cast<size_t>(option_field::count)>;
+
+    /**
+     * @brief The set of placeholders a command can reference, worked out once when the config loads
+     *
+     * generate_key_values only computes the keys in this set, so an interaction whose templates
+     * use two placeholders does not pay for avatar URLs, guild icons and every option field.
+     */
+    class placeholder_set
+    {
+    public:
+        placeholder_set() = default;
+
+        /**
+         * @brief A set that wants every placeholder, for callers without a compiled command
+         */
+        static placeholder_set all();
+
+        /**
+         * @brief Adds a placeholder key such as `userName` or `opts.target.avatar`
+         *
+         * Keys that generate_key_values never produces are ignored.
+         */
+        void add(std::string_view key);
+
+        bool wants(builtin_key key) const
+        {
+            return all_ || (builtins_ & (1u << static_cast<uint8_t>(key)));
+        }
+
+        /**
+         * @brief Whether any field of the option with this name is referenced
+         */
+        bool wants_option(const std::string &name) const
+        {
+            return all_ || options_.count(name);
+        }
+
+        bool wants_option(const std::string &name, option_field field) const;
+
+        /**
+         * @brief The keys of the option's wanted fields, interned when the set was built
+         *
+         * A set made by all() interns the option's keys on the spot instead.
+         */
+        option_keys keys_of(const std::string &name) const;
+
+        bool empty() const { return !all_ && builtins_ == 0 && options_.empty(); }
+
+    private:
+        bool all_ = false;
+        uint32_t builtins_ = 0;
+        struct option_entry
+        {
+            // Bitmask of option_field
+            uint32_t fields = 0;
+            option_keys keys;
+        };
+
+        // Option name → the fields referenced and their keys
+        std::unordered_map<std::string, option_entry> options_;
+    };
+} // namespace app
@@ -0,0 +1,48 @@
+// presence_scheduler.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <memory>
+#include <string_view>
+
+namespace app
+{
+    /**
+     * @brief Paces a bot's presence updates to what the gateway accepts, keeping only the latest
+     *
+     * Every presence update is sent on every shard, and each connection only takes a limited
+     * number of gateway commands per minute. Requests are therefore never sent from the caller's
+     * thread: the first one in an interval goes out straight away from the deadline queue, the
+     * ones after it wait for the next slot, and a request arriving while another is waiting
+     * replaces it, so the stale one is never sent.
+     */
+    class presence_scheduler
+    {
+    public:
+        enum class outcome
+        {
+            // Its slot is now: handed to the deadline queue, which sends it right away. The send itself
+            // is logged by the flush, since it happens after request() returned.
+            queued,
+            // Goes out at the next slot.
+            scheduled,
+            // Replaced a presence that was waiting for its slot.
+            coalesced
+        };
+
+        explicit presence_scheduler(dpp::cluster &bot);
+        // Pending presences are dropped; a flush already running finishes first.
+        ~presence_scheduler();
+
+        presence_scheduler(const presence_scheduler &) = delete;
+        presence_scheduler &operator=(const presence_scheduler &) = delete;
+
+        outcome request(const dpp::presence &presence);
+
+        static std::string_view outcome_name(outcome result);
+
+    private:
+        struct state;
+        std::shared_ptr<state> shared;
+    };
+} // namespace app
@@ -0,0 +1,70 @@
+// response_template.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "key_values.hpp"
+
+namespace app
+{
+    /**
+     * @brief A response string compiled once into literal spans and placeholder groups
+     *
+     * Placeholders use the same syntax as app::update_string: ((key)) or ((a|b|c)),
+     * where the first key found in the value map wins and a group with no match
+     * renders as an empty string.
+     */
+    class response_template
+    {
+    public:
+        response_template() = default;
+
+        /**
+         * @brief Compiles a template from its source string
+         *
+         * @param source The string with placeholders in the format ((key)) or ((a|b|c))
+         */
+        explicit response_template(std::string source);
+
+        /**
+         * @brief Renders the template in a single pass into one reserved buffer
+         *
+         * @param values The interaction's placeholder values
+         * @return std::string The rendered string
+         */
+        std::string render(const key_values &values) const;
+
+        /**
+         * @brief The original, uncompiled template string
+         */
+        const std::string &source() const { return source_; }
+
+        /**
+         * @brief Every key referenced by the template, in order of appearance
+         */
+        const std::vector<std::string> &keys() const { return keys_; }
+
+        bool empty() const { return source_.empty(); }
+
+    private:
+        // A literal span source_[offset, offset + length), or, for a placeholder,
+        // a fallback group made of keys_[offset, offset + length).
+        struct segment
+        {
+            bool placeholder = false;
+            uint32_t offset = 0;
+            uint32_t length = 0;
+        };
+
+        void compile();
+
+        std::string source_;
+        std::vector<segment> segments_;
+        std::vector<std::string> keys_;
+        // keys_, interned when the template compiles.
+        std::vector<key_id> key_ids_;
+        size_t literal_size_ = 0;
+        size_t placeholder_count_ = 0;
+    };
+} // namespace app
@@ -0,0 +1,44 @@
+// rest_api.hpp
+#pragma once
+
+#include <dpp/dpp.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace app
+{
+    /**
+     * @brief The Discord REST calls a bot makes while answering interactions
+     *
+     * Same names and arguments as the dpp::cluster methods they stand for. Production bots use
+     * for_cluster(), which forwards to the cluster unchanged; the replay harness substitutes a
+     * local stub so whole command configs can be exercised without a network.
+     */
+    class rest_api
+    {
+    public:
+        using completion = dpp::command_completion_event_t;
+
+        virtual ~rest_api() = default;
+
+        virtual void interaction_response_create(dpp::snowflake interaction_id, const std::string &token, const dpp::interaction_response &response, completion callback) = 0;
+        virtual void interaction_response_edit(const std::string &token, const dpp::message &message, completion callback) = 0;
+        virtual void messages_get(dpp::snowflake channel_id, dpp::snowflake around, dpp::snowflake before, dpp::snowflake after, uint64_t limit, completion callback) = 0;
+        virtual void message_delete(dpp::snowflake message_id, dpp::snowflake channel_id, completion callback) = 0;
+        virtual void message_delete_bulk(const std::vector<dpp::snowflake> &message_ids, dpp::snowflake channel_id, completion callback) = 0;
+        virtual void guild_get(dpp::snowflake guild_id, completion callback) = 0;
+        virtual void channel_get(dpp::snowflake channel_id, completion callback) = 0;
+
+        dpp::async<dpp::confirmation_callback_t> co_messages_get(dpp::snowflake channel_id, dpp::snowflake around, dpp::snowflake before, dpp::snowflake after, uint64_t limit);
+        dpp::async<dpp::confirmation_callback_t> co_message_delete(dpp::snowflake message_id, dpp::snowflake channel_id);
+        dpp::async<dpp::confirmation_callback_t> co_message_delete_bulk(const std::vector<dpp::snowflake> &message_ids, dpp::snowflake channel_id);
+        dpp::async<dpp::confirmation_callback_t> co_guild_get(dpp::snowflake guild_id);
+        dpp::async<dpp::confirmation_callback_t> co_channel_get(dpp::snowflake channel_id);
+
+        /**
+         * @brief The real thing: every call goes to the cluster's REST queue
+         */
+        static std::shared_ptr<rest_api> for_cluster(dpp::cluster &bot);
+    };
+} // namespace app
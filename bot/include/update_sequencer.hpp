@@ -0,0 +1,60 @@
+// update_sequencer.hpp
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace app
+{
+    /**
+     * @brief Applies a bot's config changes in the order their webhook bodies arrived
+     *
+     * Bodies are handled on several threads, so a large `update` that arrived first can finish
+     * compiling after a small one that arrived later. Every body takes a ticket on arrival. A full
+     * replacement is only published if no body that arrived after it has been published yet, and
+     * an amendment (a `patch`, which builds on the current table) first waits for every body that
+     * arrived before it to be done, so it is never based on a table about to be replaced.
+     */
+    class update_sequencer
+    {
+    public:
+        // Kept while its body is handled; amendments that arrived later wait until it is destroyed.
+        struct ticket
+        {
+            uint64_t number = 0;
+            std::shared_ptr<void> release;
+        };
+
+        ticket arrive();
+
+        /**
+         * @brief Runs publish under the lock, unless a body that arrived after t was published already
+         *
+         * @return Whether publish ran; if not, what it would have published is older than the current config
+         */
+        bool replace(const ticket &t, const std::function<void()> &publish);
+
+        /**
+         * @brief Waits for every body that arrived before t, then runs apply under the lock like replace
+         *
+         * @return Whether apply ran; if not, a newer full replacement superseded the amendment
+         */
+        bool amend(const ticket &t, const std::function<void()> &apply);
+
+        // Held by replace and amend while they run; take it to read or store the table consistently with them.
+        std::mutex &mutex() { return lock; }
+
+    private:
+        std::mutex lock;
+        std::condition_variable released;
+        uint64_t next = 0;
+        // The latest ticket whose change was applied.
+        uint64_t published = 0;
+        // Tickets still held, i.e. bodies still being handled.
+        std::set<uint64_t> pending;
+    };
+} // namespace app
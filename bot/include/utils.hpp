@@ -7,9 +7,12 @@
 #include <dpp/nlohmann/json.hpp>
 #include <map>
 #include <string>
+#include <string_view>
 #include <regex>
 #include <sstream>
 #include <algorithm>
+#include "key_values.hpp"
+#include "placeholder_set.hpp"
 using namespace dpp;
 namespace app
 {
@@ -40,21 +43,31 @@ namespace app
     std::string update_string(const std::string &initial, const std::unordered_map<std::string, std::string> &updates);
 
     /**
-     * @brief Processes a command option recursively and adds values to the key-value map
+     * @brief Processes a command option recursively and adds its values to the interaction's map
      *
      * @param event The slash command event
      * @param option The command option to process
-     * @param kv The key-value map to update
+     * @param kv The interaction's placeholder values
+     * @param wanted The placeholders to compute; fields outside this set are skipped
      */
-    void process_interaction_option(const slashcommand_t &event, const command_data_option &option, std::unordered_map<std::string, std::string> &kv);
+    void process_interaction_option(const slashcommand_t &event, const command_data_option &option, key_values &kv, const placeholder_set &wanted);
 
     /**
-     * @brief Generates a map of key-value pairs from a slash command event
+     * @brief Fills an interaction's placeholder values from a slash command event
      *
      * @param event The slash command event
-     * @return std::map<std::string, std::string> A map containing information about the command, user, guild, and options
+     * @param kv The map to fill, usually a local of the interaction's coroutine
+     * @param wanted The placeholders to compute, usually the ones referenced by the command's config
      */
-    std::unordered_map<std::string, std::string> generate_key_values(const slashcommand_t &event);
+    void generate_key_values(const slashcommand_t &event, key_values &kv, const placeholder_set &wanted = placeholder_set::all());
+
+    /**
+     * @brief Same as above with the guild and channel supplied by the caller, e.g. fetched over REST
+     *
+     * @param g The interaction's guild, or nullptr to report it as a DM
+     * @param channel_ptr The interaction's channel, or nullptr to report it as a DM
+     */
+    void generate_key_values(const slashcommand_t &event, key_values &kv, const placeholder_set &wanted, const guild *g, const channel *channel_ptr);
 
     /**
      * @brief Handles actions specified in the slash command event
@@ -71,7 +84,7 @@ namespace app
      * @param str The JSON string to parse
      * @return nlohmann::json The parsed JSON object
      */
-    nlohmann::json json_from_string(const std::string &str);
+    nlohmann::json json_from_string(std::string_view str);
 
     /**
      * @brief Converts a JSON object into a string
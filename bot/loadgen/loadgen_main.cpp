@@ -0,0 +1,510 @@
+// loadgen_main.cpp
+// bot-loadgen: drives a bot's control port with many concurrent keep-alive connections.
+//
+// Usage: bot-loadgen --port <port> [--host <ipv4>] [--path <path>] [--connections <n>] [--threads <n>]
+//                    [--duration-s <s>] [--body-size <bytes, e.g. 1K, 10M>] [--status-ratio <0..1>]
+//                    [--pid <server pid>] [--json]
+//
+// Start the target with `discord-bot --offline <port>` (or `--host <port>` with --path /bots/<token>)
+// so no gateway connection is involved. Each connection sends its next request as soon as the
+// previous answer is in, mixing `update` bodies of --body-size with small `update_status` bodies.
+// With --pid the server's resident memory is sampled during the run, which is where the growth of
+// its per-connection state (the `clients` map and its buffers) shows up.
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dpp/nlohmann/json.hpp>
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct options
+    {
+        std::string host = "127.0.0.1";
+        uint16_t port = 0;
+        std::string path = "/";
+        size_t connections = 64;
+        size_t threads = 1;
+        double duration_s = 10;
+        size_t body_size = 1024;
+        double status_ratio = 0.5;                   // Share of requests that are `update_status` instead of `update`
+        int pid = 0;
+        bool json = false;
+    };
+
+    struct thread_result
+    {
+        std::vector<uint32_t> latencies_us;
+        uint64_t requests = 0;
+        uint64_t errors = 0;                         // Non-2xx answers
+        uint64_t failures = 0;                       // Connections refused or reset mid-request
+        uint64_t reconnects = 0;
+        uint64_t bytes_sent = 0;
+    };
+
+    struct connection
+    {
+        int fd = -1;
+        std::string request;
+        size_t written = 0;
+        std::string response;
+        clock::time_point sent_at;
+        bool busy = false;
+    };
+
+    size_t parse_size(const std::string &text)
+    {
+        size_t multiplier = 1;
+        std::string digits = text;
+        char suffix = text.empty() ? '\0' : static_cast<char>(std::toupper(static_cast<unsigned char>(text.back())));
+        if (suffix == 'K' || suffix == 'M')
+        {
+            multiplier = suffix == 'K' ? 1024 : 1024 * 1024;
+            digits.pop_back();
+        }
+        return std::stoul(digits) * multiplier;
+    }
+
+    // An `update` whose body is about `size` bytes: as many plain commands as it takes.
+    std::string update_body(size_t size)
+    {
+        nlohmann::json data = nlohmann::json::object();
+        std::string filler(160, 'x');
+        size_t approx = 32;
+        for (size_t i = 0; approx < size; ++i)
+        {
+            std::string name = "cmd" + std::to_string(i);
+            data[name] = {{"response", "((userName)) used " + name + " in ((channelName)): ((opts.reason)) " + filler}};
+            approx += name.size() + filler.size() + 70;
+        }
+        return nlohmann::json{{"command", "update"}, {"data", std::move(data)}}.dump();
+    }
+
+    std::string status_body()
+    {
+        return R"({"command": "update_status", "status": "online", "activity": "loadgen", "activity_type": "playing"})";
+    }
+
+    std::string http_request(const options &opts, const std::string &body)
+    {
+        return "POST " + opts.path + " HTTP/1.1\r\nHost: " + opts.host + "\r\nContent-Type: application/json\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+
+    long rss_kb(int pid)
+    {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.rfind("VmRSS:", 0) == 0)
+            {
+                return std::stol(line.substr(6));
+            }
+        }
+        return 0;
+    }
+
+    // Parses one complete response at the front of buffer; returns its length, or 0 if more bytes are needed.
+    size_t complete_response(const std::string &buffer, int &status, bool &close)
+    {
+        size_t header_end = buffer.find("\r\n\r\n");
+        if (header_end == std::string::npos)
+        {
+            return 0;
+        }
+        std::string head = buffer.substr(0, header_end);
+        std::transform(head.begin(), head.end(), head.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        status = head.size() > 12 ? std::atoi(head.c_str() + 9) : 0;
+        close = head.find("\r\nconnection: close") != std::string::npos;
+        size_t length = 0;
+        size_t cl = head.find("\r\ncontent-length:");
+        if (cl != std::string::npos)
+        {
+            length = std::strtoul(head.c_str() + cl + 17, nullptr, 10);
+        }
+        size_t total = header_end + 4 + length;
+        return buffer.size() >= total ? total : 0;
+    }
+
+    class client_loop
+    {
+    public:
+        client_loop(const options &opts, size_t connections, const std::string &update, const std::string &status, uint64_t seed)
+            : opts(opts), conns(connections), update(update), status(status), random(seed)
+        {
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        }
+
+        ~client_loop()
+        {
+            for (auto &c : conns)
+            {
+                if (c.fd >= 0)
+                {
+                    ::close(c.fd);
+                }
+            }
+            ::close(epoll_fd);
+        }
+
+        thread_result run(clock::time_point stop_at)
+        {
+            deadline = stop_at;
+            for (size_t i = 0; i < conns.size(); ++i)
+            {
+                open(i);
+                send_next(i);
+            }
+            std::vector<epoll_event> events(256);
+            size_t busy = conns.size();
+            while (busy > 0)
+            {
+                bool stopping = clock::now() >= deadline;
+                int n = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), 100);
+                for (int e = 0; e < n; ++e)
+                {
+                    size_t index = events[e].data.u64;
+                    if (events[e].events & EPOLLOUT)
+                    {
+                        write_some(index);
+                    }
+                    if (events[e].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                    {
+                        read_some(index, stopping);
+                    }
+                }
+                busy = std::count_if(conns.begin(), conns.end(), [](const connection &c)
+                                     { return c.busy; });
+                // Stragglers get five seconds after the deadline, then they count as failures.
+                if (stopping && clock::now() >= deadline + std::chrono::seconds(5))
+                {
+                    result.failures += busy;
+                    break;
+                }
+            }
+            return std::move(result);
+        }
+
+    private:
+        void open(size_t index)
+        {
+            connection &c = conns[index];
+            c.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int one = 1;
+            setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(opts.port);
+            inet_pton(AF_INET, opts.host.c_str(), &address.sin_addr);
+            ::connect(c.fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+            epoll_event ev{};
+            // Edge triggered: a connection waiting for its answer doesn't report writability on every wait.
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+            ev.data.u64 = index;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c.fd, &ev);
+        }
+
+        void reopen(size_t index)
+        {
+            connection &c = conns[index];
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr);
+            ::close(c.fd);
+            ++result.reconnects;
+            open(index);
+        }
+
+        void send_next(size_t index)
+        {
+            connection &c = conns[index];
+            bool is_status = std::uniform_real_distribution<double>(0, 1)(random) < opts.status_ratio;
+            c.request = is_status ? status : update;
+            c.written = 0;
+            c.response.clear();
+            c.busy = true;
+            c.sent_at = clock::now();
+            write_some(index);
+        }
+
+        void write_some(size_t index)
+        {
+            connection &c = conns[index];
+            while (c.busy && c.written < c.request.size())
+            {
+                ssize_t n = ::send(c.fd, c.request.data() + c.written, c.request.size() - c.written, MSG_NOSIGNAL);
+                if (n < 0)
+                {
+                    if (errno == EAGAIN || errno == EINTR || errno == ENOTCONN)
+                    {
+                        return;
+                    }
+                    fail(index);
+                    return;
+                }
+                c.written += n;
+                result.bytes_sent += n;
+            }
+        }
+
+        void read_some(size_t index, bool stopping)
+        {
+            connection &c = conns[index];
+            char buffer[16384];
+            while (true)
+            {
+                ssize_t n = ::recv(c.fd, buffer, sizeof(buffer), 0);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                {
+                    if (c.busy)
+                    {
+                        fail(index);
+                    }
+                    return;
+                }
+                if (n < 0)
+                {
+                    return;
+                }
+                c.response.append(buffer, n);
+                int status_code = 0;
+                bool close = false;
+                if (c.busy && complete_response(c.response, status_code, close) > 0)
+                {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - c.sent_at).count();
+                    result.latencies_us.push_back(static_cast<uint32_t>(std::min<int64_t>(elapsed, UINT32_MAX)));
+                    ++result.requests;
+                    if (status_code < 200 || status_code >= 300)
+                    {
+                        ++result.errors;
+                    }
+                    c.busy = false;
+                    if (stopping)
+                    {
+                        return;
+                    }
+                    // The server caps requests per connection and then answers `Connection: close`.
+                    if (close)
+                    {
+                        reopen(index);
+                    }
+                    send_next(index);
+                    return;
+                }
+            }
+        }
+
+        void fail(size_t index)
+        {
+            ++result.failures;
+            conns[index].busy = false;
+            reopen(index);
+            if (clock::now() < deadline)
+            {
+                send_next(index);
+            }
+        }
+
+        const options &opts;
+        std::vector<connection> conns;
+        const std::string &update;
+        const std::string &status;
+        std::mt19937_64 random;
+        int epoll_fd = -1;
+        clock::time_point deadline;
+        thread_result result;
+    };
+
+    double percentile(const std::vector<uint32_t> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+    }
+
+    int usage(const char *name)
+    {
+        std::cerr << "Usage: " << name << " --port <port> [--host <ipv4>] [--path <path>] [--connections <n>] [--threads <n>]"
+                  << " [--duration-s <s>] [--body-size <bytes, e.g. 1K, 10M>] [--status-ratio <0..1>] [--pid <server pid>] [--json]" << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options opts;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json")
+        {
+            opts.json = true;
+        }
+        else if (arg == "--host" && has_value)
+        {
+            opts.host = argv[++i];
+        }
+        else if (arg == "--port" && has_value)
+        {
+            opts.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--path" && has_value)
+        {
+            opts.path = argv[++i];
+        }
+        else if (arg == "--connections" && has_value)
+        {
+            opts.connections = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            opts.threads = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (arg == "--duration-s" && has_value)
+        {
+            opts.duration_s = std::stod(argv[++i]);
+        }
+        else if (arg == "--body-size" && has_value)
+        {
+            opts.body_size = parse_size(argv[++i]);
+        }
+        else if (arg == "--status-ratio" && has_value)
+        {
+            opts.status_ratio = std::clamp(std::stod(argv[++i]), 0.0, 1.0);
+        }
+        else if (arg == "--pid" && has_value)
+        {
+            opts.pid = std::stoi(argv[++i]);
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+    if (opts.port == 0)
+    {
+        return usage(argv[0]);
+    }
+    opts.threads = std::min(opts.threads, opts.connections);
+
+    const std::string update = http_request(opts, update_body(opts.body_size));
+    const std::string status = http_request(opts, status_body());
+
+    long rss_before = opts.pid ? rss_kb(opts.pid) : 0;
+    std::atomic<long> rss_peak{rss_before};
+    std::atomic<bool> sampling{true};
+    std::thread sampler;
+    if (opts.pid)
+    {
+        sampler = std::thread([&]
+                              {
+                                  while (sampling.load())
+                                  {
+                                      long now = rss_kb(opts.pid);
+                                      if (now > rss_peak.load())
+                                      {
+                                          rss_peak.store(now);
+                                      }
+                                      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                                  } });
+    }
+
+    auto began = clock::now();
+    auto deadline = began + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(opts.duration_s));
+    std::vector<thread_result> results(opts.threads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < opts.threads; ++t)
+    {
+        size_t share = opts.connections / opts.threads + (t < opts.connections % opts.threads ? 1 : 0);
+        threads.emplace_back([&, t, share]
+                             {
+                                 client_loop loop(opts, share, update, status, t + 1);
+                                 results[t] = loop.run(deadline); });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    double wall = std::chrono::duration<double>(clock::now() - began).count();
+    long rss_after = opts.pid ? rss_kb(opts.pid) : 0;
+    sampling.store(false);
+    if (sampler.joinable())
+    {
+        sampler.join();
+    }
+
+    thread_result total;
+    for (auto &r : results)
+    {
+        total.latencies_us.insert(total.latencies_us.end(), r.latencies_us.begin(), r.latencies_us.end());
+        total.requests += r.requests;
+        total.errors += r.errors;
+        total.failures += r.failures;
+        total.reconnects += r.reconnects;
+        total.bytes_sent += r.bytes_sent;
+    }
+    std::sort(total.latencies_us.begin(), total.latencies_us.end());
+
+    nlohmann::json report = {
+        {"connections", opts.connections},
+        {"update_body_bytes", update.size()},
+        {"status_ratio", opts.status_ratio},
+        {"wall_seconds", wall},
+        {"requests", total.requests},
+        {"requests_per_second", static_cast<double>(total.requests) / wall},
+        {"megabytes_per_second", static_cast<double>(total.bytes_sent) / wall / (1024 * 1024)},
+        {"errors", total.errors},
+        {"failures", total.failures},
+        {"reconnects", total.reconnects},
+        {"latency_us", {
+            {"p50", percentile(total.latencies_us, 0.50)},
+            {"p99", percentile(total.latencies_us, 0.99)},
+            {"p999", percentile(total.latencies_us, 0.999)},
+            {"max", total.latencies_us.empty() ? 0.0 : static_cast<double>(total.latencies_us.back())},
+        }},
+    };
+    if (opts.pid)
+    {
+        report["server_rss_kb"] = {{"before", rss_before}, {"peak", rss_peak.load()}, {"after", rss_after}};
+    }
+
+    if (opts.json)
+    {
+        std::cout << report.dump(2) << std::endl;
+    }
+    else
+    {
+        std::cout << std::fixed << std::setprecision(1)
+                  << total.requests << " requests in " << wall << " s over " << opts.connections << " connections: "
+                  << report["requests_per_second"].get<double>() << " req/s, " << report["megabytes_per_second"].get<double>() << " MB/s" << std::endl
+                  << "latency p50 " << percentile(total.latencies_us, 0.50) / 1000 << " ms, p99 " << percentile(total.latencies_us, 0.99) / 1000
+                  << " ms, p999 " << percentile(total.latencies_us, 0.999) / 1000 << " ms" << std::endl
+                  << total.errors << " error answers, " << total.failures << " failed requests, " << total.reconnects << " reconnects" << std::endl;
+        if (opts.pid)
+        {
+            std::cout << "server RSS " << rss_before << " kB before, " << rss_peak.load() << " kB peak, " << rss_after << " kB after" << std::endl;
+        }
+    }
+    return total.failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+// replay_main.cpp
+// bot-replay: feeds recorded interactions through a bot's real slash command handler, offline.
+//
+// Usage: bot-replay --config <commands.json> --interactions <recorded.json> [--count <n>] [--rate <per second>]
+//                   [--concurrency <n>] [--latency-ms <ms>] [--jitter-ms <ms>] [--bucket-limit <n>]
+//                   [--bucket-reset-ms <ms>] [--rest-threads <n>] [--json]
+//
+// The config is what the control plane sends as `data` with `update` (or the whole update body).
+// Recorded interactions are INTERACTION_CREATE payloads, as a JSON array or one per line; each
+// replay gets a fresh id and token so deferral deadlines behave as they would live. REST calls go
+// to stub_rest, so the numbers cover the bot's own work plus simulated Discord latency and rate
+// limits: use them to size bots per host and to compare builds, not as absolute Discord timings.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <dpp/nlohmann/json.hpp>
+#include "stub_rest.hpp"
+#include "../include/bot_instance.hpp"
+#include "../include/log.hpp"
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    struct options
+    {
+        std::string config_path;
+        std::string interactions_path;
+        size_t count = 1000;
+        double rate = 0;                             // Interactions per second; 0 dispatches as fast as concurrency allows
+        size_t concurrency = 64;                     // Interactions in flight at once
+        replay::stub_options rest;
+        bool json = false;
+    };
+
+    // Every interaction in flight; dispatch blocks while it is at the concurrency limit.
+    struct tracker
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t in_flight = 0;
+        size_t errors = 0;
+    };
+
+    nlohmann::json read_json_file(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        return nlohmann::json::parse(content.str());
+    }
+
+    std::vector<nlohmann::json> read_interactions(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        std::vector<nlohmann::json> payloads;
+        auto add = [&payloads](nlohmann::json j)
+        {
+            // Whole gateway frames are accepted too.
+            payloads.push_back(j.contains("d") ? std::move(j["d"]) : std::move(j));
+        };
+        std::string text = content.str();
+        auto first = text.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && text[first] == '[')
+        {
+            for (auto &j : nlohmann::json::parse(text))
+            {
+                add(std::move(j));
+            }
+        }
+        else
+        {
+            std::string line;
+            std::istringstream lines(text);
+            while (std::getline(lines, line))
+            {
+                if (line.find_first_not_of(" \t\r") != std::string::npos)
+                {
+                    add(nlohmann::json::parse(line));
+                }
+            }
+        }
+        if (payloads.empty())
+        {
+            throw std::runtime_error("No interactions in " + path);
+        }
+        return payloads;
+    }
+
+    // A snowflake minted now, so the interaction's age is measured from its replay.
+    std::string fresh_id(uint64_t sequence)
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return std::to_string(((static_cast<uint64_t>(ms) - 1420070400000) << 22) | (sequence & 0x3FFFFF));
+    }
+
+    dpp::task<void> replay_one(app::bot_instance &bot, std::shared_ptr<dpp::slashcommand_t> event, replay::stub_rest &rest, tracker &t, clock::time_point start, uint64_t &latency_us)
+    {
+        try
+        {
+            co_await bot.on_slashcommand(*event);
+        }
+        catch (const std::exception &e)
+        {
+            app::log::warning({}, std::string("Replayed interaction failed: ") + e.what());
+            std::lock_guard lock(t.mutex);
+            ++t.errors;
+        }
+        // The handler returns before its last reply or edit is answered; the interaction is done when that is.
+        rest.when_idle(event->command.token, [&t, start, &latency_us]
+                       {
+                           latency_us = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+                           {
+                               std::lock_guard lock(t.mutex);
+                               --t.in_flight;
+                           }
+                           t.changed.notify_all(); });
+    }
+
+    double percentile(const std::vector<uint64_t> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+        size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+        return static_cast<double>(sorted[index]);
+    }
+
+    int usage(const char *name)
+    {
+        std::cerr << "Usage: " << name << " --config <commands.json> --interactions <recorded.json> [--count <n>] [--rate <per second>]"
+                  << " [--concurrency <n>] [--latency-ms <ms>] [--jitter-ms <ms>] [--bucket-limit <n>] [--bucket-reset-ms <ms>]"
+                  << " [--rest-threads <n>] [--json]" << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    options opts;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json")
+        {
+            opts.json = true;
+        }
+        else if (arg == "--config" && has_value)
+        {
+            opts.config_path = argv[++i];
+        }
+        else if (arg == "--interactions" && has_value)
+        {
+            opts.interactions_path = argv[++i];
+        }
+        else if (arg == "--count" && has_value)
+        {
+            opts.count = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (arg == "--rate" && has_value)
+        {
+            opts.rate = std::stod(argv[++i]);
+        }
+        else if (arg == "--concurrency" && has_value)
+        {
+            opts.concurrency = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (arg == "--latency-ms" && has_value)
+        {
+            opts.rest.latency = std::chrono::microseconds(static_cast<int64_t>(std::stod(argv[++i]) * 1000));
+        }
+        else if (arg == "--jitter-ms" && has_value)
+        {
+            opts.rest.jitter = std::chrono::microseconds(static_cast<int64_t>(std::stod(argv[++i]) * 1000));
+        }
+        else if (arg == "--bucket-limit" && has_value)
+        {
+            opts.rest.bucket_limit = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--bucket-reset-ms" && has_value)
+        {
+            opts.rest.bucket_reset = std::chrono::milliseconds(std::stoul(argv[++i]));
+        }
+        else if (arg == "--rest-threads" && has_value)
+        {
+            opts.rest.threads = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+    if (opts.config_path.empty() || opts.interactions_path.empty())
+    {
+        return usage(argv[0]);
+    }
+
+    nlohmann::json config;
+    std::vector<nlohmann::json> recorded;
+    try
+    {
+        config = read_json_file(opts.config_path);
+        recorded = read_interactions(opts.interactions_path);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    // The token doesn't decode to a bot id, so no snapshot is read or written. The cluster never connects.
+    app::bot_instance bot("replay");
+    auto rest = std::make_shared<replay::stub_rest>(opts.rest);
+    bot.set_rest(rest);
+    bot.handle_command(config.contains("command") ? config : nlohmann::json{{"command", "update"}, {"data", config}});
+
+    tracker t;
+    std::vector<uint64_t> latencies(opts.count, 0);
+    auto interval = opts.rate > 0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / opts.rate)) : clock::duration::zero();
+    auto began = clock::now();
+    auto next = began;
+    for (size_t i = 0; i < opts.count; ++i)
+    {
+        {
+            std::unique_lock lock(t.mutex);
+            t.changed.wait(lock, [&]
+                           { return t.in_flight < opts.concurrency; });
+            ++t.in_flight;
+        }
+        if (interval > clock::duration::zero())
+        {
+            std::this_thread::sleep_until(next);
+            next += interval;
+        }
+
+        nlohmann::json payload = recorded[i % recorded.size()];
+        payload["id"] = fresh_id(i);
+        payload["token"] = "replay-" + std::to_string(i);
+        auto event = std::make_shared<dpp::slashcommand_t>(nullptr, payload.dump());
+        event->command.fill_from_json(&payload);
+        event->owner = &bot.cluster();
+        // Detached: the task finishes on whichever stub thread answers its last REST call.
+        replay_one(bot, std::move(event), *rest, t, clock::now(), latencies[i]);
+    }
+    {
+        std::unique_lock lock(t.mutex);
+        t.changed.wait(lock, [&]
+                       { return t.in_flight == 0; });
+    }
+    double wall = std::chrono::duration<double>(clock::now() - began).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    nlohmann::json report = {
+        {"interactions", opts.count},
+        {"errors", t.errors},
+        {"deferred", rest->deferrals()},
+        {"wall_seconds", wall},
+        {"throughput_per_second", static_cast<double>(opts.count) / wall},
+        {"latency_us", {
+            {"p50", percentile(latencies, 0.50)},
+            {"p90", percentile(latencies, 0.90)},
+            {"p99", percentile(latencies, 0.99)},
+            {"max", static_cast<double>(latencies.back())},
+        }},
+    };
+    report["rest"] = nlohmann::json::object();
+    for (const auto &[route, stats] : rest->stats())
+    {
+        report["rest"][route] = {{"calls", stats.calls}, {"rate_limited", stats.rate_limited}, {"waited_ms", stats.waited.count() / 1000.0}};
+    }
+
+    if (opts.json)
+    {
+        std::cout << report.dump(2) << std::endl;
+    }
+    else
+    {
+        std::cout << std::fixed << std::setprecision(1)
+                  << report["interactions"] << " interactions in " << wall << " s, " << report["throughput_per_second"].get<double>() << "/s, "
+                  << t.errors << " errors, " << rest->deferrals() << " deferred" << std::endl
+                  << "latency p50 " << percentile(latencies, 0.50) / 1000 << " ms, p90 " << percentile(latencies, 0.90) / 1000
+                  << " ms, p99 " << percentile(latencies, 0.99) / 1000 << " ms, max " << static_cast<double>(latencies.back()) / 1000 << " ms" << std::endl;
+        for (const auto &[route, stats] : rest->stats())
+        {
+            std::cout << "  " << std::left << std::setw(22) << route << std::right << std::setw(8) << stats.calls << " calls"
+                      << std::setw(8) << stats.rate_limited << " rate limited, waited " << stats.waited.count() / 1000.0 << " ms" << std::endl;
+        }
+    }
+    return t.errors > 0 ? 1 : 0;
+}
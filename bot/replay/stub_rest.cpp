@@ -0,0 +1,198 @@
+// stub_rest.cpp
+#include "stub_rest.hpp"
+#include <algorithm>
+
+namespace replay
+{
+    namespace
+    {
+        using clock = std::chrono::steady_clock;
+
+        // Discord's epoch, for snowflakes minted by the stub.
+        constexpr uint64_t discord_epoch_ms = 1420070400000;
+
+        dpp::snowflake snowflake_at(std::chrono::system_clock::time_point when, uint64_t sequence)
+        {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(when.time_since_epoch()).count();
+            return ((static_cast<uint64_t>(ms) - discord_epoch_ms) << 22) | (sequence & 0x3FFFFF);
+        }
+
+        // The message a snowflake was minted for, or now when there is no cursor.
+        std::chrono::system_clock::time_point snowflake_time(dpp::snowflake id)
+        {
+            if (id.empty())
+            {
+                return std::chrono::system_clock::now();
+            }
+            return std::chrono::system_clock::time_point(std::chrono::milliseconds((static_cast<uint64_t>(id) >> 22) + discord_epoch_ms));
+        }
+    }
+
+    stub_rest::stub_rest(const stub_options &options) : options(options), random(std::random_device{}()), completions(std::max<size_t>(1, options.threads))
+    {
+    }
+
+    void stub_rest::call(const std::string &route, const std::string &major, const std::string &token, dpp::confirmable_t value, completion callback, bool limited)
+    {
+        auto now = clock::now();
+        auto start = now;
+        dpp::http_request_completion_t http;
+        std::chrono::microseconds latency;
+        {
+            std::lock_guard lock(mutex);
+            route_stats &stats = routes[route];
+            ++stats.calls;
+            if (limited && options.bucket_limit > 0)
+            {
+                bucket &b = buckets[route + ":" + major];
+                if (now >= b.reset_at)
+                {
+                    b.remaining = options.bucket_limit;
+                    b.reset_at = now + options.bucket_reset;
+                }
+                if (b.remaining == 0)
+                {
+                    // Queued until the bucket resets, as DPP would after reading the headers.
+                    start = b.reset_at;
+                    ++stats.rate_limited;
+                    stats.waited += std::chrono::duration_cast<std::chrono::microseconds>(start - now);
+                    b.remaining = options.bucket_limit;
+                    b.reset_at = start + options.bucket_reset;
+                }
+                --b.remaining;
+                http.ratelimit_bucket = route;
+                http.ratelimit_limit = options.bucket_limit;
+                http.ratelimit_remaining = b.remaining;
+                http.ratelimit_reset_after = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(b.reset_at - start).count());
+                double reset_after = std::chrono::duration<double>(b.reset_at - start).count();
+                http.headers.emplace("x-ratelimit-bucket", route);
+                http.headers.emplace("x-ratelimit-limit", std::to_string(options.bucket_limit));
+                http.headers.emplace("x-ratelimit-remaining", std::to_string(b.remaining));
+                http.headers.emplace("x-ratelimit-reset-after", std::to_string(reset_after));
+            }
+            std::uniform_int_distribution<int64_t> spread(0, options.jitter.count());
+            latency = options.latency + std::chrono::microseconds(spread(random));
+            if (!token.empty())
+            {
+                ++interactions[token].in_flight;
+            }
+        }
+        http.status = std::holds_alternative<dpp::confirmation>(value) ? 204 : 200;
+        http.latency = std::chrono::duration<double>(latency).count();
+
+        completions.schedule(start + latency, [this, token, value = std::move(value), http = std::move(http), callback = std::move(callback)]
+                             {
+                                 if (callback)
+                                 {
+                                     callback(dpp::confirmation_callback_t(nullptr, value, http));
+                                 }
+                                 if (!token.empty())
+                                 {
+                                     finished(token);
+                                 } });
+    }
+
+    void stub_rest::finished(const std::string &token)
+    {
+        std::vector<std::function<void()>> idle;
+        {
+            std::lock_guard lock(mutex);
+            auto it = interactions.find(token);
+            if (it == interactions.end() || --it->second.in_flight > 0)
+            {
+                return;
+            }
+            idle.swap(it->second.idle);
+            interactions.erase(it);
+        }
+        for (auto &done : idle)
+        {
+            done();
+        }
+    }
+
+    void stub_rest::when_idle(const std::string &token, std::function<void()> done)
+    {
+        {
+            std::lock_guard lock(mutex);
+            auto it = interactions.find(token);
+            if (it != interactions.end())
+            {
+                it->second.idle.push_back(std::move(done));
+                return;
+            }
+        }
+        done();
+    }
+
+    void stub_rest::interaction_response_create(dpp::snowflake interaction_id, const std::string &token, const dpp::interaction_response &response, completion callback)
+    {
+        if (response.type == dpp::ir_deferred_channel_message_with_source)
+        {
+            std::lock_guard lock(mutex);
+            ++deferred;
+        }
+        call("interaction_callback", interaction_id.str(), token, dpp::confirmation(), std::move(callback), false);
+    }
+
+    void stub_rest::interaction_response_edit(const std::string &token, const dpp::message &message, completion callback)
+    {
+        call("interaction_edit", token, token, message, std::move(callback));
+    }
+
+    void stub_rest::messages_get(dpp::snowflake channel_id, dpp::snowflake, dpp::snowflake before, dpp::snowflake, uint64_t limit, completion callback)
+    {
+        // The channel holds one message every ten seconds, counting back from now.
+        auto newest = std::chrono::system_clock::now() - std::chrono::seconds(1);
+        auto cursor = std::min(snowflake_time(before) - std::chrono::seconds(10), newest);
+        auto oldest = newest - std::chrono::seconds(10) * (options.channel_messages - 1);
+        dpp::message_map messages;
+        for (uint64_t i = 0; i < limit && cursor >= oldest; ++i, cursor -= std::chrono::seconds(10))
+        {
+            dpp::message m;
+            m.id = snowflake_at(cursor, i);
+            m.channel_id = channel_id;
+            messages.emplace(m.id, m);
+        }
+        call("messages_get", channel_id.str(), "", std::move(messages), std::move(callback));
+    }
+
+    void stub_rest::message_delete(dpp::snowflake, dpp::snowflake channel_id, completion callback)
+    {
+        call("message_delete", channel_id.str(), "", dpp::confirmation(), std::move(callback));
+    }
+
+    void stub_rest::message_delete_bulk(const std::vector<dpp::snowflake> &, dpp::snowflake channel_id, completion callback)
+    {
+        call("message_delete_bulk", channel_id.str(), "", dpp::confirmation(), std::move(callback));
+    }
+
+    void stub_rest::guild_get(dpp::snowflake guild_id, completion callback)
+    {
+        dpp::guild g;
+        g.id = guild_id;
+        g.name = "Replay guild";
+        g.member_count = 1000;
+        call("guild_get", guild_id.str(), "", std::move(g), std::move(callback));
+    }
+
+    void stub_rest::channel_get(dpp::snowflake channel_id, completion callback)
+    {
+        dpp::channel c;
+        c.id = channel_id;
+        c.name = "replay";
+        call("channel_get", channel_id.str(), "", std::move(c), std::move(callback));
+    }
+
+    std::map<std::string, route_stats> stub_rest::stats()
+    {
+        std::lock_guard lock(mutex);
+        return routes;
+    }
+
+    uint64_t stub_rest::deferrals()
+    {
+        std::lock_guard lock(mutex);
+        return deferred;
+    }
+}
@@ -0,0 +1,92 @@
+// stub_rest.hpp
+// A local stand-in for Discord's REST API, used by bot-replay.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../include/deadline_queue.hpp"
+#include "../include/rest_api.hpp"
+
+namespace replay
+{
+    struct stub_options
+    {
+        std::chrono::microseconds latency{50000};    // Base round trip of every call
+        std::chrono::microseconds jitter{20000};     // Added uniformly at random on top of the latency
+        uint32_t bucket_limit = 5;                   // Calls per bucket and window, like Discord's per-route buckets
+        std::chrono::milliseconds bucket_reset{2000};
+        uint32_t channel_messages = 250;             // Messages every channel pretends to hold, for delete_messages
+        size_t threads = 4;                          // Completion threads, like DPP's REST request threads
+    };
+
+    struct route_stats
+    {
+        uint64_t calls = 0;
+        uint64_t rate_limited = 0;                   // Calls that had to wait for their bucket to reset
+        std::chrono::microseconds waited{0};
+    };
+
+    /**
+     * @brief Answers REST calls locally after a simulated latency
+     *
+     * Calls are grouped in buckets by route and major parameter (channel, guild or interaction
+     * token) as Discord does. A bucket takes bucket_limit calls per window; further calls wait for
+     * the reset, the way DPP's request queue waits on the rate-limit headers, and every answer
+     * carries those headers. Interaction callbacks are not rate limited.
+     */
+    class stub_rest : public app::rest_api
+    {
+    public:
+        explicit stub_rest(const stub_options &options);
+
+        void interaction_response_create(dpp::snowflake interaction_id, const std::string &token, const dpp::interaction_response &response, completion callback) override;
+        void interaction_response_edit(const std::string &token, const dpp::message &message, completion callback) override;
+        void messages_get(dpp::snowflake channel_id, dpp::snowflake around, dpp::snowflake before, dpp::snowflake after, uint64_t limit, completion callback) override;
+        void message_delete(dpp::snowflake message_id, dpp::snowflake channel_id, completion callback) override;
+        void message_delete_bulk(const std::vector<dpp::snowflake> &message_ids, dpp::snowflake channel_id, completion callback) override;
+        void guild_get(dpp::snowflake guild_id, completion callback) override;
+        void channel_get(dpp::snowflake channel_id, completion callback) override;
+
+        /**
+         * @brief Runs done once every call made with this interaction token has been answered
+         */
+        void when_idle(const std::string &token, std::function<void()> done);
+
+        std::map<std::string, route_stats> stats();
+
+        uint64_t deferrals();
+
+    private:
+        struct bucket
+        {
+            uint32_t remaining = 0;
+            std::chrono::steady_clock::time_point reset_at;
+        };
+
+        struct interaction_calls
+        {
+            uint32_t in_flight = 0;
+            std::vector<std::function<void()>> idle;
+        };
+
+        void call(const std::string &route, const std::string &major, const std::string &token, dpp::confirmable_t value, completion callback, bool limited = true);
+        void finished(const std::string &token);
+
+        const stub_options options;
+        std::mutex mutex;
+        std::mt19937_64 random;
+        std::unordered_map<std::string, bucket> buckets;
+        std::map<std::string, route_stats> routes;
+        std::unordered_map<std::string, interaction_calls> interactions;
+        uint64_t deferred = 0;
+        // Last member: destroyed first, so no completion runs against the state above once it is gone.
+        app::deadline_queue completions;
+    };
+}
@@ -0,0 +1,104 @@
+#include "../include/action_graph.hpp"
+#include "../include/actions/delete.hpp"
+#include <stdexcept>
+
+namespace app
+{
+    action_graph action_graph::compile(const nlohmann::json &actions)
+    {
+        action_graph graph;
+        if (!actions.is_array())
+        {
+            return graph;
+        }
+
+        std::unordered_map<std::string, size_t> index_of;
+        for (const auto &action : actions)
+        {
+            action_node node;
+            node.id = action.contains("id") && action["id"].is_string() ? action["id"].get<std::string>() : std::to_string(graph.nodes_.size());
+            node.type = action.contains("type") && action["type"].is_string() ? action["type"].get<std::string>() : "";
+            node.config = action;
+            if (node.type == "delete_messages")
+            {
+                node.settings = compile_delete_settings(action);
+            }
+            if (node.settings)
+            {
+                for (const std::string &output : node.settings->outputs)
+                {
+                    node.output_keys.emplace_back(output, intern_key("action." + node.id + "." + output));
+                }
+            }
+            if (action.contains("depend_on") && action["depend_on"].is_string())
+            {
+                node.depend_on = intern_key(action["depend_on"].get_ref<const std::string &>());
+            }
+            if (!index_of.emplace(node.id, graph.nodes_.size()).second)
+            {
+                throw std::invalid_argument("Duplicate action id: " + node.id);
+            }
+            graph.nodes_.push_back(std::move(node));
+        }
+
+        for (auto &node : graph.nodes_)
+        {
+            if (!node.config.contains("after"))
+            {
+                continue;
+            }
+            const auto &after = node.config["after"];
+            for (const auto &dependency : after.is_array() ? after : nlohmann::json::array({after}))
+            {
+                std::string id = dependency.is_string() ? dependency.get<std::string>() : dependency.dump();
+                auto it = index_of.find(id);
+                if (it == index_of.end())
+                {
+                    throw std::invalid_argument("Action " + node.id + " runs after unknown action " + id);
+                }
+                node.after.push_back(it->second);
+            }
+        }
+
+        // Kahn's algorithm, one level at a time.
+        std::vector<size_t> pending(graph.nodes_.size());
+        std::vector<std::vector<size_t>> dependents(graph.nodes_.size());
+        std::vector<size_t> ready;
+        for (size_t i = 0; i < graph.nodes_.size(); ++i)
+        {
+            pending[i] = graph.nodes_[i].after.size();
+            for (size_t dependency : graph.nodes_[i].after)
+            {
+                dependents[dependency].push_back(i);
+            }
+            if (pending[i] == 0)
+            {
+                ready.push_back(i);
+            }
+        }
+
+        size_t placed = 0;
+        while (!ready.empty())
+        {
+            std::vector<size_t> next;
+            for (size_t index : ready)
+            {
+                for (size_t dependent : dependents[index])
+                {
+                    if (--pending[dependent] == 0)
+                    {
+                        next.push_back(dependent);
+                    }
+                }
+            }
+            placed += ready.size();
+            graph.levels_.push_back(std::move(ready));
+            ready = std::move(next);
+        }
+        if (placed != graph.nodes_.size())
+        {
+            throw std::invalid_argument("Actions have a dependency cycle");
+        }
+        return graph;
+    }
+} // namespace app
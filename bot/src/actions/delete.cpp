@@ -1,110 +1,206 @@
 #include <dpp/dpp.h>
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include "../../include/actions/delete.hpp"
+#include "../../include/log.hpp"
+#include "../../include/metrics.hpp"
+#include "../../include/permission_cache.hpp"
 
-dpp::task<bool> delete_action(const dpp::slashcommand_t &event, const nlohmann::json &action, const std::unordered_map<std::string, std::string> &key_values, dpp::user &user_ptr, dpp::cluster *cluster)
+namespace
 {
-    dpp::guild guild_ptr = event.command.get_guild();
-    // let's retrieve the member.
-    dpp::guild_member member_ptr = guild_ptr.members.find(user_ptr.id)->second;
-    dpp::guild_member bot_member_ptr = guild_ptr.members.find(cluster->me.id)->second;
-    std::unordered_map<std::string, std::string> error_messages = {
-        {"error", "You need to wait a bit before deleting messages."},
-        {"error_amount", "The amount of messages to delete must be between 1 and 100."},
-        {"error_perm_channel", "You do not have permission to delete messages in this channel."}};
+    // Discord refuses to bulk delete messages older than two weeks; keep a minute of slack
+    // for the time a page spends in flight between the fetch and the delete.
+    constexpr double max_message_age = 1209600 - 60;
+    // Both messages_get and message_delete_bulk take at most 100 messages per request.
+    constexpr uint64_t page_size = 100;
+    constexpr uint64_t default_max_amount = 10000;
 
-    if (action.contains("error_amount"))
+    std::string string_field(const nlohmann::json &action, const char *name, std::string fallback)
     {
-        error_messages["error_amount"] = action["error_amount"].get<std::string>();
+        if (!action.contains(name))
+        {
+            return fallback;
+        }
+        if (!action[name].is_string())
+        {
+            throw std::invalid_argument(std::string("delete_messages: ") + name + " must be a string");
+        }
+        return action[name].get<std::string>();
     }
 
-    if (action.contains("error_perm_channel"))
+    app::key_id deleted_key()
     {
-        error_messages["error_perm_channel"] = action["error_perm_channel"].get<std::string>();
+        static const app::key_id key = app::intern_key("deleted");
+        return key;
     }
 
-    if (action.contains("error"))
+    app::key_id amount_key()
     {
-        error_messages["error"] = action["error"].get<std::string>();
+        static const app::key_id key = app::intern_key("amount");
+        return key;
+    }
+}
+
+std::shared_ptr<const delete_settings> compile_delete_settings(const nlohmann::json &action)
+{
+    auto settings = std::make_shared<delete_settings>();
+    settings->outputs = {"deleted"};
+    settings->max_amount = default_max_amount;
+    if (action.contains("max_amount"))
+    {
+        const nlohmann::json &max_amount = action["max_amount"];
+        if (!max_amount.is_number_integer())
+        {
+            throw std::invalid_argument("delete_messages: max_amount must be an integer");
+        }
+        settings->max_amount = max_amount.is_number_unsigned() ? std::clamp<uint64_t>(max_amount.get<uint64_t>(), 1, default_max_amount) : 1;
     }
-    // let's retrieve the current channel
-    const dpp::channel *channel_ptr = &event.command.get_channel();
-    auto user_as_perms = channel_ptr->get_user_permissions(member_ptr).has(dpp::p_manage_messages);
-    auto bot_as_perms = channel_ptr->get_user_permissions(bot_member_ptr).has(dpp::p_manage_messages);
+    settings->error = string_field(action, "error", "You need to wait a bit before deleting messages.");
+    settings->error_amount = string_field(action, "error_amount", "The amount of messages to delete must be between 1 and " + std::to_string(settings->max_amount) + ".");
+    settings->error_perm_channel = string_field(action, "error_perm_channel", "You do not have permission to delete messages in this channel.");
+    settings->progress = app::response_template(string_field(action, "progress", "Deleted ((deleted)) of ((amount)) messages..."));
+    return settings;
+}
+
+dpp::task<bool> delete_action(const dpp::slashcommand_t &event, const app::action_node &node, const app::key_values &key_values, dpp::user &user_ptr, dpp::cluster *cluster, app::action_outputs &outputs, app::interaction_reply &reply, app::rest_api &rest)
+{
+    // Compiled with the graph, so a malformed config was refused when it was sent, not here.
+    const auto &settings = static_cast<const delete_settings &>(*node.settings);
+    const uint64_t max_amount = settings.max_amount;
+    // Permissions come from the shared cache; nothing here copies the guild or its members.
+    auto &permissions = app::permission_cache::instance();
+    auto user_perms = permissions.channel_permissions(event.command.guild_id, event.command.channel_id, user_ptr.id, &event.command.member);
+    auto bot_perms = permissions.channel_permissions(event.command.guild_id, event.command.channel_id, cluster->me.id);
+    if (!user_perms)
+    {
+        // Bots running without the guild or channel cache: Discord sends the invoker's channel permissions with the interaction.
+        try
+        {
+            user_perms = event.command.get_resolved_permission(user_ptr.id);
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+    auto user_as_perms = user_perms && user_perms->has(dpp::p_manage_messages);
+    // Discord computes the bot's channel permissions for every interaction; use them if the bot isn't cached.
+    auto bot_as_perms = bot_perms ? bot_perms->has(dpp::p_manage_messages) : event.command.app_permissions.has(dpp::p_manage_messages);
     if (!user_as_perms)
     {
-        event.edit_response(error_messages["error_perm_channel"]);
+        reply.finish(settings.error_perm_channel);
         co_return false;
     }
     if (!bot_as_perms)
     {
-        event.edit_response(error_messages["error_perm_channel"]);
+        reply.finish(settings.error_perm_channel);
         co_return false;
     }
-    int amount = 0;
-    if (action.contains("depend_on"))
+    outputs["deleted"] = "0";
+    uint64_t amount = 0;
+    if (const std::string_view *depend_on_value = key_values.find(node.depend_on))
     {
-        std::string depend_on = action["depend_on"];
-        auto it = key_values.find(depend_on);
-        if (it != key_values.end())
+        long long requested_amount = 0;
+        auto [end, error] = std::from_chars(depend_on_value->data(), depend_on_value->data() + depend_on_value->size(), requested_amount);
+        if (error != std::errc() || requested_amount < 0 || static_cast<uint64_t>(requested_amount) > max_amount)
         {
-            std::string depend_on_value = it->second;
-
-            // let's convert the depend_on_value to an int
-            amount = std::stoi(depend_on_value);
-            if (amount < 0 || amount > 100)
-            {
-                event.edit_response(error_messages["error_amount"]);
-                co_return false;
-            }
+            reply.finish(settings.error_amount);
+            co_return false;
         }
+        amount = requested_amount;
     }
     if (amount > 0)
     {
-        dpp::confirmation_callback_t callback = co_await cluster->co_messages_get(channel_ptr->id, 0, 0, 0, amount);
-        if (callback.is_error())
-        {
-            printf("Error: %s\n", callback.get_error().message.c_str());
-            event.edit_response(error_messages["error"]);
-            co_return false;
-        }
-        auto messages = callback.get<dpp::message_map>();
-        if (messages.empty())
-        {
-            event.edit_response("No messages to delete.");
-            co_return false;
-        }
-        std::vector<dpp::snowflake> msg_ids;
-
-        for (const auto &msg : messages)
+        const dpp::snowflake channel_id = event.command.channel_id;
+        const double cutoff = dpp::utility::time_f() - max_message_age;
+        uint64_t remaining = amount;
+        uint64_t requested = std::min(remaining, page_size);
+        size_t deleted = 0;
+        bool first_page = true;
+        // Pages are walked newest to oldest with a `before` cursor. The next page is always requested
+        // before the current one is deleted: the two calls use different rate limit buckets, so
+        // the fetch overlaps the bulk delete instead of queueing behind it.
+        dpp::async<dpp::confirmation_callback_t> fetch = rest.co_messages_get(channel_id, 0, 0, 0, requested);
+        while (true)
         {
-            // let's check if the message is older than 2 weeks
-            if (msg.second.get_creation_time() < dpp::utility::time_f() - 1209600)
+            dpp::confirmation_callback_t callback = co_await fetch;
+            app::metrics::rest_call(cluster->me.id, "delete_messages", callback.is_error());
+            if (callback.is_error())
             {
-                printf("Message is older than 2 weeks\n");
-                continue;
+                app::log::warning({cluster->me.id, event.command.guild_id, event.command.get_command_name()}, "Fetching messages failed: " + callback.get_error().message);
+                outputs["deleted"] = std::to_string(deleted);
+                reply.finish(settings.error);
+                co_return false;
             }
-            else
+            auto messages = callback.get<dpp::message_map>();
+            if (messages.empty() && first_page)
             {
-                msg_ids.push_back(msg.second.id);
+                reply.finish("No messages to delete.");
+                co_return false;
             }
-        }
+            std::vector<dpp::snowflake> msg_ids;
+            msg_ids.reserve(messages.size());
+            dpp::snowflake oldest = 0;
+            bool reached_cutoff = false;
 
-        if (!msg_ids.empty())
-        {
-            dpp::confirmation_callback_t result;
-            if (msg_ids.size() == 1)
+            for (const auto &msg : messages)
+            {
+                if (oldest.empty() || msg.second.id < oldest)
+                {
+                    oldest = msg.second.id;
+                }
+                // Snowflakes are time ordered, so once one message is too old every later page is too.
+                if (msg.second.get_creation_time() < cutoff)
+                {
+                    reached_cutoff = true;
+                }
+                else
+                {
+                    msg_ids.push_back(msg.second.id);
+                }
+            }
+
+            remaining -= std::min<uint64_t>(remaining, messages.size());
+            bool more = !reached_cutoff && remaining > 0 && messages.size() == requested;
+            if (more)
             {
-                result = co_await cluster->co_message_delete(msg_ids[0], channel_ptr->id);
+                requested = std::min(remaining, page_size);
+                fetch = rest.co_messages_get(channel_id, 0, oldest, 0, requested);
             }
-            else
+
+            if (!msg_ids.empty())
             {
-                result = co_await cluster->co_message_delete_bulk(msg_ids, channel_ptr->id);
+                dpp::confirmation_callback_t result;
+                if (msg_ids.size() == 1)
+                {
+                    result = co_await rest.co_message_delete(msg_ids[0], channel_id);
+                }
+                else
+                {
+                    result = co_await rest.co_message_delete_bulk(msg_ids, channel_id);
+                }
+                app::metrics::rest_call(cluster->me.id, "delete_messages", result.is_error());
+                if (result.is_error())
+                {
+                    app::log::warning({cluster->me.id, event.command.guild_id, event.command.get_command_name()}, "Deleting messages failed: " + result.get_error().message);
+                    outputs["deleted"] = std::to_string(deleted);
+                    reply.finish(settings.error);
+                    co_return false;
+                }
+                deleted += msg_ids.size();
             }
-            if (result.is_error())
+
+            if (!more)
             {
-                event.edit_response(error_messages["error"]);
-                co_return false;
+                break;
             }
+            first_page = false;
+            app::key_values progress(&key_values);
+            progress.set_number(deleted_key(), deleted);
+            progress.set_number(amount_key(), amount);
+            reply.update(settings.progress.render(progress));
         }
+        outputs["deleted"] = std::to_string(deleted);
     }
 
     co_return true;
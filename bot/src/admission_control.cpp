@@ -0,0 +1,164 @@
+#include "../include/admission_control.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace app
+{
+    namespace
+    {
+        // Shards smaller than this are never swept; bigger ones are swept once inserts reach half their size.
+        constexpr size_t sweep_threshold = 1024;
+
+        rate_limit limit_from_json(const nlohmann::json &j, const char *scope)
+        {
+            rate_limit limit;
+            if (!j.contains(scope))
+            {
+                return limit;
+            }
+            const nlohmann::json &config = j[scope];
+            if (!config.is_object() || !config.value("count", nlohmann::json()).is_number_unsigned() || !config.value("per", nlohmann::json()).is_number())
+            {
+                throw std::invalid_argument(std::string("rate_limit.") + scope + " needs a positive count and a per in seconds");
+            }
+            // Leave the scope out to not limit it; a count of 0 would silently do the same.
+            uint64_t count = config["count"].get<uint64_t>();
+            if (count == 0 || count > UINT32_MAX)
+            {
+                throw std::invalid_argument(std::string("rate_limit.") + scope + ".count must be between 1 and " + std::to_string(UINT32_MAX));
+            }
+            limit.count = static_cast<uint32_t>(count);
+            limit.per_seconds = config["per"].get<double>();
+            if (limit.per_seconds <= 0)
+            {
+                throw std::invalid_argument(std::string("rate_limit.") + scope + ".per must be positive");
+            }
+            return limit;
+        }
+    }
+
+    std::optional<admission_policy> admission_policy::from_json(const nlohmann::json &j)
+    {
+        if (!j.is_object())
+        {
+            return std::nullopt;
+        }
+        admission_policy policy;
+        policy.user = limit_from_json(j, "user");
+        policy.guild = limit_from_json(j, "guild");
+        policy.command = limit_from_json(j, "command");
+        if (!policy.user.enabled() && !policy.guild.enabled() && !policy.command.enabled())
+        {
+            return std::nullopt;
+        }
+        if (j.contains("message") && j["message"].is_string())
+        {
+            policy.message = response_template(j["message"].get<std::string>());
+        }
+        return policy;
+    }
+
+    size_t admission_control::bucket_key_hash::operator()(const bucket_key &key) const
+    {
+        uint64_t h = key.id * 0x9E3779B97F4A7C15ull;
+        h ^= key.command + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h ^ static_cast<uint64_t>(key.kind));
+    }
+
+    admission_control::shard &admission_control::shard_for(const bucket_key &key)
+    {
+        // The top bits, so the shard index doesn't correlate with the bucket index inside the shard.
+        return shards[(bucket_key_hash{}(key) >> 59) % shard_count];
+    }
+
+    bool admission_control::take(const bucket_key &key, const rate_limit &limit, clock::time_point now, double &retry_after)
+    {
+        shard &s = shard_for(key);
+        std::lock_guard lock(s.mutex);
+        double capacity = limit.count;
+        double per_second = limit.count / limit.per_seconds;
+        auto it = s.buckets.find(key);
+        if (it == s.buckets.end())
+        {
+            // Swept before the insert, since the new bucket is full and would go with the others.
+            if (++s.inserts_since_sweep >= std::max(sweep_threshold, s.buckets.size() / 2))
+            {
+                sweep(s, now);
+            }
+            it = s.buckets.emplace(key, bucket{capacity, capacity, per_second, now}).first;
+        }
+        else
+        {
+            // A config update may have changed the limit since the bucket was created.
+            bucket &b = it->second;
+            b.capacity = capacity;
+            b.per_second = per_second;
+            b.tokens = std::min(capacity, b.tokens + std::chrono::duration<double>(now - b.updated).count() * per_second);
+            b.updated = now;
+        }
+        bucket &b = it->second;
+        if (b.tokens < 1)
+        {
+            retry_after = (1 - b.tokens) / per_second;
+            return false;
+        }
+        b.tokens -= 1;
+        return true;
+    }
+
+    void admission_control::give_back(const bucket_key &key)
+    {
+        shard &s = shard_for(key);
+        std::lock_guard lock(s.mutex);
+        auto it = s.buckets.find(key);
+        if (it != s.buckets.end())
+        {
+            it->second.tokens = std::min(it->second.capacity, it->second.tokens + 1);
+        }
+    }
+
+    void admission_control::sweep(shard &s, clock::time_point now)
+    {
+        s.inserts_since_sweep = 0;
+        std::erase_if(s.buckets, [now](const auto &item)
+                      {
+                          const bucket &b = item.second;
+                          return b.tokens + std::chrono::duration<double>(now - b.updated).count() * b.per_second >= b.capacity; });
+    }
+
+    admission_control::decision admission_control::admit(const std::string &command, const admission_policy &policy, dpp::snowflake user_id, dpp::snowflake guild_id)
+    {
+        const uint64_t command_hash = std::hash<std::string>{}(command);
+        const auto now = clock::now();
+        // Narrowest scope first: a user hammering a command is stopped before draining the guild's or the bot's budget.
+        const std::pair<bucket_key, const rate_limit *> checks[] = {
+            {{user_id, command_hash, scope::user}, &policy.user},
+            {{guild_id, command_hash, scope::guild}, &policy.guild},
+            {{0, command_hash, scope::command}, &policy.command},
+        };
+        decision result;
+        for (size_t i = 0; i < std::size(checks); ++i)
+        {
+            const auto &[key, limit] = checks[i];
+            // DMs have no guild to limit.
+            if (!limit->enabled() || (key.kind == scope::guild && guild_id.empty()))
+            {
+                continue;
+            }
+            if (!take(key, *limit, now, result.retry_after))
+            {
+                result.admitted = false;
+                for (size_t j = 0; j < i; ++j)
+                {
+                    if (checks[j].second->enabled())
+                    {
+                        give_back(checks[j].first);
+                    }
+                }
+                break;
+            }
+        }
+        return result;
+    }
+} // namespace app
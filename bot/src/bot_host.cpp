@@ -0,0 +1,292 @@
+#include "../include/bot_host.hpp"
+#include "../include/config_reader.hpp"
+#include "../include/log.hpp"
+#include "../include/metrics.hpp"
+#include "../include/utils.hpp"
+#include <algorithm>
+#include <utility>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app
+{
+    namespace
+    {
+        constexpr std::string_view bots_prefix = "/bots/";
+
+        HttpWebhookServer::HttpResponse json_response(int status_code, std::string body)
+        {
+            HttpWebhookServer::HttpResponse res;
+            res.status_code = status_code;
+            res.headers["Content-Type"] = "application/json";
+            res.body = std::move(body);
+            return res;
+        }
+
+        HttpWebhookServer::HttpResponse invalid_method()
+        {
+            HttpWebhookServer::HttpResponse res;
+            res.status_code = 400;
+            res.headers["Content-Type"] = "text/plain";
+            res.body = "Invalid request method.";
+            return res;
+        }
+
+        HttpWebhookServer::HttpResponse metrics_response()
+        {
+            HttpWebhookServer::HttpResponse res;
+            res.headers["Content-Type"] = "text/plain; version=0.0.4";
+            res.body = metrics::render();
+            return res;
+        }
+
+        // How long a stopped bot's interactions may run past drain_grace before it is given up on.
+        constexpr std::chrono::seconds retire_timeout{60};
+
+        // Runs on a retiring thread: a bot is only destroyed once nothing it dispatched can still use it.
+        // overrun is how long its interactions may run past grace, before and after the disconnect.
+        void retire_bot(std::shared_ptr<bot_instance> bot, std::chrono::steady_clock::duration grace, std::chrono::steady_clock::duration overrun)
+        {
+            bot->drain(grace);
+            // Interactions still running keep their REST calls, which need the cluster connected to complete.
+            bool idle = bot->wait_idle(overrun);
+            bot->stop();
+            // Events dispatched right before the shards went down are counted and refused; let them end too.
+            if (!idle || !bot->wait_idle(overrun))
+            {
+                log::error({}, std::to_string(bot->running_interactions()) + " interactions of a stopped bot never finished; keeping it in memory");
+                // Leaked on purpose: freeing it would pull the instance from under their coroutines.
+                new std::shared_ptr<bot_instance>(std::move(bot));
+            }
+        }
+    }
+
+    HttpWebhookServer::HttpResponse handle_bot_request(bot_instance &bot, const HttpWebhookServer::HttpRequest &req, std::optional<std::string> command)
+    {
+        if (req.method == "GET" && req.path == "/metrics")
+        {
+            return metrics_response();
+        }
+        if (req.method != "POST")
+        {
+            return invalid_method();
+        }
+
+        try
+        {
+            if (auto result = bot.handle_request(req.body, command ? *command : peek_command(req.body)))
+            {
+                (*result)["status"] = "success";
+                (*result)["message"] = "Command executed successfully";
+                return json_response(200, result->dump());
+            }
+            return json_response(200, R"({"received": "POST request received"})");
+        }
+        catch (const std::exception &e)
+        {
+            return json_response(400, std::string("{\"error\": \"") + e.what() + "\"}");
+        }
+    }
+
+    bot_host::bot_host(std::chrono::steady_clock::duration drain_grace) : drain_grace(drain_grace)
+    {
+    }
+
+    bot_host::~bot_host()
+    {
+        stop_all();
+        std::lock_guard lock(retiring_mutex);
+        for (auto &done : retiring)
+        {
+            done.wait();
+        }
+    }
+
+    void bot_host::retire(std::shared_ptr<bot_instance> bot)
+    {
+        std::lock_guard lock(retiring_mutex);
+        std::erase_if(retiring, [](const std::future<void> &done)
+                      { return done.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+        retiring.push_back(std::async(std::launch::async, retire_bot, std::move(bot), drain_grace, retire_timeout));
+    }
+
+    std::shared_ptr<bot_instance> bot_host::find(const std::string &token)
+    {
+        std::shared_lock lock(mutex);
+        auto it = bots.find(token);
+        return it != bots.end() ? it->second : nullptr;
+    }
+
+    HttpWebhookServer::HttpResponse bot_host::handle(const HttpWebhookServer::HttpRequest &req)
+    {
+        if (req.method == "GET" && req.path == "/metrics")
+        {
+            return metrics_response();
+        }
+        if (req.method == "GET" && req.path == "/bots")
+        {
+            std::shared_lock lock(mutex);
+            return json_response(200, "{\"bots\": " + std::to_string(bots.size()) + "}");
+        }
+        if (req.path.substr(0, bots_prefix.size()) != bots_prefix)
+        {
+            return json_response(404, R"({"error": "Unknown route"})");
+        }
+        if (req.method != "POST")
+        {
+            return invalid_method();
+        }
+
+        std::string_view token_view = req.path.substr(bots_prefix.size());
+        token_view = token_view.substr(0, token_view.find_first_of("/?"));
+        if (token_view.empty())
+        {
+            return json_response(400, R"({"error": "Missing bot token"})");
+        }
+        std::string token(token_view);
+
+        // Only lifecycle bodies are parsed here; the rest, `update` included, are read once by the bot.
+        std::string command = peek_command(req.body);
+
+        if (command == "start" || command == "restart")
+        {
+            nlohmann::json body_json = json_from_string(req.body);
+            cluster_options options;
+            try
+            {
+                options = cluster_options::from_json(body_json.value("cluster", nlohmann::json::object()));
+            }
+            catch (const std::exception &e)
+            {
+                return json_response(400, std::string("{\"error\": \"") + e.what() + "\"}");
+            }
+            if (command == "restart")
+            {
+                return restart(token, options);
+            }
+            std::shared_ptr<bot_instance> bot;
+            size_t running = 0;
+            {
+                std::unique_lock lock(mutex);
+                if (bots.count(token))
+                {
+                    return json_response(409, R"({"error": "Bot already running"})");
+                }
+                bot = std::make_shared<bot_instance>(token, options);
+                bots.emplace(token, bot);
+                running = bots.size();
+            }
+            try
+            {
+                bot->start();
+            }
+            catch (const std::exception &e)
+            {
+                std::unique_lock lock(mutex);
+                bots.erase(token);
+                return json_response(500, std::string("{\"error\": \"") + e.what() + "\"}");
+            }
+            log::info({}, "Bot started, " + std::to_string(running) + " running");
+            return json_response(200, R"({"status": "success", "message": "Bot started"})");
+        }
+
+        if (command == "stop")
+        {
+            std::shared_ptr<bot_instance> bot;
+            {
+                std::unique_lock lock(mutex);
+                auto it = bots.find(token);
+                if (it == bots.end())
+                {
+                    return json_response(404, R"({"error": "Bot not found"})");
+                }
+                bot = std::move(it->second);
+                bots.erase(it);
+            }
+            // Drained and shut down in the background; neither this handler thread nor other bots wait for it.
+            retire(std::move(bot));
+            return json_response(200, R"({"status": "success", "message": "Bot stopping"})");
+        }
+
+        std::shared_ptr<bot_instance> bot = find(token);
+        if (!bot)
+        {
+            return json_response(404, R"({"error": "Bot not found"})");
+        }
+        return handle_bot_request(*bot, req, std::move(command));
+    }
+
+    HttpWebhookServer::HttpResponse bot_host::restart(const std::string &token, const cluster_options &options)
+    {
+        if (!find(token))
+        {
+            return json_response(404, R"({"error": "Bot not found"})");
+        }
+        // Intents, cache policy and shards are fixed when a cluster is built, so new options mean a new
+        // cluster. It is connected before the old one goes: if it can't start, the old bot keeps running.
+        auto bot = std::make_shared<bot_instance>(token, options);
+        try
+        {
+            bot->start();
+        }
+        catch (const std::exception &e)
+        {
+            return json_response(500, std::string("{\"error\": \"") + e.what() + "\"}");
+        }
+        std::shared_ptr<bot_instance> previous;
+        {
+            std::unique_lock lock(mutex);
+            auto it = bots.find(token);
+            if (it == bots.end())
+            {
+                // Stopped while the new cluster was starting.
+                lock.unlock();
+                retire(std::move(bot));
+                return json_response(404, R"({"error": "Bot not found"})");
+            }
+            previous = std::exchange(it->second, bot);
+            // The running config, including updates newer than the snapshot the new instance loaded.
+            bot->adopt_commands(*previous);
+            // Until it is retired, the old cluster gets every interaction too: the new one answers them.
+            previous->hand_over();
+        }
+        retire(std::move(previous));
+        log::info({}, "Bot restarted with new cluster options");
+        return json_response(200, R"({"status": "success", "message": "Bot restarted"})");
+    }
+
+    void bot_host::stop_all()
+    {
+        std::unordered_map<std::string, std::shared_ptr<bot_instance>> stopping;
+        {
+            std::unique_lock lock(mutex);
+            stopping.swap(bots);
+        }
+        for (auto &[token, bot] : stopping)
+        {
+            retire(std::move(bot));
+        }
+    }
+
+    void bot_host::shutdown()
+    {
+        std::unordered_map<std::string, std::shared_ptr<bot_instance>> stopping;
+        {
+            std::unique_lock lock(mutex);
+            stopping.swap(bots);
+        }
+        // Side by side, so the whole host is done within one drain_grace however many bots it runs.
+        // The process is exiting: interactions still running then are given up on, not waited for.
+        std::vector<std::thread> draining;
+        draining.reserve(stopping.size());
+        for (auto &[token, bot] : stopping)
+        {
+            draining.emplace_back(retire_bot, std::move(bot), drain_grace, std::chrono::seconds(0));
+        }
+        for (auto &thread : draining)
+        {
+            thread.join();
+        }
+    }
+} // namespace app
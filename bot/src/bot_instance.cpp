@@ -0,0 +1,581 @@
+#include "../include/bot_instance.hpp"
+#include "../include/config_reader.hpp"
+#include "../include/config_snapshot.hpp"
+#include "../include/handle_actions.hpp"
+#include "../include/log.hpp"
+#include "../include/metrics.hpp"
+#include "../include/permission_cache.hpp"
+#include "../include/utils.hpp"
+#include <cmath>
+
+namespace app
+{
+    namespace
+    {
+        dpp::activity_type activity_type_from_string(const std::string &type)
+        {
+            if (type == "playing")
+            {
+                return dpp::activity_type::at_game;
+            }
+            else if (type == "streaming")
+            {
+                return dpp::activity_type::at_streaming;
+            }
+            else if (type == "listening")
+            {
+                return dpp::activity_type::at_listening;
+            }
+            else if (type == "watching")
+            {
+                return dpp::activity_type::at_watching;
+            }
+            else if (type == "custom")
+            {
+                return dpp::activity_type::at_custom;
+            }
+            else if (type == "competing")
+            {
+                return dpp::activity_type::at_competing;
+            }
+            else
+            {
+                throw std::invalid_argument("Invalid activity type");
+            }
+        }
+
+        log::level level_from_dpp(dpp::loglevel severity)
+        {
+            switch (severity)
+            {
+            case dpp::ll_trace:
+                return log::level::trace;
+            case dpp::ll_debug:
+                return log::level::debug;
+            case dpp::ll_info:
+                return log::level::info;
+            case dpp::ll_warning:
+                return log::level::warning;
+            case dpp::ll_error:
+                return log::level::error;
+            default:
+                return log::level::critical;
+            }
+        }
+
+        // A bot token starts with the bot's user id in base64, so records can name the bot
+        // before it has connected.
+        uint64_t bot_id_from_token(const std::string &token)
+        {
+            static constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            std::string decoded;
+            uint32_t bits = 0;
+            int count = 0;
+            for (char c : std::string_view(token).substr(0, token.find('.')))
+            {
+                size_t value = alphabet.find(c);
+                if (value == std::string_view::npos)
+                {
+                    break;
+                }
+                bits = (bits << 6) | static_cast<uint32_t>(value);
+                count += 6;
+                if (count >= 8)
+                {
+                    count -= 8;
+                    decoded += static_cast<char>((bits >> count) & 0xFF);
+                }
+            }
+            uint64_t id = 0;
+            for (char c : decoded)
+            {
+                if (c < '0' || c > '9')
+                {
+                    return 0;
+                }
+                id = id * 10 + (c - '0');
+            }
+            return id;
+        }
+
+        bool wants_guild(const placeholder_set &wanted)
+        {
+            using k = builtin_key;
+            return wanted.wants(k::guild_name) || wanted.wants(k::guild_id) || wanted.wants(k::guild_icon) ||
+                   wanted.wants(k::guild_count) || wanted.wants(k::guild_owner) || wanted.wants(k::guild_created_at) ||
+                   wanted.wants(k::guild_boost_tier) || wanted.wants(k::guild_boost_count);
+        }
+
+        bool wants_channel(const placeholder_set &wanted)
+        {
+            using k = builtin_key;
+            return wanted.wants(k::channel_name) || wanted.wants(k::channel_id) || wanted.wants(k::channel_type);
+        }
+
+        // The option the user is typing in, possibly inside a subcommand or a group.
+        const dpp::command_data_option *focused_option(const std::vector<dpp::command_data_option> &options)
+        {
+            for (const auto &option : options)
+            {
+                if (option.focused)
+                {
+                    return &option;
+                }
+                if (const auto *nested = focused_option(option.options))
+                {
+                    return nested;
+                }
+            }
+            return nullptr;
+        }
+
+        // Number options arrive parsed; matched as the user would have typed them.
+        std::string typed_text(const dpp::command_value &value)
+        {
+            if (const auto *text = std::get_if<std::string>(&value))
+            {
+                return *text;
+            }
+            if (const auto *integer = std::get_if<int64_t>(&value))
+            {
+                return std::to_string(*integer);
+            }
+            if (const auto *number = std::get_if<double>(&value))
+            {
+                return nlohmann::json(*number).dump();
+            }
+            return {};
+        }
+
+        const response_template no_response("Interaction found, but no response found.");
+        const std::string restarting_response = "The bot is restarting, please try again in a few seconds.";
+        const placeholder_set no_placeholders;
+
+        // Only rate limit messages use it, so it isn't a builtin_key.
+        key_id retry_after_key()
+        {
+            static const key_id key = intern_key("retryAfter");
+            return key;
+        }
+    }
+
+    bot_instance::bot_instance(const std::string &token, const cluster_options &options)
+        : bot(token, options.intents, options.shards, options.cluster_id, options.max_clusters, true, options.cache_policy),
+          id(bot_id_from_token(token))
+    {
+        bot.on_log([this](const dpp::log_t &event)
+                   {
+                       log::level lvl = level_from_dpp(event.severity);
+                       if (log::enabled(lvl))
+                       {
+                           log::write(lvl, {id}, event.message);
+                       } });
+        permission_cache::instance().attach(bot);
+        if (id != 0)
+        {
+            // Serve the last accepted config straight away, before the control plane resends it.
+            snapshot_path = config_snapshot::path_for(id);
+            if (auto table = config_snapshot::load(snapshot_path))
+            {
+                log::info({id}, "Loaded " + std::to_string(table->size()) + " commands from " + snapshot_path);
+                commands.store(std::move(table), std::memory_order_release);
+            }
+        }
+        bot.on_slashcommand([this](const dpp::slashcommand_t &event) -> dpp::task<void>
+                            { return on_slashcommand(event); });
+        bot.on_autocomplete([this](const dpp::autocomplete_t &event)
+                            { on_autocomplete(event); });
+    }
+
+    bot_instance::~bot_instance()
+    {
+        stop();
+    }
+
+    void bot_instance::start()
+    {
+        started = true;
+        bot.start(dpp::st_return);
+    }
+
+    void bot_instance::stop()
+    {
+        if (started)
+        {
+            started = false;
+            bot.shutdown();
+        }
+    }
+
+    bool bot_instance::drain(std::chrono::steady_clock::duration grace)
+    {
+        {
+            std::lock_guard lock(in_flight->mutex);
+            in_flight->draining = true;
+            if (in_flight->count > 0)
+            {
+                log::info({id}, "Waiting for " + std::to_string(in_flight->count) + " interactions to finish");
+            }
+        }
+        if (!wait_idle(grace))
+        {
+            log::warning({id}, std::to_string(running_interactions()) + " interactions still running at the shutdown deadline");
+            return false;
+        }
+        return true;
+    }
+
+    bool bot_instance::wait_idle(std::chrono::steady_clock::duration timeout)
+    {
+        std::unique_lock lock(in_flight->mutex);
+        return in_flight->idle.wait_for(lock, timeout, [this]
+                                        { return in_flight->count == 0; });
+    }
+
+    size_t bot_instance::running_interactions()
+    {
+        std::lock_guard lock(in_flight->mutex);
+        return in_flight->count;
+    }
+
+    void bot_instance::hand_over()
+    {
+        std::lock_guard lock(in_flight->mutex);
+        in_flight->handed_over = true;
+    }
+
+    std::shared_ptr<void> bot_instance::track_interaction(bool &accepted)
+    {
+        std::lock_guard lock(in_flight->mutex);
+        accepted = !in_flight->draining && !in_flight->handed_over;
+        if (in_flight->handed_over)
+        {
+            return nullptr;
+        }
+        ++in_flight->count;
+        return std::shared_ptr<void>(in_flight.get(), [count = in_flight](void *)
+                                     {
+                                         std::lock_guard lock(count->mutex);
+                                         if (--count->count == 0)
+                                         {
+                                             count->idle.notify_all();
+                                         } });
+    }
+
+    dpp::task<void> bot_instance::on_slashcommand(const dpp::slashcommand_t &event)
+    {
+        // Keep this snapshot alive until the interaction is done, even if an `update` swaps the table.
+        std::string command_name = event.command.get_command_name();
+        const metrics::interaction_timer timer = metrics::start_interaction(id, command_name);
+        const log::fields where{id, event.command.guild_id, command_name};
+        // Held by the coroutine and by the callback of the final response, whichever finishes last. Taken
+        // before anything else touches the instance: bot_host destroys a stopped bot only once it's released.
+        bool accepted = false;
+        std::shared_ptr<void> running = track_interaction(accepted);
+        if (!running)
+        {
+            // The instance that replaced this one got the same interaction over its own session.
+            co_return;
+        }
+        if (!accepted)
+        {
+            metrics::interaction_rejected(id, command_name);
+            log::debug(where, "Shutting down, not running the command");
+            rest->interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_channel_message_with_source, dpp::message(restarting_response).set_flags(dpp::m_ephemeral)), [timer, running](const dpp::confirmation_callback_t &)
+                                              {
+                                                  timer.acked();
+                                                  timer.responded(); });
+            co_return;
+        }
+        std::shared_ptr<const command_table> table = commands.load(std::memory_order_acquire);
+        const command_entry *command = table->find(command_name);
+        if (command && command->admission)
+        {
+            dpp::snowflake user_id = event.command.get_issuing_user().id;
+            auto decision = admission.admit(command_name, *command->admission, user_id, event.command.guild_id);
+            if (!decision.admitted)
+            {
+                // Turned away before any REST lookup or action: a single ephemeral reply, rendered from what the event carries.
+                metrics::interaction_rejected(id, command_name);
+                log::debug(where, "Rate limited, retry in " + std::to_string(decision.retry_after) + "s");
+                key_values values;
+                values.set_number(retry_after_key(), static_cast<uint64_t>(std::ceil(decision.retry_after)));
+                values.set(builtin_key_id(builtin_key::user_name), event.command.get_issuing_user().username);
+                values.set_number(builtin_key_id(builtin_key::user_id), static_cast<uint64_t>(user_id));
+                values.set(builtin_key_id(builtin_key::command_name), command_name);
+                rest->interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_channel_message_with_source, dpp::message(command->admission->message.render(values)).set_flags(dpp::m_ephemeral)), [timer, running](const dpp::confirmation_callback_t &)
+                                                  {
+                                                      timer.acked();
+                                                      timer.responded(); });
+                co_return;
+            }
+        }
+        // Only the placeholders this command's config references are computed.
+        const placeholder_set &wanted = command ? command->placeholders : no_placeholders;
+        const dpp::guild *guild = nullptr;
+        const dpp::channel *channel = nullptr;
+        dpp::guild fetched_guild;
+        dpp::channel fetched_channel;
+        if (event.command.is_guild_interaction())
+        {
+            guild = dpp::find_guild(event.command.guild_id);
+            channel = dpp::find_channel(event.command.channel_id);
+        }
+        // Bots running with a reduced cache policy don't hold these; ask the API only when a placeholder needs them.
+        const bool fetch_guild = event.command.is_guild_interaction() && !guild && wants_guild(wanted);
+        const bool fetch_channel = event.command.is_guild_interaction() && !channel && wants_channel(wanted);
+        // Armed before anything that waits on Discord, lookups included: the interaction is deferred if they
+        // and the actions together come close to the 3 second deadline. A command that waits on nothing replies directly.
+        std::shared_ptr<interaction_reply> reply;
+        if (fetch_guild || fetch_channel || (command && command->has_actions()))
+        {
+            reply = interaction_reply::start(event, timer, rest, running);
+        }
+        if (fetch_guild)
+        {
+            auto result = co_await rest->co_guild_get(event.command.guild_id);
+            metrics::rest_call(id, "guild_get", result.is_error());
+            if (!result.is_error())
+            {
+                fetched_guild = result.get<dpp::guild>();
+                guild = &fetched_guild;
+            }
+        }
+        if (fetch_channel)
+        {
+            auto result = co_await rest->co_channel_get(event.command.channel_id);
+            metrics::rest_call(id, "channel_get", result.is_error());
+            if (!result.is_error())
+            {
+                fetched_channel = result.get<dpp::channel>();
+                channel = &fetched_channel;
+            }
+        }
+        // Lives in the coroutine frame: its arena goes away in one step when the interaction is done.
+        key_values values;
+        generate_key_values(event, values, wanted, guild, channel);
+        const response_template *response = &no_response;
+
+        if (command)
+        {
+            if (command->response)
+            {
+                response = &*command->response;
+            }
+            if (command->has_actions())
+            {
+                if (log::enabled(log::level::debug))
+                {
+                    log::write(log::level::debug, where, "Running " + std::to_string(command->graph.nodes().size()) + " actions");
+                }
+                bool already_returned_message = false;
+                try
+                {
+                    already_returned_message = co_await ::handle_actions(event, command->graph, values, *reply, *rest);
+                }
+                catch (const std::exception &e)
+                {
+                    // Left uncaught, the coroutine would end without a final response and the user would see "thinking" forever.
+                    log::error(where, std::string("Running the actions failed: ") + e.what());
+                    reply->finish(std::string("The command failed: ") + e.what());
+                    co_return;
+                }
+                if (!already_returned_message)
+                {
+                    // The failing action has already sent its error as the final response.
+                    log::debug(where, "An action failed and answered the interaction");
+                    co_return;
+                }
+                // A direct reply if the actions finished before the deadline, an edit of the deferred response otherwise.
+                log::debug(where, "Actions done, sending the response");
+            }
+            else
+            {
+                log::debug(where, "Replying");
+            }
+        }
+        else
+        {
+            log::debug(where, "No command configured, replying with the default response");
+        }
+
+        if (reply)
+        {
+            reply->finish(response->render(values));
+            co_return;
+        }
+        rest->interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_channel_message_with_source, dpp::message(response->render(values))), [timer, running, bot_id = id](const dpp::confirmation_callback_t &result)
+                                          {
+                                              metrics::rest_call(bot_id, "interaction_reply", result.is_error());
+                                              if (result.is_error())
+                                              {
+                                                  log::warning({bot_id}, "Replying to an interaction failed: " + result.get_error().message);
+                                                  return;
+                                              }
+                                              timer.acked();
+                                              timer.responded(); });
+    }
+
+    void bot_instance::on_autocomplete(const dpp::autocomplete_t &event)
+    {
+        // Answered even while draining, but counted like any interaction so the instance outlives it.
+        bool accepted = false;
+        std::shared_ptr<void> running = track_interaction(accepted);
+        if (!running)
+        {
+            return;
+        }
+        dpp::autocomplete_interaction data = event.command.get_autocomplete_interaction();
+        std::shared_ptr<const command_table> table = commands.load(std::memory_order_acquire);
+        const command_entry *command = table->find(data.name);
+        const dpp::command_data_option *focused = focused_option(data.options);
+        // Unanswered, Discord shows "Loading options failed"; an empty list reads as "no match".
+        dpp::interaction_response response(dpp::ir_autocomplete_reply);
+        if (command && focused)
+        {
+            auto it = command->autocomplete.find(focused->name);
+            if (it != command->autocomplete.end())
+            {
+                for (const dpp::command_option_choice *choice : it->second.complete(typed_text(focused->value)))
+                {
+                    response.add_autocomplete_choice(*choice);
+                }
+            }
+            else
+            {
+                log::debug({id, event.command.guild_id, data.name}, "No autocomplete choices for option " + focused->name);
+            }
+        }
+        rest->interaction_response_create(event.command.id, event.command.token, response, [bot_id = id, running](const dpp::confirmation_callback_t &result)
+                                          {
+                                              if (result.is_error())
+                                              {
+                                                  log::debug({bot_id}, "Answering an autocomplete failed: " + result.get_error().message);
+                                              } });
+    }
+
+    void bot_instance::adopt_commands(bot_instance &previous)
+    {
+        // Under the previous instance's lock, so an update it is applying right now isn't lost.
+        std::scoped_lock lock(previous.updates.mutex(), updates.mutex());
+        commands.store(previous.commands.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    std::optional<nlohmann::json> bot_instance::handle_command(const nlohmann::json &body)
+    {
+        return handle_command(body, updates.arrive());
+    }
+
+    std::optional<nlohmann::json> bot_instance::handle_command(const nlohmann::json &body, const update_sequencer::ticket &ticket)
+    {
+        if (!body.contains("command"))
+        {
+            return std::nullopt;
+        }
+        nlohmann::json result = nlohmann::json::object();
+        if (body["command"] == "update")
+        {
+            auto start = metrics::clock::now();
+            publish(command_table::build(body["data"]), start, ticket);
+        }
+        else if (body["command"] == "patch")
+        {
+            // Applied to the table every earlier body has left, and in one go, so patches don't drop one another.
+            bool applied = updates.amend(ticket, [this, &body]
+                                         {
+                auto start = metrics::clock::now();
+                auto table = commands.load(std::memory_order_acquire)->patch(body);
+                metrics::config_reloaded(id, metrics::clock::now() - start, table->size());
+                commands.store(table, std::memory_order_release);
+                save_snapshot(std::move(table)); });
+            if (!applied)
+            {
+                log::info({id}, "Dropped a patch: an update that arrived after it was published first");
+            }
+        }
+        else if (body["command"] == "update_status")
+        {
+            // Paced and coalesced; the gateway is never touched from the webhook thread.
+            std::string_view outcome = presence_scheduler::outcome_name(update_status(body));
+            log::debug({id}, "Presence " + std::string(outcome));
+            result["presence"] = outcome;
+        }
+        else if (body["command"] == "log_level")
+        {
+            // The threshold is process-wide: in host mode it applies to every bot.
+            auto lvl = log::level_from_string(body.value("level", ""));
+            if (!lvl)
+            {
+                throw std::invalid_argument("Invalid log level");
+            }
+            log::set_level(*lvl);
+        }
+        return result;
+    }
+
+    std::optional<nlohmann::json> bot_instance::handle_request(std::string_view body, std::string_view command)
+    {
+        auto start = metrics::clock::now();
+        // Taken before the body is read: its place in line is when it arrived, not when it finished compiling.
+        update_sequencer::ticket ticket = updates.arrive();
+        command_body parsed = read_command_body(body, command);
+        if (parsed.table)
+        {
+            publish(std::move(parsed.table), start, ticket);
+            return nlohmann::json::object();
+        }
+        return handle_command(parsed.envelope, ticket);
+    }
+
+    void bot_instance::publish(std::shared_ptr<const command_table> table, metrics::clock::time_point started, const update_sequencer::ticket &ticket)
+    {
+        bool published = updates.replace(ticket, [this, &table, started]
+                                         {
+            metrics::config_reloaded(id, metrics::clock::now() - started, table->size());
+            commands.store(table, std::memory_order_release);
+            save_snapshot(std::move(table)); });
+        if (!published)
+        {
+            log::info({id}, "Dropped an update: one that arrived after it was published first");
+        }
+    }
+
+    void bot_instance::save_snapshot(std::shared_ptr<const command_table> table)
+    {
+        if (!snapshot_path.empty())
+        {
+            config_snapshot::writer::instance().submit(snapshot_path, std::move(table));
+        }
+    }
+
+    presence_scheduler::outcome bot_instance::update_status(const nlohmann::json &body)
+    {
+        std::string status = body.contains("status") ? body["status"] : "online";
+        std::string activity = body.contains("activity") ? body["activity"] : "";
+        std::string activity_status = body.contains("activity_status") ? body["activity_status"] : "";
+        std::string activity_url = body.contains("activity_url") ? body["activity_url"] : "";
+        std::string activity_type = body.contains("activity_type") ? body["activity_type"] : "playing";
+        dpp::presence p;
+        if (status == "online")
+        {
+            p = dpp::presence(dpp::presence_status::ps_online, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
+        }
+        else if (status == "offline")
+        {
+            p = dpp::presence(dpp::presence_status::ps_offline, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
+        }
+        else if (status == "dnd")
+        {
+            p = dpp::presence(dpp::presence_status::ps_dnd, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
+        }
+        else if (status == "idle")
+        {
+            p = dpp::presence(dpp::presence_status::ps_idle, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
+        }
+        else if (status == "invisible")
+        {
+            p = dpp::presence(dpp::presence_status::ps_invisible, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
+        }
+        return presence.request(p);
+    }
+} // namespace app
@@ -0,0 +1,141 @@
+#include "../include/choice_index.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace app
+{
+    namespace
+    {
+        // Discord's limit on a choice's name and on a string value, in characters (code points)...
+        constexpr size_t max_length = 100;
+        // ...so up to 4 bytes each in UTF-8.
+        constexpr size_t max_bytes = max_length * 4;
+
+        size_t utf8_length(std::string_view text)
+        {
+            // Counts the bytes that start a sequence, skipping continuation bytes (10xxxxxx).
+            return static_cast<size_t>(std::count_if(text.begin(), text.end(), [](char c)
+                                                     { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }));
+        }
+
+        char fold(char c)
+        {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        // Negative when key sorts before every key starting with typed, zero when it starts with it.
+        int compare_prefix(std::string_view key, std::string_view typed)
+        {
+            size_t n = std::min(key.size(), typed.size());
+            for (size_t i = 0; i < n; ++i)
+            {
+                unsigned char a = static_cast<unsigned char>(key[i]);
+                unsigned char b = static_cast<unsigned char>(fold(typed[i]));
+                if (a != b)
+                {
+                    return a < b ? -1 : 1;
+                }
+            }
+            return key.size() < typed.size() ? -1 : 0;
+        }
+
+        dpp::command_value value_from_json(const nlohmann::json &value)
+        {
+            if (value.is_string())
+            {
+                if (utf8_length(value.get_ref<const std::string &>()) > max_length)
+                {
+                    throw std::invalid_argument("autocomplete values are limited to 100 characters");
+                }
+                return value.get<std::string>();
+            }
+            if (value.is_number_integer())
+            {
+                return value.get<int64_t>();
+            }
+            if (value.is_number_float())
+            {
+                return value.get<double>();
+            }
+            throw std::invalid_argument("autocomplete values must be strings or numbers");
+        }
+
+        dpp::command_option_choice choice_from_json(const nlohmann::json &item)
+        {
+            std::string name;
+            dpp::command_value value;
+            if (item.is_object())
+            {
+                if (!item.contains("name") || !item["name"].is_string() || !item.contains("value"))
+                {
+                    throw std::invalid_argument("autocomplete choices need a name and a value");
+                }
+                name = item["name"].get<std::string>();
+                value = value_from_json(item["value"]);
+            }
+            else
+            {
+                value = value_from_json(item);
+                name = item.is_string() ? item.get<std::string>() : item.dump();
+            }
+            if (name.empty() || utf8_length(name) > max_length)
+            {
+                throw std::invalid_argument("autocomplete choice names must be 1 to 100 characters");
+            }
+            return dpp::command_option_choice(name, value);
+        }
+    }
+
+    choice_index choice_index::from_json(const nlohmann::json &choices)
+    {
+        if (!choices.is_array())
+        {
+            throw std::invalid_argument("autocomplete choices must be an array");
+        }
+        if (choices.size() > UINT32_MAX / max_bytes)
+        {
+            throw std::invalid_argument("too many autocomplete choices");
+        }
+        choice_index index;
+        index.choices.reserve(choices.size());
+        index.sorted.reserve(choices.size());
+        for (const auto &item : choices)
+        {
+            const dpp::command_option_choice &choice = index.choices.emplace_back(choice_from_json(item));
+            index.sorted.push_back({static_cast<uint32_t>(index.keys.size()), static_cast<uint32_t>(choice.name.size()), static_cast<uint32_t>(index.choices.size() - 1)});
+            for (char c : choice.name)
+            {
+                index.keys += fold(c);
+            }
+        }
+        std::sort(index.sorted.begin(), index.sorted.end(), [&index](const entry &a, const entry &b)
+                  {
+                      int order = index.key_of(a).compare(index.key_of(b));
+                      return order != 0 ? order < 0 : a.choice < b.choice; });
+        return index;
+    }
+
+    std::vector<const dpp::command_option_choice *> choice_index::complete(std::string_view typed, size_t limit) const
+    {
+        typed.remove_prefix(std::min(typed.find_first_not_of(' '), typed.size()));
+        std::vector<const dpp::command_option_choice *> matches;
+        limit = std::min(limit, choices.size());
+        matches.reserve(limit);
+        if (typed.empty())
+        {
+            for (size_t i = 0; i < limit; ++i)
+            {
+                matches.push_back(&choices[i]);
+            }
+            return matches;
+        }
+        // Keys starting with typed are contiguous in the sorted array: find the first, then walk.
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), typed, [this](const entry &e, std::string_view prefix)
+                                   { return compare_prefix(key_of(e), prefix) < 0; });
+        for (; it != sorted.end() && matches.size() < limit && compare_prefix(key_of(*it), typed) == 0; ++it)
+        {
+            matches.push_back(&choices[it->choice]);
+        }
+        return matches;
+    }
+} // namespace app
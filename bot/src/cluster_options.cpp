@@ -0,0 +1,145 @@
+#include "../include/cluster_options.hpp"
+#include "../include/utils.hpp"
+#include <cstdlib>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace app
+{
+    namespace
+    {
+        constexpr std::pair<std::string_view, uint32_t> intent_names[] = {
+            {"guilds", dpp::i_guilds},
+            {"guild_members", dpp::i_guild_members},
+            {"guild_voice_states", dpp::i_guild_voice_states},
+            {"guild_presences", dpp::i_guild_presences},
+            {"guild_messages", dpp::i_guild_messages},
+            {"guild_message_reactions", dpp::i_guild_message_reactions},
+            {"direct_messages", dpp::i_direct_messages},
+            {"message_content", dpp::i_message_content},
+            {"default", dpp::i_default_intents},
+            {"privileged", dpp::i_privileged_intents},
+            {"all", dpp::i_all_intents},
+        };
+
+        uint32_t intents_from_json(const nlohmann::json &j)
+        {
+            if (j.is_number_unsigned())
+            {
+                return j.get<uint32_t>();
+            }
+            if (!j.is_array())
+            {
+                throw std::invalid_argument("intents must be a number or an array of names");
+            }
+            uint32_t intents = 0;
+            for (const auto &name : j)
+            {
+                bool found = false;
+                for (const auto &[candidate, bits] : intent_names)
+                {
+                    if (name.is_string() && candidate == name.get_ref<const std::string &>())
+                    {
+                        intents |= bits;
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found)
+                {
+                    throw std::invalid_argument("Unknown intent " + name.dump());
+                }
+            }
+            return intents;
+        }
+
+        dpp::cache_policy_setting_t policy_from_string(const std::string &name)
+        {
+            if (name == "aggressive")
+            {
+                return dpp::cp_aggressive;
+            }
+            else if (name == "lazy")
+            {
+                return dpp::cp_lazy;
+            }
+            else if (name == "none")
+            {
+                return dpp::cp_none;
+            }
+            throw std::invalid_argument("Unknown cache policy " + name);
+        }
+    }
+
+    cluster_options cluster_options::from_json(const nlohmann::json &j)
+    {
+        cluster_options options;
+        if (!j.is_object())
+        {
+            return options;
+        }
+        if (j.contains("intents"))
+        {
+            options.intents = intents_from_json(j["intents"]);
+        }
+        if (j.contains("shards"))
+        {
+            options.shards = j["shards"].get<uint32_t>();
+        }
+        if (j.contains("cluster_id"))
+        {
+            options.cluster_id = j["cluster_id"].get<uint32_t>();
+        }
+        if (j.contains("max_clusters"))
+        {
+            options.max_clusters = j["max_clusters"].get<uint32_t>();
+        }
+        if (options.max_clusters == 0 || options.cluster_id >= options.max_clusters)
+        {
+            throw std::invalid_argument("cluster_id must be below max_clusters");
+        }
+        if (j.contains("cache") && j["cache"].is_object())
+        {
+            for (const auto &[field, value] : j["cache"].items())
+            {
+                auto policy = policy_from_string(value.get<std::string>());
+                if (field == "users" || field == "members")
+                {
+                    options.cache_policy.user_policy = policy;
+                }
+                else if (field == "roles")
+                {
+                    options.cache_policy.role_policy = policy;
+                }
+                else if (field == "channels")
+                {
+                    options.cache_policy.channel_policy = policy;
+                }
+                else if (field == "guilds")
+                {
+                    options.cache_policy.guild_policy = policy;
+                }
+                else if (field == "emojis")
+                {
+                    options.cache_policy.emoji_policy = policy;
+                }
+                else
+                {
+                    throw std::invalid_argument("Unknown cache " + field);
+                }
+            }
+        }
+        return options;
+    }
+
+    cluster_options cluster_options::from_env()
+    {
+        const char *raw = getenv("BOT_CLUSTER_OPTIONS");
+        if (!raw || !*raw)
+        {
+            return {};
+        }
+        return from_json(json_from_string(raw));
+    }
+} // namespace app
@@ -0,0 +1,197 @@
+#include "../include/command_table.hpp"
+#include <stdexcept>
+
+namespace app
+{
+    namespace
+    {
+        // Actions read key_values through `depend_on`, and any string field may hold ((placeholders)).
+        void collect_action_keys(const nlohmann::json &value, placeholder_set &keys)
+        {
+            if (value.is_string())
+            {
+                // Named, so it outlives the loop: keys() returns a reference into it.
+                response_template compiled(value.get<std::string>());
+                for (const auto &key : compiled.keys())
+                {
+                    keys.add(key);
+                }
+            }
+            else if (value.is_structured())
+            {
+                for (const auto &[field, child] : value.items())
+                {
+                    if (field == "depend_on" && child.is_string())
+                    {
+                        keys.add(child.get_ref<const std::string &>());
+                    }
+                    else
+                    {
+                        collect_action_keys(child, keys);
+                    }
+                }
+            }
+        }
+    }
+
+    command_table::builder::builder(size_t expected) : table(std::make_shared<command_table>())
+    {
+        table->commands_.reserve(expected);
+    }
+
+    void command_table::builder::add(const std::string &name, nlohmann::json command_data)
+    {
+        if (auto entry = compile(name, std::move(command_data)))
+        {
+            table->commands_.insert_or_assign(name, std::move(entry));
+        }
+        else
+        {
+            table->commands_.erase(name);
+        }
+    }
+
+    std::shared_ptr<const command_table> command_table::build(const nlohmann::json &data)
+    {
+        if (!data.is_object())
+        {
+            return std::make_shared<command_table>();
+        }
+
+        builder table(data.size());
+        for (const auto &[command_name, command_data] : data.items())
+        {
+            table.add(command_name, command_data);
+        }
+        return table.finish();
+    }
+
+    std::shared_ptr<const command_table> command_table::patch(const nlohmann::json &body) const
+    {
+        auto table = std::make_shared<command_table>(*this);
+
+        auto upsert = [&table](const std::string &name, nlohmann::json command_data)
+        {
+            if (auto entry = compile(name, std::move(command_data)))
+            {
+                table->commands_.insert_or_assign(name, std::move(entry));
+            }
+            else
+            {
+                // Whatever isn't an object isn't a command, as in build().
+                table->commands_.erase(name);
+            }
+        };
+
+        if (body.contains("data"))
+        {
+            const nlohmann::json &data = body["data"];
+            if (!data.is_object())
+            {
+                // RFC 7396 would replace the whole document, dropping `upsert` and `delete` with it, and `null`
+                // would wipe every command: a whole new map is an `update`, not a patch.
+                throw std::invalid_argument("Patch data must be an object of command names to merge-patches");
+            }
+            for (const auto &[name, command_patch] : data.items())
+            {
+                if (command_patch.is_null())
+                {
+                    table->commands_.erase(name);
+                    continue;
+                }
+                auto it = table->commands_.find(name);
+                nlohmann::json merged = it != table->commands_.end() ? it->second->source : nlohmann::json::object();
+                merged.merge_patch(command_patch);
+                upsert(name, std::move(merged));
+            }
+        }
+        if (body.contains("upsert") && body["upsert"].is_object())
+        {
+            for (const auto &[name, command_data] : body["upsert"].items())
+            {
+                upsert(name, command_data);
+            }
+        }
+        if (body.contains("delete") && body["delete"].is_array())
+        {
+            for (const auto &name : body["delete"])
+            {
+                if (name.is_string())
+                {
+                    table->commands_.erase(name.get<std::string>());
+                }
+            }
+        }
+        return table;
+    }
+
+    std::shared_ptr<const command_entry> command_table::compile(const std::string &command_name, nlohmann::json command_data)
+    {
+        if (!command_data.is_object())
+        {
+            return nullptr;
+        }
+        auto entry = std::make_shared<command_entry>();
+        entry->name = command_name;
+        if (command_data.contains("actions") && command_data["actions"].is_array())
+        {
+            const nlohmann::json &actions = command_data["actions"];
+            try
+            {
+                entry->graph = action_graph::compile(actions);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                throw std::invalid_argument("Command " + command_name + ": " + e.what());
+            }
+            collect_action_keys(actions, entry->placeholders);
+        }
+        if (command_data.contains("response") && command_data["response"].is_string())
+        {
+            entry->response.emplace(command_data["response"].get<std::string>());
+            for (const auto &key : entry->response->keys())
+            {
+                entry->placeholders.add(key);
+            }
+        }
+        if (command_data.contains("rate_limit"))
+        {
+            try
+            {
+                entry->admission = admission_policy::from_json(command_data["rate_limit"]);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                throw std::invalid_argument("Command " + command_name + ": " + e.what());
+            }
+        }
+        // null is the same as no autocomplete; anything else but an object is a config mistake.
+        if (command_data.contains("autocomplete") && !command_data["autocomplete"].is_null())
+        {
+            if (!command_data["autocomplete"].is_object())
+            {
+                throw std::invalid_argument("Command " + command_name + ": autocomplete must be an object of option names to choice lists");
+            }
+            for (const auto &[option, choices] : command_data["autocomplete"].items())
+            {
+                try
+                {
+                    entry->autocomplete.emplace(option, choice_index::from_json(choices));
+                }
+                catch (const std::invalid_argument &e)
+                {
+                    throw std::invalid_argument("Command " + command_name + ", option " + option + ": " + e.what());
+                }
+            }
+        }
+        // Moved last: everything above reads from it.
+        entry->source = std::move(command_data);
+        return entry;
+    }
+
+    const command_entry *command_table::find(const std::string &name) const
+    {
+        auto it = commands_.find(name);
+        return it != commands_.end() ? it->second.get() : nullptr;
+    }
+} // namespace app
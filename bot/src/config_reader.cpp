@@ -0,0 +1,669 @@
+#include "../include/config_reader.hpp"
+#include "../include/log.hpp"
+#include "../include/utils.hpp"
+#include <charconv>
+#include <cstring>
+#include <optional>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace app
+{
+    namespace
+    {
+        // Anything the reader won't handle itself; the caller retries with nlohmann.
+        struct rejected
+        {
+        };
+
+        // value() and skip_value() recurse once per nesting level, so the depth bounds this reader's own stack use.
+        // Deeper documents are rejected and parsed by nlohmann, whose parser is iterative.
+        constexpr int max_depth = 256;
+
+        // The first byte at or after p that ends an unescaped run: a quote, a backslash, a control
+        // character or a non-ASCII byte (checked as UTF-8 one sequence at a time).
+        const char *scan_string(const char *p, const char *end)
+        {
+#if defined(__SSE2__)
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            const __m128i control = _mm_set1_epi8(0x1F);
+            while (end - p >= 16)
+            {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+                stops = _mm_or_si128(stops, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+                // The sign bit of each byte flags non-ASCII on its own.
+                int mask = _mm_movemask_epi8(stops) | _mm_movemask_epi8(chunk);
+                if (mask != 0)
+                {
+                    return p + __builtin_ctz(static_cast<unsigned>(mask));
+                }
+                p += 16;
+            }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+            while (end - p >= 16)
+            {
+                uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t *>(p));
+                uint8x16_t stops = vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('"')), vceqq_u8(chunk, vdupq_n_u8('\\')));
+                stops = vorrq_u8(stops, vcltq_u8(chunk, vdupq_n_u8(0x20)));
+                stops = vorrq_u8(stops, vcgeq_u8(chunk, vdupq_n_u8(0x80)));
+                if (vmaxvq_u8(stops) != 0)
+                {
+                    break;
+                }
+                p += 16;
+            }
+#endif
+            for (; p < end; ++p)
+            {
+                unsigned char c = static_cast<unsigned char>(*p);
+                if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80)
+                {
+                    return p;
+                }
+            }
+            return end;
+        }
+
+        // The length of the UTF-8 sequence at p, or 0 when it isn't valid (RFC 3629, as nlohmann checks it).
+        size_t utf8_length(const unsigned char *p, const unsigned char *end)
+        {
+            auto in = [&](size_t i, unsigned char low, unsigned char high)
+            { return p + i < end && p[i] >= low && p[i] <= high; };
+            unsigned char c = p[0];
+            if (c >= 0xC2 && c <= 0xDF)
+            {
+                return in(1, 0x80, 0xBF) ? 2 : 0;
+            }
+            if (c == 0xE0)
+            {
+                return in(1, 0xA0, 0xBF) && in(2, 0x80, 0xBF) ? 3 : 0;
+            }
+            if ((c >= 0xE1 && c <= 0xEC) || c == 0xEE || c == 0xEF)
+            {
+                return in(1, 0x80, 0xBF) && in(2, 0x80, 0xBF) ? 3 : 0;
+            }
+            if (c == 0xED)
+            {
+                return in(1, 0x80, 0x9F) && in(2, 0x80, 0xBF) ? 3 : 0;
+            }
+            if (c == 0xF0)
+            {
+                return in(1, 0x90, 0xBF) && in(2, 0x80, 0xBF) && in(3, 0x80, 0xBF) ? 4 : 0;
+            }
+            if (c >= 0xF1 && c <= 0xF3)
+            {
+                return in(1, 0x80, 0xBF) && in(2, 0x80, 0xBF) && in(3, 0x80, 0xBF) ? 4 : 0;
+            }
+            if (c == 0xF4)
+            {
+                return in(1, 0x80, 0x8F) && in(2, 0x80, 0xBF) && in(3, 0x80, 0xBF) ? 4 : 0;
+            }
+            return 0;
+        }
+
+        void append_utf8(std::string &out, uint32_t cp)
+        {
+            if (cp < 0x80)
+            {
+                out += static_cast<char>(cp);
+            }
+            else if (cp < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+        }
+
+        /**
+         * @brief A recursive descent JSON reader producing nlohmann::json values
+         */
+        class reader
+        {
+        public:
+            explicit reader(std::string_view text) : p(text.data()), end(text.data() + text.size()) {}
+
+            nlohmann::json document()
+            {
+                nlohmann::json result = value(0);
+                finish();
+                return result;
+            }
+
+            // A top-level object whose `data` member is handed to on_data instead of being stored.
+            template <typename OnData>
+            nlohmann::json envelope(OnData &&on_data)
+            {
+                nlohmann::json result = nlohmann::json::object();
+                auto &fields = result.get_ref<nlohmann::json::object_t &>();
+                expect('{');
+                if (!consume('}'))
+                {
+                    do
+                    {
+                        std::string key = key_then_colon();
+                        skip_whitespace();
+                        if (key == "data" && p < end && *p == '{')
+                        {
+                            fields.erase(key);
+                            on_data(*this);
+                        }
+                        else
+                        {
+                            fields.insert_or_assign(std::move(key), value(1));
+                        }
+                    } while (consume(','));
+                    expect('}');
+                }
+                finish();
+                return result;
+            }
+
+            // Calls fn(name, config) for every member of the object at the cursor.
+            template <typename Fn>
+            void members(Fn &&fn)
+            {
+                expect('{');
+                if (consume('}'))
+                {
+                    return;
+                }
+                do
+                {
+                    std::string key = key_then_colon();
+                    fn(std::move(key), value(2));
+                } while (consume(','));
+                expect('}');
+            }
+
+            // The first top-level `command` member if it is a string; values before it are skipped.
+            std::optional<std::string> command()
+            {
+                expect('{');
+                if (consume('}'))
+                {
+                    return std::nullopt;
+                }
+                do
+                {
+                    std::string key = key_then_colon();
+                    skip_whitespace();
+                    if (key == "command")
+                    {
+                        if (p < end && *p == '"')
+                        {
+                            ++p;
+                            return string();
+                        }
+                        return std::nullopt;
+                    }
+                    skip_value(1);
+                } while (consume(','));
+                return std::nullopt;
+            }
+
+        private:
+            [[noreturn]] static void reject() { throw rejected(); }
+
+            void skip_whitespace()
+            {
+                while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                {
+                    ++p;
+                }
+            }
+
+            bool consume(char c)
+            {
+                skip_whitespace();
+                if (p < end && *p == c)
+                {
+                    ++p;
+                    return true;
+                }
+                return false;
+            }
+
+            void expect(char c)
+            {
+                if (!consume(c))
+                {
+                    reject();
+                }
+            }
+
+            void finish()
+            {
+                skip_whitespace();
+                if (p != end)
+                {
+                    reject();
+                }
+            }
+
+            std::string key_then_colon()
+            {
+                expect('"');
+                std::string key = string();
+                expect(':');
+                return key;
+            }
+
+            nlohmann::json value(int depth)
+            {
+                if (depth > max_depth)
+                {
+                    reject();
+                }
+                skip_whitespace();
+                if (p == end)
+                {
+                    reject();
+                }
+                switch (*p)
+                {
+                case '{':
+                {
+                    ++p;
+                    nlohmann::json object = nlohmann::json::object();
+                    if (consume('}'))
+                    {
+                        return object;
+                    }
+                    auto &entries = object.get_ref<nlohmann::json::object_t &>();
+                    do
+                    {
+                        std::string key = key_then_colon();
+                        // Last one wins on duplicate keys, as with nlohmann's parser.
+                        entries.insert_or_assign(std::move(key), value(depth + 1));
+                    } while (consume(','));
+                    expect('}');
+                    return object;
+                }
+                case '[':
+                {
+                    ++p;
+                    nlohmann::json array = nlohmann::json::array();
+                    if (consume(']'))
+                    {
+                        return array;
+                    }
+                    auto &items = array.get_ref<nlohmann::json::array_t &>();
+                    do
+                    {
+                        items.push_back(value(depth + 1));
+                    } while (consume(','));
+                    expect(']');
+                    return array;
+                }
+                case '"':
+                    ++p;
+                    return string();
+                case 't':
+                    literal("true");
+                    return true;
+                case 'f':
+                    literal("false");
+                    return false;
+                case 'n':
+                    literal("null");
+                    return nullptr;
+                default:
+                    return number();
+                }
+            }
+
+            void literal(std::string_view word)
+            {
+                if (static_cast<size_t>(end - p) < word.size() || std::memcmp(p, word.data(), word.size()) != 0)
+                {
+                    reject();
+                }
+                p += word.size();
+            }
+
+            uint32_t hex4()
+            {
+                if (end - p < 4)
+                {
+                    reject();
+                }
+                uint32_t value = 0;
+                auto [next, error] = std::from_chars(p, p + 4, value, 16);
+                if (error != std::errc() || next != p + 4)
+                {
+                    reject();
+                }
+                p += 4;
+                return value;
+            }
+
+            // The string after an opening quote, up to and including its closing quote.
+            std::string string()
+            {
+                std::string out;
+                while (true)
+                {
+                    const char *stop = scan_string(p, end);
+                    out.append(p, stop);
+                    p = stop;
+                    if (p == end)
+                    {
+                        reject();
+                    }
+                    unsigned char c = static_cast<unsigned char>(*p);
+                    if (c == '"')
+                    {
+                        ++p;
+                        return out;
+                    }
+                    if (c >= 0x80)
+                    {
+                        size_t length = utf8_length(reinterpret_cast<const unsigned char *>(p), reinterpret_cast<const unsigned char *>(end));
+                        if (length == 0)
+                        {
+                            reject();
+                        }
+                        out.append(p, length);
+                        p += length;
+                        continue;
+                    }
+                    if (c != '\\' || end - p < 2)
+                    {
+                        // A raw control character.
+                        reject();
+                    }
+                    char escape = p[1];
+                    p += 2;
+                    switch (escape)
+                    {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        out += escape;
+                        break;
+                    case 'b':
+                        out += '\b';
+                        break;
+                    case 'f':
+                        out += '\f';
+                        break;
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 'r':
+                        out += '\r';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'u':
+                    {
+                        uint32_t cp = hex4();
+                        if (cp >= 0xD800 && cp <= 0xDBFF)
+                        {
+                            if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+                            {
+                                reject();
+                            }
+                            p += 2;
+                            uint32_t low = hex4();
+                            if (low < 0xDC00 || low > 0xDFFF)
+                            {
+                                reject();
+                            }
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        else if (cp >= 0xDC00 && cp <= 0xDFFF)
+                        {
+                            reject();
+                        }
+                        append_utf8(out, cp);
+                        break;
+                    }
+                    default:
+                        reject();
+                    }
+                }
+            }
+
+            nlohmann::json number()
+            {
+                const char *start = p;
+                bool negative = p < end && *p == '-';
+                if (negative)
+                {
+                    ++p;
+                }
+                auto digits = [this]
+                {
+                    const char *from = p;
+                    while (p < end && *p >= '0' && *p <= '9')
+                    {
+                        ++p;
+                    }
+                    return p - from;
+                };
+                const char *integer = p;
+                auto integer_digits = digits();
+                if (integer_digits == 0 || (*integer == '0' && integer_digits > 1))
+                {
+                    reject();
+                }
+                bool is_float = false;
+                if (p < end && *p == '.')
+                {
+                    ++p;
+                    if (digits() == 0)
+                    {
+                        reject();
+                    }
+                    is_float = true;
+                }
+                if (p < end && (*p == 'e' || *p == 'E'))
+                {
+                    ++p;
+                    if (p < end && (*p == '+' || *p == '-'))
+                    {
+                        ++p;
+                    }
+                    if (digits() == 0)
+                    {
+                        reject();
+                    }
+                    is_float = true;
+                }
+                // Same types as nlohmann: unsigned, then signed, then double once a value doesn't fit.
+                if (!is_float)
+                {
+                    if (negative)
+                    {
+                        int64_t value;
+                        if (std::from_chars(start, p, value).ec == std::errc())
+                        {
+                            return value;
+                        }
+                    }
+                    else
+                    {
+                        uint64_t value;
+                        if (std::from_chars(start, p, value).ec == std::errc())
+                        {
+                            return value;
+                        }
+                    }
+                }
+                double value;
+                if (std::from_chars(start, p, value).ec != std::errc())
+                {
+                    // Out of range: nlohmann reports the overflow.
+                    reject();
+                }
+                return value;
+            }
+
+            // Like string(), without keeping the characters; the escapes are checked by the full read.
+            void skip_string()
+            {
+                while (true)
+                {
+                    p = scan_string(p, end);
+                    if (p == end)
+                    {
+                        reject();
+                    }
+                    if (*p == '"')
+                    {
+                        ++p;
+                        return;
+                    }
+                    p += *p == '\\' ? 2 : 1;
+                }
+            }
+
+            void skip_value(int depth)
+            {
+                if (depth > max_depth)
+                {
+                    reject();
+                }
+                skip_whitespace();
+                if (p == end)
+                {
+                    reject();
+                }
+                char open = *p;
+                if (open == '"')
+                {
+                    ++p;
+                    skip_string();
+                    return;
+                }
+                if (open != '{' && open != '[')
+                {
+                    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+                    {
+                        ++p;
+                    }
+                    return;
+                }
+                ++p;
+                char close = open == '{' ? '}' : ']';
+                if (consume(close))
+                {
+                    return;
+                }
+                do
+                {
+                    if (open == '{')
+                    {
+                        skip_whitespace();
+                        expect('"');
+                        skip_string();
+                        expect(':');
+                    }
+                    skip_value(depth + 1);
+                } while (consume(','));
+                expect(close);
+            }
+
+            const char *p;
+            const char *end;
+        };
+
+        // What json_from_string does once the reader has given up: null on invalid JSON, with the error logged.
+        nlohmann::json parse_with_nlohmann(std::string_view text)
+        {
+            try
+            {
+                return nlohmann::json::parse(text);
+            }
+            catch (const nlohmann::json::parse_error &e)
+            {
+                log::error({}, std::string("JSON parse error: ") + e.what());
+                return nullptr;
+            }
+        }
+    }
+
+    nlohmann::json parse_json(std::string_view text)
+    {
+        try
+        {
+            return reader(text).document();
+        }
+        catch (const rejected &)
+        {
+            return nlohmann::json::parse(text);
+        }
+    }
+
+    std::string peek_command(std::string_view body)
+    {
+        try
+        {
+            return reader(body).command().value_or("");
+        }
+        catch (const rejected &)
+        {
+            return "";
+        }
+    }
+
+    command_body read_command_body(std::string_view body, std::string_view command)
+    {
+        if (command != "update")
+        {
+            return {json_from_string(body), nullptr};
+        }
+        try
+        {
+            command_body result;
+            result.envelope = reader(body).envelope([&result](reader &data)
+                                                    {
+                                                        // A repeated `data` replaces the earlier one, as a repeated key would.
+                                                        command_table::builder table;
+                                                        data.members([&table](std::string name, nlohmann::json config)
+                                                                     { table.add(name, std::move(config)); });
+                                                        result.table = table.finish(); });
+            // The first `command` was peeked; a later duplicate would be the one nlohmann keeps.
+            auto command = result.envelope.find("command");
+            if (command == result.envelope.end() || !command->is_string() || *command != "update")
+            {
+                throw rejected();
+            }
+            if (result.envelope.contains("data"))
+            {
+                // The last `data` wasn't an object, so it stayed in the envelope; build() treats it as no commands.
+                result.table = command_table::build(result.envelope["data"]);
+            }
+            else if (!result.table)
+            {
+                result.table = std::make_shared<const command_table>();
+            }
+            return result;
+        }
+        catch (const rejected &)
+        {
+            // Straight to nlohmann: going through json_from_string would run the reader over it again first.
+            return {parse_with_nlohmann(body), nullptr};
+        }
+    }
+} // namespace app
@@ -0,0 +1,307 @@
+#include "../include/config_snapshot.hpp"
+#include "../include/log.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace app::config_snapshot
+{
+    namespace
+    {
+        constexpr char magic[8] = {'B', 'C', 'S', 'N', 'A', 'P', '\0', '\1'};
+        constexpr uint32_t format_version = 1;
+
+        struct header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t count;
+            uint64_t data_size;
+            uint64_t checksum;
+        };
+
+        struct index_entry
+        {
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t config_offset;
+            uint32_t config_length;
+        };
+
+        // FNV-1a; enough to catch a torn or truncated file, this is not about tampering.
+        uint64_t checksum(const uint8_t *data, size_t size)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ data[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        bool write_all(int fd, const char *data, size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t written = ::write(fd, data, size);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                data += written;
+                size -= written;
+            }
+            return true;
+        }
+
+        // mkdir -p: BOT_SNAPSHOT_DIR may name a path none of whose parts exist yet.
+        bool make_directories(const std::string &directory)
+        {
+            for (size_t slash = directory.find('/', 1); ; slash = directory.find('/', slash + 1))
+            {
+                std::string part = directory.substr(0, slash);
+                if (!part.empty() && mkdir(part.c_str(), 0700) != 0 && errno != EEXIST)
+                {
+                    log::error({}, "Cannot create directory " + part + " (set BOT_SNAPSHOT_DIR to a writable directory): " + strerror(errno));
+                    return false;
+                }
+                if (slash == std::string::npos)
+                {
+                    return true;
+                }
+            }
+        }
+
+        // Unmaps on every return path of load().
+        struct mapping
+        {
+            void *address = MAP_FAILED;
+            size_t size = 0;
+            ~mapping()
+            {
+                if (address != MAP_FAILED)
+                {
+                    munmap(address, size);
+                }
+            }
+        };
+    }
+
+    std::string path_for(uint64_t bot_id)
+    {
+        const char *dir = getenv("BOT_SNAPSHOT_DIR");
+        std::string directory = dir && *dir ? dir : "snapshots";
+        return directory + "/" + std::to_string(bot_id) + ".snap";
+    }
+
+    bool save(const std::string &path, const command_table &table)
+    {
+        std::vector<std::pair<const command_entry *, std::vector<uint8_t>>> commands;
+        commands.reserve(table.size());
+        table.for_each([&commands](const command_entry &entry)
+                       { commands.emplace_back(&entry, nlohmann::json::to_cbor(entry.source)); });
+        std::sort(commands.begin(), commands.end(), [](const auto &a, const auto &b)
+                  { return a.first->name < b.first->name; });
+
+        std::string data;
+        std::vector<index_entry> index(commands.size());
+        for (size_t i = 0; i < commands.size(); ++i)
+        {
+            index[i].name_offset = static_cast<uint32_t>(data.size());
+            index[i].name_length = static_cast<uint32_t>(commands[i].first->name.size());
+            data += commands[i].first->name;
+        }
+        for (size_t i = 0; i < commands.size(); ++i)
+        {
+            const auto &config = commands[i].second;
+            index[i].config_offset = static_cast<uint32_t>(data.size());
+            index[i].config_length = static_cast<uint32_t>(config.size());
+            data.append(reinterpret_cast<const char *>(config.data()), config.size());
+        }
+        if (data.size() > UINT32_MAX)
+        {
+            log::error({}, "Config snapshot too large, not saved");
+            return false;
+        }
+
+        std::string body(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(index_entry));
+        body += data;
+        header head{};
+        std::memcpy(head.magic, magic, sizeof(magic));
+        head.version = format_version;
+        head.count = static_cast<uint32_t>(index.size());
+        head.data_size = data.size();
+        head.checksum = checksum(reinterpret_cast<const uint8_t *>(body.data()), body.size());
+
+        std::string contents(reinterpret_cast<const char *>(&head), sizeof(head));
+        contents += body;
+        return write_atomically(path, contents);
+    }
+
+    bool write_atomically(const std::string &path, std::string_view contents)
+    {
+        size_t slash = path.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, std::max<size_t>(slash, 1));
+        if (!make_directories(directory))
+        {
+            return false;
+        }
+        // Written next to the target and renamed over it, so readers only ever see whole files.
+        std::string temp = path + ".tmp";
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            log::error({}, "Cannot write " + temp + ": " + strerror(errno));
+            return false;
+        }
+        bool ok = write_all(fd, contents.data(), contents.size()) && fsync(fd) == 0;
+        int saved_errno = errno;
+        ::close(fd);
+        if (!ok || rename(temp.c_str(), path.c_str()) != 0)
+        {
+            log::error({}, "Cannot write " + path + ": " + strerror(ok ? errno : saved_errno));
+            unlink(temp.c_str());
+            return false;
+        }
+        // The rename itself is only durable once the directory entry is.
+        int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd >= 0)
+        {
+            fsync(dir_fd);
+            ::close(dir_fd);
+        }
+        return true;
+    }
+
+    writer &writer::instance()
+    {
+        static writer instance;
+        return instance;
+    }
+
+    writer::writer() : thread([this]
+                              { run(); })
+    {
+    }
+
+    writer::~writer()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    void writer::submit(std::string path, std::shared_ptr<const command_table> table)
+    {
+        {
+            std::lock_guard lock(mutex);
+            pending.insert_or_assign(std::move(path), std::move(table));
+        }
+        changed.notify_all();
+    }
+
+    void writer::flush()
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [this]
+                     { return pending.empty() && !busy; });
+    }
+
+    void writer::run()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            changed.wait(lock, [this]
+                         { return stopping || !pending.empty(); });
+            if (pending.empty())
+            {
+                return;
+            }
+            // Taken whole: what is submitted while these are written waits for the next round.
+            auto batch = std::move(pending);
+            pending.clear();
+            busy = true;
+            lock.unlock();
+            for (const auto &[path, table] : batch)
+            {
+                save(path, *table);
+            }
+            batch.clear();
+            lock.lock();
+            busy = false;
+            changed.notify_all();
+        }
+    }
+
+    std::shared_ptr<const command_table> load(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat st;
+        mapping map;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(header))
+        {
+            map.size = static_cast<size_t>(st.st_size);
+            map.address = mmap(nullptr, map.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (map.address == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        const auto *bytes = static_cast<const uint8_t *>(map.address);
+        header head;
+        std::memcpy(&head, bytes, sizeof(head));
+        size_t index_size = static_cast<size_t>(head.count) * sizeof(index_entry);
+        if (std::memcmp(head.magic, magic, sizeof(magic)) != 0 || head.version != format_version ||
+            map.size != sizeof(header) + index_size + head.data_size ||
+            checksum(bytes + sizeof(header), map.size - sizeof(header)) != head.checksum)
+        {
+            log::warning({}, "Ignoring unusable config snapshot " + path);
+            return nullptr;
+        }
+
+        const auto *index = reinterpret_cast<const index_entry *>(bytes + sizeof(header));
+        const uint8_t *data = bytes + sizeof(header) + index_size;
+        try
+        {
+            // Each decoded config is moved into its entry; no command map is built in between.
+            command_table::builder commands(head.count);
+            for (uint32_t i = 0; i < head.count; ++i)
+            {
+                const index_entry &entry = index[i];
+                if (uint64_t(entry.name_offset) + entry.name_length > head.data_size ||
+                    uint64_t(entry.config_offset) + entry.config_length > head.data_size)
+                {
+                    throw std::out_of_range("index entry outside the data section");
+                }
+                std::string name(reinterpret_cast<const char *>(data + entry.name_offset), entry.name_length);
+                commands.add(name, nlohmann::json::from_cbor(data + entry.config_offset, data + entry.config_offset + entry.config_length));
+            }
+            return commands.finish();
+        }
+        catch (const std::exception &e)
+        {
+            log::warning({}, "Ignoring unusable config snapshot " + path + ": " + e.what());
+            return nullptr;
+        }
+    }
+} // namespace app::config_snapshot
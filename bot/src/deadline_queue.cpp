@@ -0,0 +1,68 @@
+#include "../include/deadline_queue.hpp"
+
+namespace app
+{
+    deadline_queue &deadline_queue::instance()
+    {
+        // Never destroyed, like the log writer: callbacks may still be pending at exit.
+        static deadline_queue *queue = new deadline_queue(1);
+        return *queue;
+    }
+
+    deadline_queue::deadline_queue(size_t threads)
+    {
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+        {
+            workers.emplace_back([this]
+                                 { run(); });
+        }
+    }
+
+    deadline_queue::~deadline_queue()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void deadline_queue::schedule(clock::time_point when, std::function<void()> callback)
+    {
+        {
+            std::lock_guard lock(mutex);
+            entries.push({when, std::move(callback)});
+        }
+        wake.notify_one();
+    }
+
+    void deadline_queue::run()
+    {
+        std::unique_lock lock(mutex);
+        while (!stopping)
+        {
+            if (entries.empty())
+            {
+                wake.wait(lock);
+                continue;
+            }
+            auto when = entries.top().when;
+            if (clock::now() < when)
+            {
+                wake.wait_until(lock, when);
+                continue;
+            }
+            // top() is const; the entry is popped right after, so moving the callback out is safe.
+            std::function<void()> callback = std::move(const_cast<entry &>(entries.top()).callback);
+            entries.pop();
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+    }
+} // namespace app
@@ -1,39 +1,99 @@
 #include <dpp/dpp.h>
+#include "../include/handle_actions.hpp"
 #include "../include/actions/delete.hpp"
-dpp::task<bool> handle_actions(const dpp::slashcommand_t &event, const nlohmann::json &actions, const std::unordered_map<std::string, std::string> &key_values)
+#include "../include/log.hpp"
+#include <algorithm>
+#include <exception>
+
+namespace
 {
+    dpp::task<bool> run_action(const dpp::slashcommand_t &event, const app::action_node &action, const app::key_values &key_values, app::action_outputs &outputs, dpp::user &user_ptr, dpp::cluster *cluster, app::interaction_reply &reply, app::rest_api &rest)
+    {
+        if (action.type == "delete_messages" && event.command.is_guild_interaction())
+        {
+            auto start = app::metrics::clock::now();
+            bool result = co_await delete_action(event, action, key_values, user_ptr, cluster, outputs, reply, rest);
+            app::metrics::action_duration(cluster->me.id, action.type).observe_since(start);
+            co_return result;
+        }
+        // Unknown action types are ignored, as before.
+        co_return true;
+    }
+}
 
+dpp::task<bool> handle_actions(const dpp::slashcommand_t &event, const app::action_graph &actions, app::key_values &key_values, app::interaction_reply &reply, app::rest_api &rest)
+{
     dpp::cluster *cluster = event.owner;
     dpp::user user_ptr = event.command.get_issuing_user();
-    dpp::async thinking = event.co_thinking(false);
-    if (actions.is_array())
+    // No deferral up front: reply defers on its own if the actions run close to Discord's deadline.
+
+    const auto &nodes = actions.nodes();
+    std::vector<app::action_outputs> outputs(nodes.size());
+    std::vector<char> succeeded(nodes.size(), 0);
+    bool all_succeeded = true;
+
+    for (const auto &level : actions.levels())
     {
-        int i = 0;
-        for (const auto &action : actions)
+        // dpp::task starts eagerly, so every action of the level is in flight before the first co_await.
+        std::vector<std::pair<size_t, dpp::task<bool>>> running;
+        running.reserve(level.size());
+        for (size_t index : level)
         {
-            i++;
-            if (action.contains("type"))
+            const auto &action = nodes[index];
+            bool ready = true;
+            for (size_t dependency : action.after)
             {
-                std::string action_type = action["type"];
-                if (action_type == "delete_messages" && event.command.is_guild_interaction())
-                {
-                   auto return_value = co_await delete_action(event, action, key_values, user_ptr, cluster);
-                   co_await thinking;
-                   // if it's a false, we need to return false !
-                     if (!return_value)
-                     {
-                          co_return false;
-                     }
-
+                ready = ready && succeeded[dependency];
+            }
+            if (!ready)
+            {
+                // A dependency failed or was skipped: its error has already been reported.
+                continue;
+            }
+            running.emplace_back(index, run_action(event, action, key_values, outputs[index], user_ptr, cluster, reply, rest));
+        }
 
-                }
+        // Every sibling is awaited even when one throws: they reference this frame until they finish.
+        std::exception_ptr failure;
+        for (auto &[index, task] : running)
+        {
+            try
+            {
+                succeeded[index] = co_await task;
+                all_succeeded = all_succeeded && succeeded[index];
             }
-            if (i == actions.size())
+            catch (...)
             {
+                if (!failure)
+                {
+                    failure = std::current_exception();
+                }
+            }
+        }
+        if (failure)
+        {
+            std::rethrow_exception(failure);
+        }
 
-                co_await thinking;
-                co_return true;
+        // Published once the whole level is done, since its actions read the map concurrently. From here on
+        // every later action, its dependents' dependents included, and the final response see them.
+        for (auto &[index, task] : running)
+        {
+            const auto &declared = nodes[index].output_keys;
+            for (const auto &[key, value] : outputs[index])
+            {
+                auto it = std::find_if(declared.begin(), declared.end(), [&key](const auto &output)
+                                       { return output.first == key; });
+                if (it == declared.end())
+                {
+                    app::log::warning({cluster->me.id, event.command.guild_id, event.command.get_command_name()}, "Action " + nodes[index].id + " set the undeclared output " + key + ", dropped");
+                    continue;
+                }
+                key_values.set(it->second, value);
             }
         }
     }
+
+    // false means an action already answered the interaction with an error.
+    co_return all_succeeded;
 }
@@ -0,0 +1,224 @@
+#include "../include/http_request_parser.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    bool iequals(std::string_view a, std::string_view b) {
+        auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [&lower](char x, char y) {
+            return lower(x) == lower(y);
+        });
+    }
+
+    std::string_view trimOws(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+        return s;
+    }
+
+    // Parses an unsigned integer in the given base, rejecting empty input and overflow.
+    bool parseSize(std::string_view s, int base, size_t& out) {
+        if (s.empty()) return false;
+        size_t value = 0;
+        for (char c : s) {
+            int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (base == 16 && c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (base == 16 && c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return false;
+            if (value > (SIZE_MAX - digit) / base) return false;
+            value = value * base + digit;
+        }
+        out = value;
+        return true;
+    }
+
+    constexpr size_t max_chunk_line = 1024;
+    // Framing a chunked body may add on top of max_body_size: chunk size lines, extensions and CRLFs.
+    constexpr size_t max_chunk_overhead = 64 * 1024;
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (const auto& [key, value] : headers) {
+        if (iequals(key, name)) return value;
+    }
+    return {};
+}
+
+bool HttpRequest::headerHasToken(std::string_view name, std::string_view token) const {
+    for (const auto& [key, value] : headers) {
+        if (!iequals(key, name)) continue;
+        size_t start = 0;
+        while (start <= value.size()) {
+            size_t comma = value.find(',', start);
+            if (comma == std::string_view::npos) comma = value.size();
+            if (iequals(trimOws(value.substr(start, comma - start)), token)) return true;
+            start = comma + 1;
+        }
+    }
+    return false;
+}
+
+void HttpRequestParser::reset() {
+    state = State::Headers;
+    scan_pos = body_start = body_length = 0;
+    content_length = chunk_remaining = trailer_start = consumed_bytes = 0;
+    error_status = 0;
+    expect_continue = false;
+    header_spans.clear();
+    req = HttpRequest{};
+}
+
+HttpRequestParser::Status HttpRequestParser::fail(int status) {
+    state = State::Failed;
+    error_status = status;
+    return Status::Error;
+}
+
+bool HttpRequestParser::parseHead(std::string_view head) {
+    size_t line_end = head.find("\r\n");
+    std::string_view line = head.substr(0, line_end);
+
+    size_t sp1 = line.find(' ');
+    size_t sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+    if (sp1 == 0 || sp2 == std::string_view::npos || sp2 == sp1 + 1) return false;
+    method = {0, sp1};
+    path = {sp1 + 1, sp2 - sp1 - 1};
+    version = {sp2 + 1, line.size() - sp2 - 1};
+    if (line.substr(version.offset, 7) != "HTTP/1.") return false;
+
+    size_t pos = line_end == std::string_view::npos ? head.size() : line_end + 2;
+    while (pos < head.size()) {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string_view::npos) end = head.size();
+        std::string_view header_line = head.substr(pos, end - pos);
+        size_t colon = header_line.find(':');
+        // Field names are tokens: no whitespace, not even before the colon (RFC 9112 §5.1).
+        if (colon == 0 || colon == std::string_view::npos ||
+            header_line.substr(0, colon).find_first_of(" \t") != std::string_view::npos) {
+            return false;
+        }
+        std::string_view value = trimOws(header_line.substr(colon + 1));
+        size_t value_offset = value.empty() ? pos + colon + 1 : static_cast<size_t>(value.data() - head.data());
+        header_spans.push_back({{pos, colon}, {value_offset, value.size()}});
+        pos = end + 2;
+    }
+    return true;
+}
+
+void HttpRequestParser::materialize(std::string_view data) {
+    auto view = [&data](const Span& span) { return data.substr(span.offset, span.length); };
+
+    req.method = view(method);
+    req.path = view(path);
+    req.version = view(version);
+    req.headers.clear();
+    req.headers.reserve(header_spans.size());
+    for (const auto& [key, value] : header_spans) {
+        req.headers.emplace_back(view(key), view(value));
+    }
+    req.body = data.substr(body_start, body_length);
+}
+
+HttpRequestParser::Status HttpRequestParser::parse(char* data, size_t size) {
+    std::string_view buffer(data, size);
+    while (true) {
+        switch (state) {
+        case State::Headers: {
+            size_t from = scan_pos >= 3 ? scan_pos - 3 : 0;
+            size_t header_end = buffer.find("\r\n\r\n", from);
+            if (header_end == std::string_view::npos) {
+                if (buffer.size() > max_header_size) return fail(431);
+                scan_pos = buffer.size();
+                return Status::Incomplete;
+            }
+            if (header_end > max_header_size) return fail(431);
+            if (!parseHead(buffer.substr(0, header_end))) return fail(400);
+
+            body_start = scan_pos = header_end + 4;
+            materialize(buffer);
+
+            std::string_view transfer_encoding = req.header("Transfer-Encoding");
+            std::string_view length_header = req.header("Content-Length");
+            expect_continue = iequals(req.header("Expect"), "100-continue");
+
+            if (!transfer_encoding.empty()) {
+                // Transfer-Encoding wins over Content-Length; only plain chunked is supported.
+                if (!iequals(transfer_encoding, "chunked")) return fail(501);
+                state = State::ChunkSize;
+            } else if (!length_header.empty()) {
+                if (!parseSize(length_header, 10, content_length)) return fail(400);
+                if (content_length > max_body_size) return fail(413);
+                state = State::Body;
+            } else {
+                content_length = 0;
+                state = State::Body;
+            }
+            break;
+        }
+        case State::Body: {
+            if (buffer.size() - body_start < content_length) return Status::Incomplete;
+            body_length = content_length;
+            consumed_bytes = body_start + content_length;
+            state = State::Done;
+            break;
+        }
+        case State::ChunkSize: {
+            size_t line_end = buffer.find("\r\n", scan_pos);
+            if (line_end == std::string_view::npos) {
+                if (buffer.size() - scan_pos > max_chunk_line) return fail(400);
+                return Status::Incomplete;
+            }
+            std::string_view line = buffer.substr(scan_pos, line_end - scan_pos);
+            line = trimOws(line.substr(0, line.find(';')));  // Ignore chunk extensions
+            size_t chunk_size = 0;
+            if (!parseSize(line, 16, chunk_size)) return fail(400);
+            scan_pos = line_end + 2;
+            // Each line is bounded, but not how many there are: tiny chunks with long extensions add up.
+            if (scan_pos - body_start > max_body_size + max_chunk_overhead) return fail(413);
+            if (chunk_size == 0) {
+                trailer_start = scan_pos;
+                state = State::ChunkTrailer;
+            } else {
+                if (chunk_size > max_body_size - body_length) return fail(413);
+                chunk_remaining = chunk_size;
+                state = State::ChunkData;
+            }
+            break;
+        }
+        case State::ChunkData: {
+            if (buffer.size() - scan_pos < chunk_remaining + 2) return Status::Incomplete;
+            if (buffer.substr(scan_pos + chunk_remaining, 2) != "\r\n") return fail(400);
+            // The decoded body always trails the raw chunk stream, so compact it in place.
+            std::memmove(data + body_start + body_length, data + scan_pos, chunk_remaining);
+            body_length += chunk_remaining;
+            scan_pos += chunk_remaining + 2;
+            chunk_remaining = 0;
+            state = State::ChunkSize;
+            break;
+        }
+        case State::ChunkTrailer: {
+            // Trailer fields count against the header limit as a whole, like the header block.
+            size_t line_end = buffer.find("\r\n", scan_pos);
+            if (line_end == std::string_view::npos) {
+                if (buffer.size() - trailer_start > max_header_size) return fail(431);
+                return Status::Incomplete;
+            }
+            if (line_end - trailer_start > max_header_size) return fail(431);
+            bool last = line_end == scan_pos;
+            scan_pos = line_end + 2;
+            if (last) {
+                consumed_bytes = scan_pos;
+                state = State::Done;
+            }
+            break;
+        }
+        case State::Done:
+            materialize(buffer);
+            return Status::Complete;
+        case State::Failed:
+            return Status::Error;
+        }
+    }
+}
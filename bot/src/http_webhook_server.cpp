@@ -3,173 +3,511 @@
 #include <unistd.h>
 #include <cstring>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+// A small fixed-size pool that runs request handlers away from the epoll loops.
+class HttpWebhookServer::HandlerPool {
+public:
+    explicit HandlerPool(size_t thread_count) {
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+
+    ~HandlerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                // Queued requests still run when stopping: each one is a client waiting for an answer.
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
 
 HttpWebhookServer::HttpWebhookServer(uint16_t port, Handler handler)
-    : port(port), request_handler(handler) {
-    setupSocket();
-    setupEpoll();
+    : HttpWebhookServer(port, std::move(handler), Options{}) {}
+
+HttpWebhookServer::HttpWebhookServer(uint16_t port, Handler handler, Options options)
+    : port(port), request_handler(handler), options(options) {
+    size_t worker_count = std::max<size_t>(options.workers, 1);
+    for (size_t i = 0; i < worker_count; ++i) {
+        loops.push_back(std::make_unique<Loop>());
+        setupSocket(*loops.back());
+        setupEpoll(*loops.back());
+    }
+    if (options.handler_threads > 0) {
+        handler_pool = std::make_unique<HandlerPool>(options.handler_threads);
+    }
 }
 
 HttpWebhookServer::~HttpWebhookServer() {
     stop();
-    if (server_fd != -1) ::close(server_fd);
-    if (epoll_fd != -1) ::close(epoll_fd);
+    for (auto& loop : loops) {
+        if (loop->thread.joinable()) loop->thread.join();
+    }
+    // Running and queued handlers still post to the loops' wake fds, so finish them before closing anything.
+    handler_pool.reset();
+    for (auto& loop : loops) {
+        // The loops are gone: send what the handlers answered, best effort, before the sockets close.
+        for (auto& done : loop->completed) {
+            auto it = loop->clients.find(done.fd);
+            if (it == loop->clients.end() || it->second.id != done.id) continue;
+            it->second.in_handler = false;
+            finishRequest(it->second, done.response, false);
+            flushClient(done.fd, it->second);
+        }
+        for (auto& [fd, ctx] : loop->clients) ::close(fd);
+        if (loop->server_fd != -1) ::close(loop->server_fd);
+        if (loop->epoll_fd != -1) ::close(loop->epoll_fd);
+        if (loop->wake_fd != -1) ::close(loop->wake_fd);
+    }
 }
 
-void HttpWebhookServer::setupSocket() {
-    server_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
-    if (server_fd == -1) throw std::system_error(errno, std::generic_category());
+void HttpWebhookServer::setupSocket(Loop& loop) {
+    loop.server_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (loop.server_fd == -1) throw std::system_error(errno, std::generic_category());
 
     int opt = 1;
-    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(loop.server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    // Every loop binds its own listener and the kernel spreads new connections across them.
+    if (options.workers > 1 && setsockopt(loop.server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)
+        throw std::system_error(errno, std::generic_category());
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
     addr.sin_port = htons(port);
 
-    if (::bind(server_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1)
+    if (::bind(loop.server_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1)
         throw std::system_error(errno, std::generic_category());
 
-    if (::listen(server_fd, 128) == -1)
+    if (::listen(loop.server_fd, 128) == -1)
         throw std::system_error(errno, std::generic_category());
 }
 
-void HttpWebhookServer::setupEpoll() {
-    epoll_fd = ::epoll_create1(0);
-    if (epoll_fd == -1)
+void HttpWebhookServer::setupEpoll(Loop& loop) {
+    loop.epoll_fd = ::epoll_create1(0);
+    if (loop.epoll_fd == -1)
         throw std::system_error(errno, std::generic_category());
 
-    epoll_event event{};
-    event.events = EPOLLIN | EPOLLET;
-    event.data.fd = server_fd;
-
-    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &event) == -1)
+    loop.wake_fd = ::eventfd(0, EFD_NONBLOCK);
+    if (loop.wake_fd == -1)
         throw std::system_error(errno, std::generic_category());
+
+    for (int fd : {loop.server_fd, loop.wake_fd}) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = fd;
+
+        if (::epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+            throw std::system_error(errno, std::generic_category());
+    }
 }
 
 void HttpWebhookServer::start() {
     running = true;
+    for (size_t i = 1; i < loops.size(); ++i) {
+        Loop& loop = *loops[i];
+        loop.thread = std::thread([this, &loop] {
+            try {
+                run(loop);
+            } catch (...) {
+                // One broken loop takes the whole server down rather than silently shrinking it.
+                stop();
+            }
+        });
+    }
+
+    try {
+        run(*loops.front());
+    } catch (...) {
+        stop();
+        for (size_t i = 1; i < loops.size(); ++i) {
+            if (loops[i]->thread.joinable()) loops[i]->thread.join();
+        }
+        throw;
+    }
+    for (size_t i = 1; i < loops.size(); ++i) {
+        if (loops[i]->thread.joinable()) loops[i]->thread.join();
+    }
+}
+
+void HttpWebhookServer::run(Loop& loop) {
     epoll_event events[64];
+    auto last_sweep = std::chrono::steady_clock::now();
 
     while (running) {
-        int nfds = ::epoll_wait(epoll_fd, events, 64, -1);
+        // Only wake up periodically while there are connections that may go idle.
+        int timeout = loop.clients.empty() ? -1 : 1000;
+        int nfds = ::epoll_wait(loop.epoll_fd, events, 64, timeout);
         if (nfds == -1 && errno != EINTR)
             throw std::system_error(errno, std::generic_category());
 
         for (int i = 0; i < nfds; ++i) {
-            if (events[i].data.fd == server_fd) {
-                while (true) {
-                    sockaddr_in client_addr{};
-                    socklen_t client_len = sizeof(client_addr);
-                    int client_fd = ::accept4(server_fd, (sockaddr*)&client_addr, &client_len, SOCK_NONBLOCK);
-                    if (client_fd == -1) break;
-
-                    epoll_event event{};
-                    event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
-                    event.data.fd = client_fd;
-                    ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event);
-                    clients[client_fd] = ClientContext{};
-                }
-            } else {
-                handleClient(events[i].data.fd);
-            }
+            handleEvent(loop, &events[i]);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_sweep >= std::chrono::seconds(1)) {
+            closeIdleClients(loop);
+            last_sweep = now;
         }
     }
 }
 
 void HttpWebhookServer::stop() {
     running = false;
+    for (auto& loop : loops) {
+        uint64_t one = 1;
+        if (loop->wake_fd != -1) (void)::write(loop->wake_fd, &one, sizeof(one));
+    }
 }
 
-void HttpWebhookServer::closeClient(int fd) {
-    ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
-    ::close(fd);
-    clients.erase(fd);
+void HttpWebhookServer::handleEvent(Loop& loop, epoll_event* event) {
+    if (event->data.fd == loop.wake_fd) {
+        uint64_t count;
+        while (::read(loop.wake_fd, &count, sizeof(count)) > 0) {}
+        drainCompleted(loop);
+        return;
+    }
+    if (event->data.fd != loop.server_fd) {
+        handleClient(loop, event->data.fd, event->events);
+        return;
+    }
+
+    while (true) {
+        sockaddr_in client_addr{};
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = ::accept4(loop.server_fd, (sockaddr*)&client_addr, &client_len, SOCK_NONBLOCK);
+        if (client_fd == -1) break;
+
+        // Edge-triggered for both directions: EPOLLOUT fires again whenever the socket drains.
+        epoll_event client_event{};
+        client_event.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+        client_event.data.fd = client_fd;
+        ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, client_fd, &client_event);
+        ClientContext& ctx = loop.clients[client_fd] = ClientContext{};
+        ctx.id = ++loop.next_id;
+    }
 }
 
-void HttpWebhookServer::handleClient(int fd) {
-    char buffer[4096];
-    ssize_t count = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+void HttpWebhookServer::closeIdleClients(Loop& loop) {
+    auto deadline = std::chrono::steady_clock::now() - options.idle_timeout;
+    for (auto it = loop.clients.begin(); it != loop.clients.end();) {
+        int fd = it->first;
+        bool idle = !it->second.in_handler && it->second.last_activity < deadline;
+        ++it;
+        if (idle) closeClient(loop, fd);
+    }
+}
 
-    if (count > 0) {
-        auto& ctx = clients[fd];
-        ctx.input_buffer.append(buffer, count);
+void HttpWebhookServer::closeClient(Loop& loop, int fd) {
+    auto it = loop.clients.find(fd);
+    if (it != loop.clients.end() && it->second.in_handler) {
+        // A handler still reads this connection's buffer: stop watching it now and let
+        // drainCompleted close it. Keeping the fd open also keeps its number from being reused.
+        ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        it->second.close_after_flush = true;
+        return;
+    }
+    ::epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    loop.clients.erase(fd);
+}
 
-        if (ctx.input_buffer.find("\r\n\r\n") != std::string::npos) {
-            HttpRequest req;
-            parseHttpRequest(ctx, req);
+void HttpWebhookServer::handleClient(Loop& loop, int fd, uint32_t events) {
+    auto it = loop.clients.find(fd);
+    if (it == loop.clients.end()) return;
+    auto& ctx = it->second;
 
-            HttpResponse res = request_handler(req);
-            buildHttpResponse(res, ctx.output_buffer);
+    if (events & EPOLLERR) {
+        closeClient(loop, fd);
+        return;
+    }
 
-            epoll_event event{};
-            event.events = EPOLLOUT | EPOLLET | EPOLLRDHUP;
-            event.data.fd = fd;
-            ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    // While a handler owns the buffer, unread bytes wait in the kernel; drainCompleted reads them.
+    if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !ctx.in_handler) {
+        ctx.last_activity = std::chrono::steady_clock::now();
+        if (!serveInput(loop, fd, ctx)) {
+            closeClient(loop, fd);
+            return;
         }
     }
-    else if (count == 0 || (count == -1 && errno != EAGAIN)) {
-        closeClient(fd);
+
+    afterIo(loop, fd, ctx);
+}
+
+bool HttpWebhookServer::serveInput(Loop& loop, int fd, ClientContext& ctx) {
+    if (!readFromClient(fd, ctx)) return false;
+    processInput(loop, fd, ctx);
+    // Reading stopped at a request boundary. Edge-triggered epoll will not report the bytes
+    // left in the kernel again, so read on once the buffered requests have been answered.
+    while (ctx.read_paused && !ctx.in_handler && !ctx.close_after_flush) {
+        if (!readFromClient(fd, ctx)) return false;
+        processInput(loop, fd, ctx);
+    }
+    return true;
+}
+
+void HttpWebhookServer::afterIo(Loop& loop, int fd, ClientContext& ctx) {
+    if (!flushClient(fd, ctx)) {
+        closeClient(loop, fd);
         return;
     }
 
-    if (!clients.count(fd)) return; // Client déjà fermé plus haut
+    if (ctx.bytes_written == ctx.output_buffer.size()) {
+        ctx.output_buffer.clear();
+        ctx.bytes_written = 0;
+        // Everything owed is on the wire; a half-closed peer will not send another request.
+        if ((ctx.close_after_flush || ctx.peer_closed) && !ctx.in_handler) closeClient(loop, fd);
+    }
+}
 
-    auto& ctx = clients[fd];
-    if (!ctx.output_buffer.empty()) {
-        ssize_t sent = ::send(fd,
-                              ctx.output_buffer.data() + ctx.bytes_written,
-                              ctx.output_buffer.size() - ctx.bytes_written,
-                              MSG_DONTWAIT);
+bool HttpWebhookServer::readFromClient(int fd, ClientContext& ctx) {
+    constexpr size_t min_free = 16 * 1024;
+
+    ctx.read_paused = false;
+    // A rejected request is answered and the connection closed; nothing more is read.
+    if (ctx.close_after_flush) return true;
+
+    // Edge-triggered: drain the socket straight into the connection buffer until EAGAIN, but
+    // never past the request being read. The parser sees every chunk as it arrives, so a
+    // request over the header or body limit is rejected as soon as it crosses it, and bytes
+    // behind a complete or rejected request stay in the kernel until it has been answered.
+    while (!ctx.peer_closed) {
+        if (ctx.input_size > 0 &&
+            ctx.parser.parse(ctx.input_buffer.data(), ctx.input_size) != HttpRequestParser::Status::Incomplete) {
+            ctx.read_paused = true;
+            return true;
+        }
+        if (ctx.input_buffer.size() - ctx.input_size < min_free) {
+            // Grow to the announced request size in one step when known, geometrically otherwise;
+            // the parser's limits bound both.
+            size_t expected = ctx.parser.expectedSize();
+            size_t target = expected > ctx.input_size ? std::max(expected, ctx.input_size + min_free)
+                                                      : std::max(ctx.input_size * 2, ctx.input_size + min_free * 4);
+            ctx.input_buffer.resize(target);
+        }
+
+        ssize_t count = ::recv(fd, ctx.input_buffer.data() + ctx.input_size,
+                               ctx.input_buffer.size() - ctx.input_size, MSG_DONTWAIT);
+        if (count > 0) {
+            ctx.input_size += count;
+        } else if (count == 0) {
+            ctx.peer_closed = true;
+        } else if (errno != EINTR) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    return true;
+}
+
+void HttpWebhookServer::processInput(Loop& loop, int fd, ClientContext& ctx) {
+    // Answer every complete request in the buffer, in order, so pipelined requests are
+    // written back in the sequence they arrived. With a handler pool, the next request is
+    // only parsed once the previous one has been answered.
+    while (!ctx.close_after_flush && !ctx.in_handler) {
+        HttpResponse res;
+
+        switch (ctx.parser.parse(ctx.input_buffer.data(), ctx.input_size)) {
+        case HttpRequestParser::Status::Incomplete:
+            if (ctx.parser.expectsContinue() && !ctx.continue_sent) {
+                ctx.output_buffer += "HTTP/1.1 100 Continue\r\n\r\n";
+                ctx.continue_sent = true;
+            }
+            return;
+        case HttpRequestParser::Status::Error:
+            res.status_code = ctx.parser.errorStatus();
+            res.headers["Content-Type"] = "text/plain";
+            res.body = "Malformed request.";
+            finishRequest(ctx, res, false);
+            return;
+        case HttpRequestParser::Status::Complete: {
+            const HttpRequest& req = ctx.parser.request();
+            // HTTP/1.1 is persistent unless told otherwise, HTTP/1.0 only when asked. `Connection`
+            // is a case-insensitive token list (RFC 9110 §7.6.1), e.g. `keep-alive, Upgrade`.
+            bool keep_alive = req.version == "HTTP/1.1" ? !req.headerHasToken("Connection", "close")
+                                                        : req.headerHasToken("Connection", "keep-alive");
+            keep_alive = keep_alive && ++ctx.requests_served < options.max_requests_per_connection;
+
+            if (handler_pool) {
+                // The request views stay valid: the loop does not touch this buffer until the
+                // completion comes back.
+                ctx.in_handler = true;
+                handler_pool->submit([this, &loop, fd, id = ctx.id, keep_alive, &req] {
+                    Completion done{fd, id, keep_alive, {}};
+                    try {
+                        done.response = request_handler(req);
+                    } catch (const std::exception& e) {
+                        done.response.status_code = 500;
+                        done.response.headers["Content-Type"] = "text/plain";
+                        done.response.body = e.what();
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(loop.completed_mutex);
+                        loop.completed.push_back(std::move(done));
+                    }
+                    uint64_t one = 1;
+                    (void)::write(loop.wake_fd, &one, sizeof(one));
+                });
+                return;
+            }
 
-        if (sent > 0) ctx.bytes_written += sent;
-        if (ctx.bytes_written == ctx.output_buffer.size()) {
-            closeClient(fd);
+            res = request_handler(req);
+            finishRequest(ctx, res, keep_alive);
+            break;
+        }
         }
     }
 }
 
-void HttpWebhookServer::parseHttpRequest(ClientContext& ctx, HttpRequest& req) {
-    std::istringstream stream(ctx.input_buffer);
-    std::string line;
+void HttpWebhookServer::finishRequest(ClientContext& ctx, HttpResponse& res, bool keep_alive) {
+    res.headers["Connection"] = keep_alive ? "keep-alive" : "close";
+    if (keep_alive) {
+        res.headers["Keep-Alive"] = "timeout=" + std::to_string(options.idle_timeout.count() / 1000);
+    }
+    buildHttpResponse(res, ctx.output_buffer);
+    if (!keep_alive) {
+        ctx.close_after_flush = true;
+        return;
+    }
+
+    // Drop the answered request and keep whatever was pipelined behind it.
+    size_t consumed = ctx.parser.consumed();
+    std::memmove(ctx.input_buffer.data(), ctx.input_buffer.data() + consumed, ctx.input_size - consumed);
+    ctx.input_size -= consumed;
+    ctx.parser.reset();
+    ctx.continue_sent = false;
+
+    // Don't let an idle connection keep the buffer of a multi-MB config alive.
+    constexpr size_t idle_buffer = 64 * 1024;
+    if (ctx.input_buffer.size() > 16 * idle_buffer && ctx.input_size <= idle_buffer) {
+        ctx.input_buffer.resize(idle_buffer);
+        ctx.input_buffer.shrink_to_fit();
+    }
+}
+
+void HttpWebhookServer::drainCompleted(Loop& loop) {
+    std::vector<Completion> completed;
+    {
+        std::lock_guard<std::mutex> lock(loop.completed_mutex);
+        completed.swap(loop.completed);
+    }
 
-    std::getline(stream, line);
-    std::istringstream req_line(line);
-    req_line >> req.method >> req.path;
+    for (auto& done : completed) {
+        auto it = loop.clients.find(done.fd);
+        if (it == loop.clients.end() || it->second.id != done.id) continue;
+        auto& ctx = it->second;
+        ctx.in_handler = false;
+        ctx.last_activity = std::chrono::steady_clock::now();
+
+        // closeClient was called while the handler ran.
+        if (ctx.close_after_flush) {
+            closeClient(loop, done.fd);
+            continue;
+        }
 
-    while (std::getline(stream, line) && line != "\r") {
-        size_t colon = line.find(':');
-        if (colon != std::string::npos) {
-            std::string key = line.substr(0, colon);
-            std::string value = line.substr(colon + 1);
-            key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
-            value.erase(0, value.find_first_not_of(" \t\r\n"));
-            value.erase(value.find_last_not_of(" \t\r\n") + 1);
-            req.headers[key] = value;
+        finishRequest(ctx, done.response, done.keep_alive);
+        // Pick up whatever arrived while the handler ran, including pipelined requests.
+        if (!serveInput(loop, done.fd, ctx)) {
+            closeClient(loop, done.fd);
+            continue;
         }
+        afterIo(loop, done.fd, ctx);
     }
+}
+
+bool HttpWebhookServer::flushClient(int fd, ClientContext& ctx) {
+    while (ctx.bytes_written < ctx.output_buffer.size()) {
+        ssize_t sent = ::send(fd,
+                              ctx.output_buffer.data() + ctx.bytes_written,
+                              ctx.output_buffer.size() - ctx.bytes_written,
+                              MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent > 0) {
+            ctx.bytes_written += sent;
+        } else if (sent == -1 && errno == EINTR) {
+            continue;
+        } else {
+            return sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+    return true;
+}
 
-    size_t header_end = ctx.input_buffer.find("\r\n\r\n");
-    if (header_end != std::string::npos) {
-        req.body = ctx.input_buffer.substr(header_end + 4);
-        if (req.headers.count("Content-Length")) {
-            size_t content_length = std::stoul(req.headers["Content-Length"]);
-            req.body = req.body.substr(0, content_length);
+namespace {
+    const char* statusReason(int status_code) {
+        switch (status_code) {
+        case 100: return "Continue";
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Content Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "OK";
         }
     }
 }
 
 void HttpWebhookServer::buildHttpResponse(const HttpResponse& res, std::string& output) {
-    output = "HTTP/1.1 " + std::to_string(res.status_code) + " OK\r\n";
+    output.reserve(output.size() + 160 + res.body.size());
+    output += "HTTP/1.1 ";
+    output += std::to_string(res.status_code);
+    output += ' ';
+    output += statusReason(res.status_code);
+    output += "\r\n";
 
     for (const auto& [key, value] : res.headers) {
-        output += key + ": " + value + "\r\n";
+        output += key;
+        output += ": ";
+        output += value;
+        output += "\r\n";
     }
 
     if (!res.headers.count("Content-Length")) {
-        output += "Content-Length: " + std::to_string(res.body.size()) + "\r\n";
+        output += "Content-Length: ";
+        output += std::to_string(res.body.size());
+        output += "\r\n";
     }
 
-    output += "\r\n" + res.body;
+    output += "\r\n";
+    output += res.body;
 }
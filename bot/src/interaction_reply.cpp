@@ -0,0 +1,150 @@
+#include "../include/interaction_reply.hpp"
+#include "../include/deadline_queue.hpp"
+#include "../include/log.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace app
+{
+    namespace
+    {
+        using steady_clock = deadline_queue::clock;
+
+        // Discord closes the acknowledgement window 3 seconds after sending the interaction; the
+        // deferral itself needs a round trip, so it is sent with a second to spare.
+        constexpr std::chrono::milliseconds defer_after{2000};
+    }
+
+    interaction_reply::interaction_reply(std::shared_ptr<rest_api> rest, uint64_t bot, dpp::snowflake id, const std::string &token, const metrics::interaction_timer &timer, std::shared_ptr<void> until_sent)
+        : rest(std::move(rest)), bot(bot), id(id), token(token), timer(timer), until_sent(std::move(until_sent))
+    {
+    }
+
+    std::shared_ptr<interaction_reply> interaction_reply::start(const dpp::slashcommand_t &event, const metrics::interaction_timer &timer, std::shared_ptr<rest_api> rest, std::shared_ptr<void> until_sent)
+    {
+        auto reply = std::make_shared<interaction_reply>(std::move(rest), event.owner ? uint64_t(event.owner->me.id) : 0, event.command.id, event.command.token, timer, std::move(until_sent));
+        // The window starts when Discord created the interaction, which may be well before it reached us;
+        // the local receipt time bounds it in case the host clock runs behind.
+        auto created = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(event.command.id.get_creation_time())));
+        auto remaining = std::min<steady_clock::duration>(created + defer_after - std::chrono::system_clock::now(), defer_after - (metrics::clock::now() - timer.start));
+        std::weak_ptr<interaction_reply> weak = reply;
+        deadline_queue::instance().schedule(steady_clock::now() + std::max<steady_clock::duration>(remaining, steady_clock::duration::zero()), [weak]
+                                            {
+                                                if (auto self = weak.lock())
+                                                {
+                                                    self->defer();
+                                                } });
+        return reply;
+    }
+
+    void interaction_reply::update(const std::string &content)
+    {
+        send(content, false);
+    }
+
+    void interaction_reply::finish(const std::string &content)
+    {
+        send(content, true);
+    }
+
+    void interaction_reply::send(const std::string &content, bool final)
+    {
+        std::unique_lock lock(mutex);
+        if (finished)
+        {
+            return;
+        }
+        finished = final;
+        switch (current)
+        {
+        case state::pending:
+        {
+            // Nothing sent yet and the deadline hasn't passed: the message is the acknowledgement.
+            current = state::acknowledging;
+            lock.unlock();
+            rest->interaction_response_create(id, token, dpp::interaction_response(dpp::ir_channel_message_with_source, dpp::message(content)),
+                                                 [self = shared_from_this(), final](const dpp::confirmation_callback_t &result)
+                                                 {
+                                                     metrics::rest_call(self->bot, "interaction_reply", result.is_error());
+                                                     if (result.is_error())
+                                                     {
+                                                         log::warning({self->bot}, "Replying to an interaction failed: " + result.get_error().message);
+                                                     }
+                                                     self->timer.acked();
+                                                     if (final)
+                                                     {
+                                                         self->timer.responded();
+                                                     }
+                                                     self->acknowledged();
+                                                 });
+            break;
+        }
+        case state::acknowledging:
+            // An edit sent now could reach Discord before the acknowledgement; it goes out once that is confirmed.
+            queued = content;
+            queued_final = final;
+            break;
+        case state::acknowledged:
+            lock.unlock();
+            edit(content, final);
+            break;
+        }
+    }
+
+    void interaction_reply::defer()
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (current != state::pending)
+            {
+                return;
+            }
+            current = state::acknowledging;
+        }
+        rest->interaction_response_create(id, token, dpp::interaction_response(dpp::ir_deferred_channel_message_with_source),
+                                             [self = shared_from_this()](const dpp::confirmation_callback_t &result)
+                                             {
+                                                 metrics::rest_call(self->bot, "interaction_defer", result.is_error());
+                                                 if (result.is_error())
+                                                 {
+                                                     log::warning({self->bot}, "Deferring an interaction failed: " + result.get_error().message);
+                                                 }
+                                                 self->timer.acked();
+                                                 self->acknowledged();
+                                             });
+    }
+
+    void interaction_reply::acknowledged()
+    {
+        std::optional<std::string> content;
+        bool final = false;
+        {
+            std::lock_guard lock(mutex);
+            current = state::acknowledged;
+            content.swap(queued);
+            final = queued_final;
+        }
+        if (content)
+        {
+            edit(*content, final);
+        }
+    }
+
+    void interaction_reply::edit(const std::string &content, bool final)
+    {
+        // The final edit keeps the reply, and its until_sent handle, alive until Discord has it.
+        rest->interaction_response_edit(token, dpp::message(content), [self = final ? shared_from_this() : nullptr, bot = bot, timer = timer, final](const dpp::confirmation_callback_t &result)
+                                           {
+                                               metrics::rest_call(bot, "interaction_edit", result.is_error());
+                                               if (result.is_error())
+                                               {
+                                                   // The user keeps seeing the previous message, or "thinking" if it was deferred.
+                                                   log::warning({bot}, std::string(final ? "Sending the final response" : "Updating the response") + " failed: " + result.get_error().message);
+                                                   return;
+                                               }
+                                               if (final)
+                                               {
+                                                   timer.responded();
+                                               } });
+    }
+} // namespace app
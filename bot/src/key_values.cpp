@@ -0,0 +1,100 @@
+#include "../include/key_values.hpp"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace app
+{
+    namespace
+    {
+        struct key_registry
+        {
+            std::shared_mutex mutex;
+            // A deque so the views in `ids` stay valid as names are added.
+            std::deque<std::string> names;
+            std::unordered_map<std::string_view, key_id> ids;
+        };
+
+        key_registry &registry()
+        {
+            static key_registry r;
+            return r;
+        }
+    }
+
+    key_id intern_key(std::string_view key)
+    {
+        key_registry &r = registry();
+        {
+            std::shared_lock lock(r.mutex);
+            auto it = r.ids.find(key);
+            if (it != r.ids.end())
+            {
+                return it->second;
+            }
+        }
+        std::unique_lock lock(r.mutex);
+        auto it = r.ids.find(key);
+        if (it != r.ids.end())
+        {
+            return it->second;
+        }
+        if (r.names.size() >= max_keys)
+        {
+            throw std::length_error("Too many distinct placeholder keys, not interning " + std::string(key));
+        }
+        const std::string &name = r.names.emplace_back(key);
+        key_id id = static_cast<key_id>(r.names.size() - 1);
+        r.ids.emplace(name, id);
+        return id;
+    }
+
+    key_id find_key(std::string_view key)
+    {
+        key_registry &r = registry();
+        std::shared_lock lock(r.mutex);
+        auto it = r.ids.find(key);
+        return it != r.ids.end() ? it->second : no_key;
+    }
+
+    key_values::key_values(const key_values *base) : base(base)
+    {
+        entries.reserve(reserved_entries);
+    }
+
+    void key_values::set(key_id key, std::string_view value)
+    {
+        if (key == no_key)
+        {
+            return;
+        }
+        char *copy = static_cast<char *>(memory.allocate(std::max<size_t>(value.size(), 1), 1));
+        if (!value.empty())
+        {
+            std::memcpy(copy, value.data(), value.size());
+        }
+        entries.push_back({key, std::string_view(copy, value.size())});
+    }
+
+    const std::string_view *key_values::find(key_id key) const
+    {
+        if (key == no_key)
+        {
+            return nullptr;
+        }
+        // Newest first, so a value set twice reads as the last one.
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+        {
+            if (it->key == key)
+            {
+                return &it->value;
+            }
+        }
+        return base ? base->find(key) : nullptr;
+    }
+} // namespace app
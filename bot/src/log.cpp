@@ -0,0 +1,336 @@
+#include "../include/log.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace app::log
+{
+    namespace
+    {
+        using system_clock = std::chrono::system_clock;
+
+        struct record
+        {
+            level lvl;
+            bool truncated;
+            uint16_t command_length;
+            uint16_t message_length;
+            uint64_t bot;
+            uint64_t guild;
+            system_clock::time_point when;
+            char command[64];
+            char message[440];
+        };
+
+        /**
+         * @brief Bounded multi-producer ring of fixed-size records (Vyukov's sequence-numbered queue)
+         *
+         * Producers claim a slot with one CAS and publish it by bumping its sequence number; the
+         * single consumer (whoever holds the writer's mutex) reads slots in order.
+         */
+        class ring
+        {
+        public:
+            static constexpr size_t capacity = 4096;
+
+            ring() : slots(new slot[capacity])
+            {
+                for (size_t i = 0; i < capacity; ++i)
+                {
+                    slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            template <typename Fill>
+            bool push(Fill &&fill)
+            {
+                size_t pos = head.load(std::memory_order_relaxed);
+                slot *s;
+                while (true)
+                {
+                    s = &slots[pos & (capacity - 1)];
+                    size_t sequence = s->sequence.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+                    if (diff == 0)
+                    {
+                        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        pos = head.load(std::memory_order_relaxed);
+                    }
+                }
+                fill(s->rec);
+                s->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Consumer side only.
+            template <typename Use>
+            bool pop(Use &&use)
+            {
+                slot &s = slots[tail & (capacity - 1)];
+                if (s.sequence.load(std::memory_order_acquire) != tail + 1)
+                {
+                    return false;
+                }
+                use(s.rec);
+                s.sequence.store(tail + capacity, std::memory_order_release);
+                ++tail;
+                return true;
+            }
+
+        private:
+            struct slot
+            {
+                std::atomic<size_t> sequence;
+                record rec;
+            };
+
+            std::unique_ptr<slot[]> slots;
+            alignas(64) std::atomic<size_t> head{0};
+            alignas(64) size_t tail = 0;
+        };
+
+        const char *level_name(level lvl)
+        {
+            switch (lvl)
+            {
+            case level::trace:
+                return "TRACE";
+            case level::debug:
+                return "DEBUG";
+            case level::info:
+                return "INFO ";
+            case level::warning:
+                return "WARN ";
+            case level::error:
+                return "ERROR";
+            case level::critical:
+                return "CRIT ";
+            default:
+                return "?    ";
+            }
+        }
+
+        void format(std::string &out, const record &rec)
+        {
+            auto since_epoch = rec.when.time_since_epoch();
+            std::time_t seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+            auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000;
+            std::tm utc;
+            gmtime_r(&seconds, &utc);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+            char head[48];
+            snprintf(head, sizeof(head), "%s.%03dZ %s", stamp, static_cast<int>(millis), level_name(rec.lvl));
+            out += head;
+            if (rec.bot)
+            {
+                out += " bot=";
+                out += std::to_string(rec.bot);
+            }
+            if (rec.guild)
+            {
+                out += " guild=";
+                out += std::to_string(rec.guild);
+            }
+            if (rec.command_length)
+            {
+                out += " command=";
+                out.append(rec.command, rec.command_length);
+            }
+            out += ' ';
+            out.append(rec.message, rec.message_length);
+            if (rec.truncated)
+            {
+                out += "...";
+            }
+            out += '\n';
+        }
+
+        /**
+         * @brief Owns the ring and the background thread that empties it into stdout
+         *
+         * The writer sleeps on `published` and producers only pay for a wake-up when it is
+         * actually asleep.
+         */
+        class writer
+        {
+        public:
+            writer()
+            {
+                thread = std::thread([this]
+                                     { run(); });
+                thread.detach();
+            }
+
+            void push(level lvl, const fields &where, std::string_view message)
+            {
+                auto when = system_clock::now();
+                bool queued = queue.push([&](record &rec)
+                                         {
+                    rec.lvl = lvl;
+                    rec.bot = where.bot;
+                    rec.guild = where.guild;
+                    rec.when = when;
+                    rec.command_length = static_cast<uint16_t>(std::min(where.command.size(), sizeof(rec.command)));
+                    // An empty string_view may have a null data(), which memcpy must not see even for 0 bytes.
+                    if (rec.command_length > 0)
+                    {
+                        std::memcpy(rec.command, where.command.data(), rec.command_length);
+                    }
+                    rec.truncated = message.size() > sizeof(rec.message);
+                    rec.message_length = static_cast<uint16_t>(std::min(message.size(), sizeof(rec.message)));
+                    if (rec.message_length > 0)
+                    {
+                        std::memcpy(rec.message, message.data(), rec.message_length);
+                    } });
+                if (!queued)
+                {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                published.fetch_add(1);
+                if (waiting.load())
+                {
+                    published.notify_one();
+                }
+            }
+
+            void drain()
+            {
+                std::lock_guard lock(consume_mutex);
+                buffer.clear();
+                while (queue.pop([this](const record &rec)
+                                 { format(buffer, rec); }))
+                {
+                    if (buffer.size() > 64 * 1024)
+                    {
+                        write_out();
+                    }
+                }
+                if (uint64_t lost = dropped.exchange(0, std::memory_order_relaxed))
+                {
+                    buffer += "log: " + std::to_string(lost) + " records dropped, the ring buffer was full\n";
+                }
+                write_out();
+            }
+
+        private:
+            void run()
+            {
+                while (true)
+                {
+                    uint64_t seen = published.load();
+                    drain();
+                    waiting.store(true);
+                    if (published.load() == seen)
+                    {
+                        published.wait(seen);
+                    }
+                    waiting.store(false);
+                }
+            }
+
+            void write_out()
+            {
+                if (!buffer.empty())
+                {
+                    fwrite(buffer.data(), 1, buffer.size(), stdout);
+                    fflush(stdout);
+                    buffer.clear();
+                }
+            }
+
+            ring queue;
+            std::atomic<uint64_t> published{0};
+            std::atomic<uint64_t> dropped{0};
+            std::atomic<bool> waiting{false};
+            std::mutex consume_mutex;
+            std::string buffer;
+            std::thread thread;
+        };
+
+        writer &instance()
+        {
+            // Never destroyed: records may still be written from other threads during exit.
+            static writer *w = []
+            {
+                auto *created = new writer();
+                std::atexit([]
+                            { instance().drain(); });
+                return created;
+            }();
+            return *w;
+        }
+
+        // LOG_LEVEL sets the starting threshold; the control plane can change it later.
+        const bool level_from_env = []
+        {
+            if (const char *name = getenv("LOG_LEVEL"))
+            {
+                if (auto lvl = level_from_string(name))
+                {
+                    set_level(*lvl);
+                }
+            }
+            return true;
+        }();
+    }
+
+    void set_level(level lvl)
+    {
+        detail::threshold.store(lvl, std::memory_order_relaxed);
+    }
+
+    level get_level()
+    {
+        return detail::threshold.load(std::memory_order_relaxed);
+    }
+
+    std::optional<level> level_from_string(std::string_view name)
+    {
+        static constexpr std::pair<std::string_view, level> names[] = {
+            {"trace", level::trace},
+            {"debug", level::debug},
+            {"info", level::info},
+            {"warning", level::warning},
+            {"warn", level::warning},
+            {"error", level::error},
+            {"critical", level::critical},
+            {"off", level::off},
+        };
+        for (const auto &[candidate, lvl] : names)
+        {
+            if (candidate == name)
+            {
+                return lvl;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void write(level lvl, const fields &where, std::string_view message)
+    {
+        instance().push(lvl, where, message);
+    }
+
+    void flush()
+    {
+        instance().drain();
+    }
+} // namespace app::log
@@ -2,29 +2,148 @@
 #include <string>
 #include "../include/utils.hpp"
 #include "../include/http_webhook_server.hpp"
-#include "../include/handle_actions.hpp"
+#include "../include/bot_instance.hpp"
+#include "../include/bot_host.hpp"
+#include "../include/config_snapshot.hpp"
+#include "../include/log.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <pthread.h>
 #include <thread>
+#include <unistd.h>
+
+HttpWebhookServer::Options webhook_options() {
+    // Large `update` bodies are parsed on the handler threads so they never
+    // hold up the epoll loops (and health probes) behind them.
+    HttpWebhookServer::Options options;
+    options.handler_threads = 2;
+    if (const char* workers = getenv("WEBHOOK_WORKERS")) {
+        options.workers = std::stoul(workers);
+    }
+    if (const char* handler_threads = getenv("WEBHOOK_HANDLER_THREADS")) {
+        options.handler_threads = std::stoul(handler_threads);
+    }
+    return options;
+}
 
+// How long running interactions get to finish once SIGTERM arrives, from BOT_SHUTDOWN_GRACE (seconds).
+std::chrono::steady_clock::duration shutdown_grace() {
+    constexpr std::chrono::seconds fallback(10);
+    const char* grace = getenv("BOT_SHUTDOWN_GRACE");
+    if (!grace) {
+        return fallback;
+    }
+    try {
+        size_t end = 0;
+        double seconds = std::stod(grace, &end);
+        // Also rejects NaN, which compares false.
+        if (end == strlen(grace) && seconds >= 0 && seconds <= 3600) {
+            return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        }
+    } catch (const std::exception&) {
+    }
+    app::log::warning({}, std::string("Invalid BOT_SHUTDOWN_GRACE \"") + grace + "\", expected 0 to 3600 seconds; using 10");
+    return fallback;
+}
+
+// The supervisor stops a bot with SIGTERM to its process group. Blocked before any thread
+// starts, so every thread inherits the mask and only wait_for_shutdown() ever sees them.
+sigset_t block_shutdown_signals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    return signals;
+}
 
-dpp::activity_type activity_type_from_string(const std::string& type) {
-    if (type == "playing") {
-        return dpp::activity_type::at_game;
-    } else if (type == "streaming") {
-        return dpp::activity_type::at_streaming;
-    } else if (type == "listening") {
-        return dpp::activity_type::at_listening;
-    } else if (type == "watching") {
-        return dpp::activity_type::at_watching;
-    } else if (type == "custom") {
-        return dpp::activity_type::at_custom;
-    } else if (type == "competing") {
-        return dpp::activity_type::at_competing;
-    } else {
-        throw std::invalid_argument("Invalid activity type");
+void wait_for_shutdown(const sigset_t& signals) {
+    int signal = 0;
+    while (sigwait(&signals, &signal) != 0) {}
+    app::log::info({}, std::string("Received ") + strsignal(signal) + ", draining interactions");
+    // Back to the default disposition on this thread, the only one not blocking them anymore:
+    // a second signal ends the process at once instead of waiting for the drain.
+    std::signal(SIGTERM, SIG_DFL);
+    std::signal(SIGINT, SIG_DFL);
+    pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+}
+
+// The last accepted config must make it to disk: snapshots are written in the background.
+void flush_before_exit() {
+    app::config_snapshot::writer::instance().flush();
+    app::log::flush();
+}
+
+// `discord-bot --host <port>`: many bots in this process, added and removed over one control port.
+int run_host(const std::string& port) {
+    sigset_t signals = block_shutdown_signals();
+    app::bot_host host(shutdown_grace());
+    std::unique_ptr<HttpWebhookServer> server;
+    try {
+        server = std::make_unique<HttpWebhookServer>(std::stoi(port), [&host](const HttpWebhookServer::HttpRequest& req) {
+            return host.handle(req);
+        }, webhook_options());
+    } catch (const std::exception& e) {
+        app::log::error({}, std::string("Host server error: ") + e.what());
+        return 1;
     }
+
+    // The control port keeps answering while the bots drain, so it runs off the thread that waits for the signal.
+    std::atomic<bool> stopping{false};
+    bool failed = false;
+    std::thread server_thread([&server, &stopping, &failed, &port]() {
+        try {
+            app::log::info({}, "Host control server running on port " + port);
+            server->start();
+        } catch (const std::exception& e) {
+            app::log::error({}, std::string("Host server error: ") + e.what());
+            failed = true;
+        }
+        if (!stopping) {
+            // Without its control port the host is of no use: shut it down like the supervisor would.
+            kill(getpid(), SIGTERM);
+        }
+    });
+
+    wait_for_shutdown(signals);
+    stopping = true;
+    host.shutdown();
+    server->stop();
+    server_thread.join();
+    flush_before_exit();
+    return failed ? 1 : 0;
+}
+
+// `discord-bot --offline <port>`: the control endpoint of a single bot that never connects to the
+// gateway. Commands are applied as usual, so the webhook path can be load-tested locally (bot-loadgen).
+int run_offline(const std::string& port) {
+    app::bot_instance bot("offline");
+    try {
+        HttpWebhookServer server(std::stoi(port), [&bot](const HttpWebhookServer::HttpRequest& req) {
+            return app::handle_bot_request(bot, req);
+        }, webhook_options());
+
+        app::log::info({}, "Offline webhook server running on port " + port);
+        server.start();
+    } catch (const std::exception& e) {
+        app::log::error({}, std::string("Webhook server error: ") + e.what());
+        return 1;
+    }
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
+    if (argc > 2 && std::string(argv[1]) == "--host") {
+        return run_host(argv[2]);
+    }
+    if (argc > 2 && std::string(argv[1]) == "--offline") {
+        return run_offline(argv[2]);
+    }
+
     if (argc > 2) {
         setenv("BOT_TOKEN", argv[1], 1);
         setenv("PORT", argv[2], 1);
@@ -33,110 +152,38 @@ int main(int argc, char* argv[]) {
     const std::string BOT_TOKEN = getenv("BOT_TOKEN");
     const std::string PORT = getenv("PORT");
 
-    dpp::cluster bot(BOT_TOKEN);
-    std::unique_ptr<nlohmann::json> json_data = std::make_unique<nlohmann::json>();
-
-    bot.on_log(dpp::utility::cout_logger());
-
-    bot.on_slashcommand([&json_data, &bot](const dpp::slashcommand_t& event) -> dpp::task<void> {
-        std::unordered_map<std::string, std::string> key_values = app::generate_key_values(event);
-        std::string command_name = event.command.get_command_name();
-        std::string response = "Interaction found, but no response found.";
-
-        if (!command_name.empty() && json_data->contains(command_name)) {
-            auto& command_data = (*json_data)[command_name];
-            if (command_data.contains("actions")) {
-                auto& action = command_data["actions"];
-                // Actions are a list of Objects
-                if (action.is_array()) {
-                    std::cout << "Executing → Actions: " << action.dump() << std::endl;
-                    auto already_returned_message = co_await handle_actions(event, action, key_values);
-                    if(!already_returned_message) {
-                        std::cout << "Command: " << command_name << " → Action: " << action.dump() << std::endl;
-                        co_return;
-                    }else {
-                        // This mean we need to edit the response, not reply
-                        if(command_data.contains("response")) {
-                            response = command_data["response"];
-                            std::cout << "Command: " << command_name << " → Response: " << response << std::endl;
-                        }
-                        event.edit_response(app::update_string(response, key_values));
-                        co_return;
-                    }
-                }
-            }
-            if (command_data.contains("response")) {
-                response = command_data["response"];
-                std::cout << "Command: " << command_name << " → Response: " << response << std::endl;
+    sigset_t signals = block_shutdown_signals();
+
+    // Intents, cache policy and shards come from BOT_CLUSTER_OPTIONS; the defaults match DPP's.
+    app::bot_instance bot(BOT_TOKEN, app::cluster_options::from_env());
+
+    // The bot keeps running without its webhook port, as it always has.
+    std::unique_ptr<HttpWebhookServer> server;
+    std::thread http_thread;
+    try {
+        server = std::make_unique<HttpWebhookServer>(std::stoi(PORT), [&bot](const HttpWebhookServer::HttpRequest& req) {
+            return app::handle_bot_request(bot, req);
+        }, webhook_options());
+        http_thread = std::thread([&server, &PORT]() {
+            try {
+                app::log::info({}, "Webhook server running on port " + PORT);
+                server->start();
+            } catch (const std::exception& e) {
+                app::log::error({}, std::string("Webhook server error: ") + e.what());
             }
-        }
-
-        event.reply(app::update_string(response, key_values));
-    });
-
-    bot.on_ready([&bot, &json_data, &PORT](const dpp::ready_t& event) {
-        if (dpp::run_once<struct register_bot_commands>()) {
-            std::thread http_thread([&json_data, &PORT,&bot]() {
-                try {
-                    HttpWebhookServer server(std::stoi(PORT), [&json_data, &bot](const HttpWebhookServer::HttpRequest& req) {
-                        HttpWebhookServer::HttpResponse res;
-
-                        if (req.method == "POST") {
-                            res.status_code = 200;
-                            res.headers["Content-Type"] = "application/json";
-
-                            try {
-                                nlohmann::json body_json = app::json_from_string(req.body);
-                                res.body = R"({"received": "POST request received"})";
-
-                                if (body_json.contains("command")) {
-                                    if(body_json["command"] == "update"){
-                                        json_data = std::make_unique<nlohmann::json>(body_json["data"]);
-                                    }else if(body_json["command"] == "update_status"){
-                                        std::string status = body_json.contains("status") ? body_json["status"] : "online";
-                                        std::string activity = body_json.contains("activity") ? body_json["activity"] : "";
-                                        std::string activity_status = body_json.contains("activity_status") ? body_json["activity_status"] : "";
-                                        std::string activity_url = body_json.contains("activity_url") ? body_json["activity_url"] : "";
-                                        std::string activity_type = body_json.contains("activity_type") ? body_json["activity_type"] : "playing";
-                                        dpp::presence p;
-                                        if (status == "online") {
-                                            p = dpp::presence(dpp::presence_status::ps_online, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
-                                        } else if (status == "offline") {
-                                            p = dpp::presence(dpp::presence_status::ps_offline, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
-                                        } else if (status == "dnd") {
-                                            p = dpp::presence(dpp::presence_status::ps_dnd, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
-                                        } else if (status == "idle") {
-                                            p = dpp::presence(dpp::presence_status::ps_idle, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
-                                        } else if (status == "invisible") {
-                                            p = dpp::presence(dpp::presence_status::ps_invisible, dpp::activity(activity_type_from_string(activity_type), activity, activity_status, activity_url));
-                                        }
-                                        bot.set_presence(p);
-                                    }
-                                    res.body = R"({"status": "success", "message": "Command executed successfully"})";
-                                }
-                            } catch (const std::exception& e) {
-                                res.status_code = 400;
-                                res.body = std::string("{\"error\": \"") + e.what() + "\"}";
-                            }
-                        } else {
-                            res.status_code = 400;
-                            res.headers["Content-Type"] = "text/plain";
-                            res.body = "Invalid request method.";
-                        }
-
-                        return res;
-                    });
-
-                    std::cout << "[BOT] Webhook server running on port " << PORT << "..." << std::endl;
-                    server.start();
-                } catch (const std::exception& e) {
-                    std::cerr << "[BOT] Server error: " << e.what() << std::endl;
-                }
-            });
-
-            http_thread.detach();
-        }
-    });
+        });
+    } catch (const std::exception& e) {
+        app::log::error({}, std::string("Webhook server error: ") + e.what());
+    }
 
-    bot.start(dpp::st_wait);
+    bot.start();
+    wait_for_shutdown(signals);
+    bot.drain(shutdown_grace());
+    bot.stop();
+    if (server) {
+        server->stop();
+        http_thread.join();
+    }
+    flush_before_exit();
+    return 0;
 }
@@ -0,0 +1,325 @@
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+namespace app::metrics
+{
+    namespace
+    {
+        size_t stripe_index()
+        {
+            static std::atomic<size_t> next{0};
+            thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % stripes;
+            return index;
+        }
+
+        struct string_hash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+        };
+
+        /**
+         * @brief A metric name labelled by bot and by at most one more label, with one series per pair of values
+         *
+         * Series are created once and never freed, so each thread keeps its own lookup table and
+         * only takes the mutex the first time it sees a pair.
+         */
+        template <typename T>
+        class family
+        {
+        public:
+            // label is null for a metric only labelled by bot.
+            family(const char *name, const char *help, const char *label = nullptr) : name(name), help(help), label(label) {}
+
+            T &get(uint64_t bot, std::string_view label_value = {})
+            {
+                thread_local std::unordered_map<const family *, std::unordered_map<uint64_t, std::unordered_map<std::string, T *, string_hash, std::equal_to<>>>> local;
+                auto &cache = local[this][bot];
+                auto it = cache.find(label_value);
+                if (it != cache.end())
+                {
+                    return *it->second;
+                }
+                T *metric;
+                {
+                    std::lock_guard lock(mutex);
+                    auto &of_bot = series[bot];
+                    auto found = of_bot.find(label_value);
+                    if (found == of_bot.end())
+                    {
+                        found = of_bot.emplace(std::string(label_value), std::make_unique<T>()).first;
+                    }
+                    metric = found->second.get();
+                }
+                cache.emplace(std::string(label_value), metric);
+                return *metric;
+            }
+
+            template <typename Fn>
+            void for_each(Fn &&fn)
+            {
+                std::lock_guard lock(mutex);
+                for (const auto &[bot, of_bot] : series)
+                {
+                    for (const auto &[label_value, metric] : of_bot)
+                    {
+                        fn(bot, label_value, *metric);
+                    }
+                }
+            }
+
+            const char *name;
+            const char *help;
+            const char *label;
+
+        private:
+            std::mutex mutex;
+            std::map<uint64_t, std::map<std::string, std::unique_ptr<T>, std::less<>>> series;
+        };
+
+        struct gauge
+        {
+            std::atomic<uint64_t> value{0};
+        };
+
+        struct registry
+        {
+            family<histogram> ack{"discord_bot_interaction_ack_seconds", "Time from receiving an interaction to replying or deferring it.", "command"};
+            family<histogram> response{"discord_bot_interaction_response_seconds", "Time from receiving an interaction to its final reply or edit_response.", "command"};
+            family<histogram> action{"discord_bot_action_duration_seconds", "Time spent running one action of a command.", "action"};
+            family<counter> rest_calls{"discord_bot_rest_calls_total", "REST calls made while answering interactions, by the action or step that made them.", "action"};
+            family<counter> rest_errors{"discord_bot_rest_errors_total", "REST calls made while answering interactions that Discord answered with an error.", "action"};
+            family<counter> rejected{"discord_bot_interactions_rejected_total", "Interactions turned away by the command's rate limits, or because the bot was shutting down.", "command"};
+            family<histogram> config_reload{"discord_bot_config_reload_seconds", "Time to build the command table on `update`."};
+            family<gauge> config_commands{"discord_bot_config_commands", "Commands in the last loaded config."};
+        };
+
+        registry &metrics()
+        {
+            static registry instance;
+            return instance;
+        }
+
+        // Label values come from user configs: escape them as the exposition format requires.
+        void append_label(std::string &out, const char *label, std::string_view value)
+        {
+            out += label;
+            out += "=\"";
+            for (char c : value)
+            {
+                if (c == '\\' || c == '"')
+                {
+                    out += '\\';
+                    out += c;
+                }
+                else if (c == '\n')
+                {
+                    out += "\\n";
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+            out += '"';
+        }
+
+        void append_header(std::string &out, const char *name, const char *help, const char *type)
+        {
+            out += "# HELP ";
+            out += name;
+            out += ' ';
+            out += help;
+            out += "\n# TYPE ";
+            out += name;
+            out += ' ';
+            out += type;
+            out += '\n';
+        }
+
+        void append_seconds(std::string &out, double seconds)
+        {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.15g", seconds);
+            out += buffer;
+        }
+
+        // `labels` is the already formatted label list without braces, possibly empty.
+        void append_histogram(std::string &out, const char *name, const std::string &labels, const histogram &h)
+        {
+            auto snap = h.read();
+            std::string prefix = labels.empty() ? "" : labels + ",";
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < snap.buckets.size(); ++i)
+            {
+                cumulative += snap.buckets[i];
+                out += name;
+                out += "_bucket{";
+                out += prefix;
+                out += "le=\"";
+                if (i < histogram::bounds_us.size())
+                {
+                    append_seconds(out, histogram::bounds_us[i] / 1e6);
+                }
+                else
+                {
+                    out += "+Inf";
+                }
+                out += "\"} ";
+                out += std::to_string(cumulative);
+                out += '\n';
+            }
+            std::string braces = labels.empty() ? "" : "{" + labels + "}";
+            out += name;
+            out += "_sum";
+            out += braces;
+            out += ' ';
+            append_seconds(out, snap.sum_us / 1e6);
+            out += '\n';
+            out += name;
+            out += "_count";
+            out += braces;
+            out += ' ';
+            out += std::to_string(snap.count);
+            out += '\n';
+        }
+
+        // The label list of one series, without braces.
+        template <typename T>
+        std::string labels_of(const family<T> &f, uint64_t bot, const std::string &value)
+        {
+            std::string labels = "bot=\"" + std::to_string(bot) + "\"";
+            if (f.label)
+            {
+                labels += ',';
+                append_label(labels, f.label, value);
+            }
+            return labels;
+        }
+
+        void append_family(std::string &out, family<histogram> &f)
+        {
+            append_header(out, f.name, f.help, "histogram");
+            f.for_each([&](uint64_t bot, const std::string &value, const histogram &h)
+                       { append_histogram(out, f.name, labels_of(f, bot, value), h); });
+        }
+
+        template <typename T>
+        void append_values(std::string &out, family<T> &f, const char *type)
+        {
+            append_header(out, f.name, f.help, type);
+            f.for_each([&](uint64_t bot, const std::string &value, const T &metric)
+                       {
+                out += f.name;
+                out += '{';
+                out += labels_of(f, bot, value);
+                out += "} ";
+                if constexpr (std::is_same_v<T, gauge>)
+                {
+                    out += std::to_string(metric.value.load(std::memory_order_relaxed));
+                }
+                else
+                {
+                    out += std::to_string(metric.read());
+                }
+                out += '\n'; });
+        }
+    }
+
+    void histogram::observe(clock::duration elapsed)
+    {
+        uint64_t us = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        size_t bucket = std::lower_bound(bounds_us.begin(), bounds_us.end(), us) - bounds_us.begin();
+        stripe &s = data[stripe_index()];
+        s.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        s.sum_us.fetch_add(us, std::memory_order_relaxed);
+    }
+
+    histogram::snapshot histogram::read() const
+    {
+        snapshot snap;
+        for (const auto &s : data)
+        {
+            for (size_t i = 0; i < snap.buckets.size(); ++i)
+            {
+                snap.buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+            }
+            snap.sum_us += s.sum_us.load(std::memory_order_relaxed);
+        }
+        for (uint64_t n : snap.buckets)
+        {
+            snap.count += n;
+        }
+        return snap;
+    }
+
+    void counter::add(uint64_t n)
+    {
+        data[stripe_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t counter::read() const
+    {
+        uint64_t total = 0;
+        for (const auto &s : data)
+        {
+            total += s.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    interaction_timer start_interaction(uint64_t bot, std::string_view command)
+    {
+        auto &m = metrics();
+        return {clock::now(), &m.ack.get(bot, command), &m.response.get(bot, command)};
+    }
+
+    histogram &action_duration(uint64_t bot, std::string_view action)
+    {
+        return metrics().action.get(bot, action);
+    }
+
+    void rest_call(uint64_t bot, std::string_view action, bool error)
+    {
+        auto &m = metrics();
+        m.rest_calls.get(bot, action).add();
+        if (error)
+        {
+            m.rest_errors.get(bot, action).add();
+        }
+    }
+
+    void interaction_rejected(uint64_t bot, std::string_view command)
+    {
+        metrics().rejected.get(bot, command).add();
+    }
+
+    void config_reloaded(uint64_t bot, clock::duration elapsed, size_t commands)
+    {
+        auto &m = metrics();
+        m.config_reload.get(bot).observe(elapsed);
+        m.config_commands.get(bot).value.store(commands, std::memory_order_relaxed);
+    }
+
+    std::string render()
+    {
+        auto &m = metrics();
+        std::string out;
+        out.reserve(16 * 1024);
+        append_family(out, m.ack);
+        append_family(out, m.response);
+        append_family(out, m.action);
+        append_values(out, m.rest_calls, "counter");
+        append_values(out, m.rest_errors, "counter");
+        append_values(out, m.rejected, "counter");
+        append_family(out, m.config_reload);
+        append_values(out, m.config_commands, "gauge");
+        return out;
+    }
+} // namespace app::metrics
@@ -0,0 +1,195 @@
+#include "../include/permission_cache.hpp"
+#include <mutex>
+#include <type_traits>
+
+namespace app
+{
+    namespace
+    {
+        // DPP events hold their entities either by pointer or by value depending on the release.
+        template <typename T>
+        dpp::snowflake id_of(const T &entity)
+        {
+            if constexpr (std::is_pointer_v<T>)
+            {
+                return entity ? dpp::snowflake(entity->id) : dpp::snowflake(0);
+            }
+            else
+            {
+                return entity.id;
+            }
+        }
+
+        template <typename E>
+        dpp::snowflake event_guild(const E &event)
+        {
+            if constexpr (requires { event.updating_guild; })
+                return id_of(event.updating_guild);
+            else if constexpr (requires { event.deleting_guild; })
+                return id_of(event.deleting_guild);
+            else if constexpr (requires { event.removing_guild; })
+                return id_of(event.removing_guild);
+            else if constexpr (requires { event.guild_id; })
+                return event.guild_id;
+            else
+                return 0;
+        }
+    }
+
+    permission_cache &permission_cache::instance()
+    {
+        static permission_cache cache;
+        return cache;
+    }
+
+    void permission_cache::attach(dpp::cluster &cluster)
+    {
+        // An unknown guild id (0) drops everything: stale permissions are worse than a recompute.
+        auto guild_changed = [this](dpp::snowflake guild_id)
+        {
+            guild_id ? invalidate_guild(guild_id) : clear();
+        };
+
+        cluster.on_guild_role_update([guild_changed](const dpp::guild_role_update_t &event)
+                                     { guild_changed(event_guild(event)); });
+        cluster.on_guild_role_delete([guild_changed](const dpp::guild_role_delete_t &event)
+                                     { guild_changed(event_guild(event)); });
+        cluster.on_guild_update([guild_changed](const dpp::guild_update_t &event)
+                                { guild_changed(id_of(event.updated)); });
+        cluster.on_guild_delete([guild_changed](const dpp::guild_delete_t &event)
+                                { guild_changed(id_of(event.deleted)); });
+        cluster.on_channel_update([this](const dpp::channel_update_t &event)
+                                  { invalidate_channel(event_guild(event), id_of(event.updated)); });
+        cluster.on_channel_delete([this](const dpp::channel_delete_t &event)
+                                  { invalidate_channel(event_guild(event), id_of(event.deleted)); });
+        cluster.on_guild_member_update([this](const dpp::guild_member_update_t &event)
+                                       { invalidate_member(event_guild(event), event.updated.user_id); });
+        cluster.on_guild_member_remove([this](const dpp::guild_member_remove_t &event)
+                                       { invalidate_member(event_guild(event), id_of(event.removed)); });
+    }
+
+    std::optional<dpp::permission> permission_cache::channel_permissions(dpp::snowflake guild_id, dpp::snowflake channel_id, dpp::snowflake member_id, const dpp::guild_member *fallback)
+    {
+        shard &s = shard_for(guild_id);
+        const entry_key key{channel_id, member_id};
+        uint64_t generation;
+        {
+            std::shared_lock lock(s.mutex);
+            auto guild_it = s.guilds.find(guild_id);
+            if (guild_it != s.guilds.end())
+            {
+                auto it = guild_it->second.find(key);
+                if (it != guild_it->second.end())
+                {
+                    return dpp::permission(it->second);
+                }
+            }
+            generation = s.generation;
+        }
+
+        // Miss: compute from the cached entities, never copying the guild.
+        const dpp::channel *channel = dpp::find_channel(channel_id);
+        if (!channel)
+        {
+            return std::nullopt;
+        }
+        std::optional<dpp::guild_member> member;
+        {
+            // Shard threads update members under the cache's own lock. The member is copied out rather than
+            // read in place, since computing the permissions looks the guild up again and takes that lock.
+            auto *guilds = dpp::get_guild_cache();
+            std::shared_lock cache_lock(guilds->get_mutex());
+            auto guild_it = guilds->get_container().find(guild_id);
+            if (guild_it == guilds->get_container().end() || !guild_it->second)
+            {
+                return std::nullopt;
+            }
+            auto member_it = guild_it->second->members.find(member_id);
+            if (member_it != guild_it->second->members.end())
+            {
+                member = member_it->second;
+            }
+        }
+        if (!member && !fallback)
+        {
+            return std::nullopt;
+        }
+        if (!member)
+        {
+            // Not in the member cache, so no member event would ever invalidate it (those need the GUILD_MEMBERS
+            // intent, which a bot may go without): the interaction's copy is fresh, use it once and keep nothing.
+            return channel->get_user_permissions(*fallback);
+        }
+        dpp::permission permissions = channel->get_user_permissions(*member);
+
+        std::unique_lock lock(s.mutex);
+        // An invalidation that ran while computing may have been about what was just read: return it, don't keep it.
+        if (s.generation != generation)
+        {
+            return permissions;
+        }
+        auto &entries = s.guilds[guild_id];
+        if (entries.size() >= max_entries_per_guild)
+        {
+            entries.clear();
+        }
+        entries[key] = permissions;
+        return permissions;
+    }
+
+    void permission_cache::invalidate_guild(dpp::snowflake guild_id)
+    {
+        shard &s = shard_for(guild_id);
+        std::unique_lock lock(s.mutex);
+        ++s.generation;
+        s.guilds.erase(guild_id);
+    }
+
+    void permission_cache::invalidate_channel(dpp::snowflake guild_id, dpp::snowflake channel_id)
+    {
+        if (!guild_id)
+        {
+            clear();
+            return;
+        }
+        shard &s = shard_for(guild_id);
+        std::unique_lock lock(s.mutex);
+        ++s.generation;
+        auto guild_it = s.guilds.find(guild_id);
+        if (guild_it == s.guilds.end())
+        {
+            return;
+        }
+        std::erase_if(guild_it->second, [channel_id](const auto &entry)
+                      { return entry.first.channel_id == channel_id; });
+    }
+
+    void permission_cache::invalidate_member(dpp::snowflake guild_id, dpp::snowflake member_id)
+    {
+        if (!guild_id)
+        {
+            clear();
+            return;
+        }
+        shard &s = shard_for(guild_id);
+        std::unique_lock lock(s.mutex);
+        ++s.generation;
+        auto guild_it = s.guilds.find(guild_id);
+        if (guild_it == s.guilds.end())
+        {
+            return;
+        }
+        std::erase_if(guild_it->second, [member_id](const auto &entry)
+                      { return entry.first.member_id == member_id; });
+    }
+
+    void permission_cache::clear()
+    {
+        for (auto &s : shards)
+        {
+            std::unique_lock lock(s.mutex);
+            ++s.generation;
+            s.guilds.clear();
+        }
+    }
+} // namespace app
@@ -0,0 +1,121 @@
+#include "../include/placeholder_set.hpp"
+#include <array>
+
+namespace app
+{
+    namespace
+    {
+        constexpr std::array<std::string_view, static_cast<size_t>(builtin_key::count)> builtin_names = {
+            "commandName", "commandId", "commandType", "userName", "userId", "userAvatar",
+            "guildName", "channelName", "channelId", "channelType", "guildId", "guildIcon",
+            "guildCount", "guildOwner", "guildCreatedAt", "guildBoostTier", "guildBoostCount"};
+
+        // Index 0 is the bare `opts.<name>` value and has no suffix.
+        constexpr std::array<std::string_view, static_cast<size_t>(option_field::count)> option_field_names = {
+            "", "id", "avatar", "discriminator", "bot", "created_at", "type",
+            "color", "hoist", "position", "nick", "joined_at", "filename", "size"};
+
+        constexpr std::string_view option_prefix = "opts.";
+
+        std::string option_key_name(std::string_view name, size_t field)
+        {
+            std::string key(option_prefix);
+            key += name;
+            if (!option_field_names[field].empty())
+            {
+                key += '.';
+                key += option_field_names[field];
+            }
+            return key;
+        }
+    }
+
+    key_id builtin_key_id(builtin_key key)
+    {
+        // Interned once, in enum order, on first use.
+        static const std::array<key_id, builtin_names.size()> ids = []
+        {
+            std::array<key_id, builtin_names.size()> interned;
+            for (size_t i = 0; i < builtin_names.size(); ++i)
+            {
+                interned[i] = intern_key(builtin_names[i]);
+            }
+            return interned;
+        }();
+        return ids[static_cast<size_t>(key)];
+    }
+
+    placeholder_set placeholder_set::all()
+    {
+        placeholder_set set;
+        set.all_ = true;
+        return set;
+    }
+
+    void placeholder_set::add(std::string_view key)
+    {
+        if (all_)
+        {
+            return;
+        }
+
+        if (key.substr(0, option_prefix.size()) == option_prefix)
+        {
+            // Option names cannot contain a dot, so the first one separates the field.
+            std::string_view rest = key.substr(option_prefix.size());
+            size_t dot = rest.find('.');
+            std::string_view name = rest.substr(0, dot);
+            std::string_view field = dot == std::string_view::npos ? std::string_view{} : rest.substr(dot + 1);
+            for (size_t i = 0; i < option_field_names.size(); ++i)
+            {
+                if (option_field_names[i] == field)
+                {
+                    auto [it, inserted] = options_.try_emplace(std::string(name));
+                    if (inserted)
+                    {
+                        it->second.keys.fill(no_key);
+                    }
+                    it->second.fields |= 1u << i;
+                    it->second.keys[i] = intern_key(key);
+                    return;
+                }
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < builtin_names.size(); ++i)
+        {
+            if (builtin_names[i] == key)
+            {
+                builtins_ |= 1u << i;
+                return;
+            }
+        }
+    }
+
+    bool placeholder_set::wants_option(const std::string &name, option_field field) const
+    {
+        if (all_)
+        {
+            return true;
+        }
+        auto it = options_.find(name);
+        return it != options_.end() && (it->second.fields & (1u << static_cast<uint8_t>(field)));
+    }
+
+    option_keys placeholder_set::keys_of(const std::string &name) const
+    {
+        option_keys keys;
+        keys.fill(no_key);
+        if (all_)
+        {
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                keys[i] = intern_key(option_key_name(name, i));
+            }
+            return keys;
+        }
+        auto it = options_.find(name);
+        return it != options_.end() ? it->second.keys : keys;
+    }
+} // namespace app
@@ -0,0 +1,99 @@
+#include "../include/presence_scheduler.hpp"
+#include "../include/deadline_queue.hpp"
+#include "../include/log.hpp"
+#include <algorithm>
+#include <mutex>
+#include <optional>
+
+namespace app
+{
+    namespace
+    {
+        using clock = deadline_queue::clock;
+
+        // Discord allows 120 gateway commands per minute per connection, shared with heartbeats and
+        // member requests; a presence every 4 seconds stays far below it on every shard.
+        constexpr std::chrono::seconds min_interval{4};
+    }
+
+    struct presence_scheduler::state
+    {
+        std::mutex mutex;
+        // Cleared by the scheduler's destructor; flushes scheduled after that do nothing.
+        dpp::cluster *bot;
+        std::optional<dpp::presence> pending;
+        bool flush_scheduled = false;
+        clock::time_point last_sent = clock::time_point::min();
+
+        explicit state(dpp::cluster *bot) : bot(bot) {}
+
+        void flush()
+        {
+            // Held while sending so the destructor cannot return with a flush still using the cluster.
+            std::lock_guard lock(mutex);
+            flush_scheduled = false;
+            if (!bot || !pending)
+            {
+                return;
+            }
+            last_sent = clock::now();
+            try
+            {
+                bot->set_presence(*pending);
+                log::debug({bot->me.id}, "Presence sent");
+            }
+            catch (const std::exception &e)
+            {
+                log::warning({bot->me.id}, std::string("Sending the presence failed: ") + e.what());
+            }
+            pending.reset();
+        }
+    };
+
+    presence_scheduler::presence_scheduler(dpp::cluster &bot) : shared(std::make_shared<state>(&bot))
+    {
+    }
+
+    presence_scheduler::~presence_scheduler()
+    {
+        std::lock_guard lock(shared->mutex);
+        shared->bot = nullptr;
+        shared->pending.reset();
+    }
+
+    presence_scheduler::outcome presence_scheduler::request(const dpp::presence &presence)
+    {
+        std::lock_guard lock(shared->mutex);
+        bool replaced = shared->pending.has_value();
+        shared->pending = presence;
+        if (shared->flush_scheduled)
+        {
+            return replaced ? outcome::coalesced : outcome::scheduled;
+        }
+        shared->flush_scheduled = true;
+        auto now = clock::now();
+        auto next_slot = shared->last_sent == clock::time_point::min() ? now : shared->last_sent + min_interval;
+        std::weak_ptr<state> weak = shared;
+        deadline_queue::instance().schedule(std::max(now, next_slot), [weak]
+                                            {
+                                                if (auto s = weak.lock())
+                                                {
+                                                    s->flush();
+                                                } });
+        return next_slot <= now ? outcome::queued : outcome::scheduled;
+    }
+
+    std::string_view presence_scheduler::outcome_name(outcome result)
+    {
+        switch (result)
+        {
+        case outcome::queued:
+            return "queued";
+        case outcome::scheduled:
+            return "scheduled";
+        case outcome::coalesced:
+            return "coalesced";
+        }
+        return "";
+    }
+} // namespace app
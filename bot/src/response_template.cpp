@@ -0,0 +1,115 @@
+#include "../include/response_template.hpp"
+#include <string_view>
+
+namespace app
+{
+    namespace
+    {
+        constexpr std::string_view whitespace = " \t\n\r\f\v";
+
+        std::string_view trim_view(std::string_view s)
+        {
+            size_t begin = s.find_first_not_of(whitespace);
+            if (begin == std::string_view::npos)
+            {
+                return {};
+            }
+            size_t end = s.find_last_not_of(whitespace);
+            return s.substr(begin, end - begin + 1);
+        }
+    }
+
+    response_template::response_template(std::string source) : source_(std::move(source))
+    {
+        compile();
+    }
+
+    void response_template::compile()
+    {
+        const std::string_view src(source_);
+        size_t last_pos = 0;
+        size_t search_pos = 0;
+
+        auto push_literal = [this](size_t from, size_t to)
+        {
+            if (to > from)
+            {
+                segments_.push_back({false, static_cast<uint32_t>(from), static_cast<uint32_t>(to - from)});
+                literal_size_ += to - from;
+            }
+        };
+
+        while (true)
+        {
+            size_t open = src.find("((", search_pos);
+            if (open == std::string_view::npos)
+            {
+                break;
+            }
+            size_t close = src.find("))", open + 2);
+            if (close == std::string_view::npos)
+            {
+                break;
+            }
+            // Same rule as the regex in update_string, whose `.` matches neither '\n' nor '\r': a placeholder
+            // never spans a line break, so retry from the next character instead of matching across it.
+            std::string_view content = src.substr(open + 2, close - open - 2);
+            if (content.find_first_of("\r\n") != std::string_view::npos)
+            {
+                search_pos = open + 1;
+                continue;
+            }
+
+            push_literal(last_pos, open);
+
+            segment group{true, static_cast<uint32_t>(keys_.size()), 0};
+            // Mirrors std::getline on '|': an empty content yields no key and a trailing
+            // separator does not produce an extra empty key.
+            size_t start = 0;
+            while (start < content.size())
+            {
+                size_t bar = content.find('|', start);
+                size_t stop = bar == std::string_view::npos ? content.size() : bar;
+                keys_.emplace_back(trim_view(content.substr(start, stop - start)));
+                key_ids_.push_back(intern_key(keys_.back()));
+                group.length++;
+                if (bar == std::string_view::npos)
+                {
+                    break;
+                }
+                start = bar + 1;
+            }
+            segments_.push_back(group);
+            placeholder_count_++;
+
+            last_pos = close + 2;
+            search_pos = last_pos;
+        }
+        push_literal(last_pos, src.size());
+    }
+
+    std::string response_template::render(const key_values &values) const
+    {
+        std::string result;
+        // Literal text is known exactly; placeholders are guessed at a short value each.
+        result.reserve(literal_size_ + placeholder_count_ * 16);
+
+        for (const auto &seg : segments_)
+        {
+            if (!seg.placeholder)
+            {
+                result.append(source_, seg.offset, seg.length);
+                continue;
+            }
+            for (uint32_t k = seg.offset; k < seg.offset + seg.length; ++k)
+            {
+                if (const std::string_view *found = values.find(key_ids_[k]))
+                {
+                    result.append(*found);
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+} // namespace app
@@ -0,0 +1,86 @@
+#include "../include/rest_api.hpp"
+
+namespace app
+{
+    namespace
+    {
+        class cluster_rest : public rest_api
+        {
+        public:
+            explicit cluster_rest(dpp::cluster &bot) : bot(bot) {}
+
+            void interaction_response_create(dpp::snowflake interaction_id, const std::string &token, const dpp::interaction_response &response, completion callback) override
+            {
+                bot.interaction_response_create(interaction_id, token, response, std::move(callback));
+            }
+
+            void interaction_response_edit(const std::string &token, const dpp::message &message, completion callback) override
+            {
+                bot.interaction_response_edit(token, message, std::move(callback));
+            }
+
+            void messages_get(dpp::snowflake channel_id, dpp::snowflake around, dpp::snowflake before, dpp::snowflake after, uint64_t limit, completion callback) override
+            {
+                bot.messages_get(channel_id, around, before, after, limit, std::move(callback));
+            }
+
+            void message_delete(dpp::snowflake message_id, dpp::snowflake channel_id, completion callback) override
+            {
+                bot.message_delete(message_id, channel_id, std::move(callback));
+            }
+
+            void message_delete_bulk(const std::vector<dpp::snowflake> &message_ids, dpp::snowflake channel_id, completion callback) override
+            {
+                bot.message_delete_bulk(message_ids, channel_id, std::move(callback));
+            }
+
+            void guild_get(dpp::snowflake guild_id, completion callback) override
+            {
+                bot.guild_get(guild_id, std::move(callback));
+            }
+
+            void channel_get(dpp::snowflake channel_id, completion callback) override
+            {
+                bot.channel_get(channel_id, std::move(callback));
+            }
+
+        private:
+            dpp::cluster &bot;
+        };
+    }
+
+    dpp::async<dpp::confirmation_callback_t> rest_api::co_messages_get(dpp::snowflake channel_id, dpp::snowflake around, dpp::snowflake before, dpp::snowflake after, uint64_t limit)
+    {
+        return dpp::async<dpp::confirmation_callback_t>{[=, this](auto &&cc)
+                                                        { messages_get(channel_id, around, before, after, limit, cc); }};
+    }
+
+    dpp::async<dpp::confirmation_callback_t> rest_api::co_message_delete(dpp::snowflake message_id, dpp::snowflake channel_id)
+    {
+        return dpp::async<dpp::confirmation_callback_t>{[=, this](auto &&cc)
+                                                        { message_delete(message_id, channel_id, cc); }};
+    }
+
+    dpp::async<dpp::confirmation_callback_t> rest_api::co_message_delete_bulk(const std::vector<dpp::snowflake> &message_ids, dpp::snowflake channel_id)
+    {
+        return dpp::async<dpp::confirmation_callback_t>{[&message_ids, channel_id, this](auto &&cc)
+                                                        { message_delete_bulk(message_ids, channel_id, cc); }};
+    }
+
+    dpp::async<dpp::confirmation_callback_t> rest_api::co_guild_get(dpp::snowflake guild_id)
+    {
+        return dpp::async<dpp::confirmation_callback_t>{[=, this](auto &&cc)
+                                                        { guild_get(guild_id, cc); }};
+    }
+
+    dpp::async<dpp::confirmation_callback_t> rest_api::co_channel_get(dpp::snowflake channel_id)
+    {
+        return dpp::async<dpp::confirmation_callback_t>{[=, this](auto &&cc)
+                                                        { channel_get(channel_id, cc); }};
+    }
+
+    std::shared_ptr<rest_api> rest_api::for_cluster(dpp::cluster &bot)
+    {
+        return std::make_shared<cluster_rest>(bot);
+    }
+} // namespace app
@@ -0,0 +1,44 @@
+#include "../include/update_sequencer.hpp"
+
+namespace app
+{
+    update_sequencer::ticket update_sequencer::arrive()
+    {
+        std::lock_guard guard(lock);
+        uint64_t number = ++next;
+        pending.insert(number);
+        return {number, std::shared_ptr<void>(this, [number](update_sequencer *sequencer)
+                                              {
+                                                  {
+                                                      std::lock_guard guard(sequencer->lock);
+                                                      sequencer->pending.erase(number);
+                                                  }
+                                                  sequencer->released.notify_all(); })};
+    }
+
+    bool update_sequencer::replace(const ticket &t, const std::function<void()> &publish)
+    {
+        std::lock_guard guard(lock);
+        if (t.number < published)
+        {
+            return false;
+        }
+        publish();
+        published = t.number;
+        return true;
+    }
+
+    bool update_sequencer::amend(const ticket &t, const std::function<void()> &apply)
+    {
+        std::unique_lock guard(lock);
+        released.wait(guard, [this, &t]
+                      { return pending.empty() || *pending.begin() >= t.number; });
+        if (t.number < published)
+        {
+            return false;
+        }
+        apply();
+        published = t.number;
+        return true;
+    }
+} // namespace app
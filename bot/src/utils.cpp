@@ -2,9 +2,14 @@
 #include <dpp/nlohmann/json.hpp>
 #include <map>
 #include <string>
+#include <string_view>
 #include <regex>
 #include <sstream>
 #include <algorithm>
+#include "../include/config_reader.hpp"
+#include "../include/log.hpp"
+#include "../include/key_values.hpp"
+#include "../include/placeholder_set.hpp"
 
 using namespace dpp;
 namespace app
@@ -62,64 +67,113 @@ namespace app
         return result;
     }
     // Forward declaration
-    void process_interaction_option(const slashcommand_t &event, const command_data_option &option, std::unordered_map<std::string, std::string> &kv);
+    void process_interaction_option(const slashcommand_t &event, const command_data_option &option, key_values &kv, const placeholder_set &wanted);
 
-    // Génère la map clé/valeur
-    std::unordered_map<std::string, std::string> generate_key_values(const slashcommand_t &event)
+    // Génère les valeurs des placeholders, limitées aux clés demandées
+    void generate_key_values(const slashcommand_t &event, key_values &kv, const placeholder_set &wanted, const guild *g, const channel *channel_ptr)
     {
-        std::unordered_map<std::string, std::string> key_values;
-        const guild *g = event.command.is_guild_interaction() ? &event.command.get_guild() : nullptr;
-        const channel *channel_ptr = event.command.is_guild_interaction() ? &event.command.get_channel() : nullptr;
+        if (wanted.empty())
+        {
+            return;
+        }
         const user &u = event.command.get_issuing_user();
-        key_values["commandName"] = event.command.get_command_name();
-        key_values["commandId"] = event.command.id.str();
-        key_values["commandType"] = std::to_string(event.command.type);
-        key_values["userName"] = u.username;
-        key_values["userId"] = u.id.str();
-        key_values["userAvatar"] = make_avatar_url(u);
-        key_values["guildName"] = g ? g->name : "DM";
-        key_values["channelName"] = channel_ptr ? channel_ptr->name : "DM";
-        key_values["channelId"] = channel_ptr ? channel_ptr->id.str() : "0";
-        key_values["channelType"] = channel_ptr ? std::to_string(channel_ptr->get_type()) : "0";
-        key_values["guildId"] = g ? g->id.str() : "0";
-        key_values["guildIcon"] = g ? make_guild_icon(*g) : "";
-        key_values["guildCount"] = g ? std::to_string(g->member_count) : "0";
-        key_values["guildOwner"] = g ? g->owner_id.str() : "0";
-        key_values["guildCreatedAt"] = g ? std::to_string(g->get_creation_time()) : "0";
-        key_values["guildBoostTier"] = g ? std::to_string(g->premium_tier) : "0";
-        key_values["guildBoostCount"] = g ? std::to_string(g->premium_subscription_count) : "0";
+        using k = builtin_key;
+        auto key = builtin_key_id;
+        if (wanted.wants(k::command_name))
+            kv.set(key(k::command_name), event.command.get_command_name());
+        if (wanted.wants(k::command_id))
+            kv.set_number(key(k::command_id), static_cast<uint64_t>(event.command.id));
+        if (wanted.wants(k::command_type))
+            kv.set_number(key(k::command_type), static_cast<int>(event.command.type));
+        if (wanted.wants(k::user_name))
+            kv.set(key(k::user_name), u.username);
+        if (wanted.wants(k::user_id))
+            kv.set_number(key(k::user_id), static_cast<uint64_t>(u.id));
+        if (wanted.wants(k::user_avatar))
+            kv.set(key(k::user_avatar), make_avatar_url(u));
+        if (wanted.wants(k::guild_name))
+            kv.set(key(k::guild_name), g ? std::string_view(g->name) : "DM");
+        if (wanted.wants(k::channel_name))
+            kv.set(key(k::channel_name), channel_ptr ? std::string_view(channel_ptr->name) : "DM");
+        if (wanted.wants(k::channel_id))
+            kv.set_number(key(k::channel_id), channel_ptr ? static_cast<uint64_t>(channel_ptr->id) : 0);
+        if (wanted.wants(k::channel_type))
+            kv.set_number(key(k::channel_type), channel_ptr ? static_cast<int>(channel_ptr->get_type()) : 0);
+        if (wanted.wants(k::guild_id))
+            kv.set_number(key(k::guild_id), g ? static_cast<uint64_t>(g->id) : 0);
+        if (wanted.wants(k::guild_icon))
+            kv.set(key(k::guild_icon), g ? make_guild_icon(*g) : "");
+        if (wanted.wants(k::guild_count))
+            kv.set_number(key(k::guild_count), g ? g->member_count : 0);
+        if (wanted.wants(k::guild_owner))
+            kv.set_number(key(k::guild_owner), g ? static_cast<uint64_t>(g->owner_id) : 0);
+        if (wanted.wants(k::guild_created_at))
+        {
+            if (g)
+                kv.set_number(key(k::guild_created_at), g->get_creation_time());
+            else
+                kv.set(key(k::guild_created_at), "0");
+        }
+        if (wanted.wants(k::guild_boost_tier))
+            kv.set_number(key(k::guild_boost_tier), g ? static_cast<int>(g->premium_tier) : 0);
+        if (wanted.wants(k::guild_boost_count))
+            kv.set_number(key(k::guild_boost_count), g ? g->premium_subscription_count : 0);
 
         // Options de commande
         for (const auto &option : event.command.get_command_interaction().options)
         {
-            process_interaction_option(event, option, key_values);
+            process_interaction_option(event, option, kv, wanted);
         }
-        return key_values;
+    }
+
+    void generate_key_values(const slashcommand_t &event, key_values &kv, const placeholder_set &wanted)
+    {
+        // Looked up without throwing: with a reduced cache policy the guild or channel may not be cached.
+        bool in_guild = event.command.is_guild_interaction();
+        generate_key_values(event, kv, wanted, in_guild ? find_guild(event.command.guild_id) : nullptr, in_guild ? find_channel(event.command.channel_id) : nullptr);
     }
 
     // Traite une option d'interaction récursivement
-    void process_interaction_option(const slashcommand_t &event, const command_data_option &option, std::unordered_map<std::string, std::string> &kv)
+    void process_interaction_option(const slashcommand_t &event, const command_data_option &option, key_values &kv, const placeholder_set &wanted)
     {
-        switch (option.type)
+        if (option.type == co_sub_command || option.type == co_sub_command_group)
         {
-        case co_sub_command:
-        case co_sub_command_group:
             for (const auto &subopt : option.options)
             {
-                process_interaction_option(event, subopt, kv);
+                process_interaction_option(event, subopt, kv, wanted);
             }
-            break;
+            return;
+        }
+        if (!wanted.wants_option(option.name))
+        {
+            return;
+        }
+
+        // Interned when the config loaded; fields nobody references are no_key and skipped.
+        const option_keys keys = wanted.keys_of(option.name);
+        using f = option_field;
+        auto key = [&keys](option_field field)
+        { return keys[static_cast<size_t>(field)]; };
+        auto want = [&](option_field field)
+        { return key(field) != no_key; };
+        auto flag = [](bool value)
+        { return value ? "true" : "false"; };
+
+        switch (option.type)
+        {
         case co_user:
         {
             snowflake user_id = std::get<snowflake>(option.value);
             auto user_ptr = event.command.get_resolved_user(user_id);
             const user &u = user_ptr;
-            kv["opts." + option.name] = u.username;
-            kv["opts." + option.name + ".id"] = u.id.str();
-            kv["opts." + option.name + ".avatar"] = make_avatar_url(u);
-            kv["opts." + option.name + ".discriminator"] = std::to_string(u.discriminator);
-            kv["opts." + option.name + ".bot"] = u.is_bot() ? "true" : "false";
-            kv["opts." + option.name + ".created_at"] = std::to_string(u.get_creation_time());
+            kv.set(key(f::value), u.username);
+            kv.set_number(key(f::id), static_cast<uint64_t>(u.id));
+            if (want(f::avatar))
+                kv.set(key(f::avatar), make_avatar_url(u));
+            kv.set_number(key(f::discriminator), u.discriminator);
+            kv.set(key(f::bot), flag(u.is_bot()));
+            if (want(f::created_at))
+                kv.set_number(key(f::created_at), u.get_creation_time());
         }
         break;
         case co_channel:
@@ -127,10 +181,12 @@ namespace app
             snowflake chan_id = std::get<snowflake>(option.value);
             auto chan_ptr = event.command.get_resolved_channel(chan_id);
             const channel &c = chan_ptr;
-            kv["opts." + option.name] = c.name;
-            kv["opts." + option.name + ".id"] = c.id.str();
-            kv["opts." + option.name + ".type"] = std::to_string(c.get_type());
-            kv["opts." + option.name + ".created_at"] = std::to_string(c.get_creation_time());
+            kv.set(key(f::value), c.name);
+            kv.set_number(key(f::id), static_cast<uint64_t>(c.id));
+            if (want(f::type))
+                kv.set_number(key(f::type), static_cast<int>(c.get_type()));
+            if (want(f::created_at))
+                kv.set_number(key(f::created_at), c.get_creation_time());
         }
         break;
         case co_role:
@@ -138,11 +194,11 @@ namespace app
             snowflake role_id = std::get<snowflake>(option.value);
             auto role_ptr = event.command.get_resolved_role(role_id);
             const role &r = role_ptr;
-            kv["opts." + option.name] = r.name;
-            kv["opts." + option.name + ".id"] = r.id.str();
-            kv["opts." + option.name + ".color"] = std::to_string(r.colour);
-            kv["opts." + option.name + ".hoist"] = r.is_hoisted() ? "true" : "false";
-            kv["opts." + option.name + ".position"] = std::to_string(r.position);
+            kv.set(key(f::value), r.name);
+            kv.set_number(key(f::id), static_cast<uint64_t>(r.id));
+            kv.set_number(key(f::color), r.colour);
+            kv.set(key(f::hoist), flag(r.is_hoisted()));
+            kv.set_number(key(f::position), r.position);
         }
         break;
         case co_mentionable:
@@ -150,51 +206,56 @@ namespace app
             snowflake mentionable_id = std::get<snowflake>(option.value);
             auto member_ptr = event.command.get_resolved_member(mentionable_id);
             const user &u = *member_ptr.get_user();
-            kv["opts." + option.name] = u.username;
-            kv["opts." + option.name + ".id"] = u.id.str();
-            kv["opts." + option.name + ".avatar"] = make_avatar_url(u);
-            kv["opts." + option.name + ".discriminator"] = std::to_string(u.discriminator);
-            kv["opts." + option.name + ".bot"] = u.is_bot() ? "true" : "false";
-            kv["opts." + option.name + ".created_at"] = std::to_string(u.get_creation_time());
-            kv["opts." + option.name + ".nick"] = member_ptr.get_nickname();
-            kv["opts." + option.name + ".joined_at"] = std::to_string(member_ptr.joined_at);
+            kv.set(key(f::value), u.username);
+            kv.set_number(key(f::id), static_cast<uint64_t>(u.id));
+            if (want(f::avatar))
+                kv.set(key(f::avatar), make_avatar_url(u));
+            kv.set_number(key(f::discriminator), u.discriminator);
+            kv.set(key(f::bot), flag(u.is_bot()));
+            if (want(f::created_at))
+                kv.set_number(key(f::created_at), u.get_creation_time());
+            if (want(f::nick))
+                kv.set(key(f::nick), member_ptr.get_nickname());
+            kv.set_number(key(f::joined_at), member_ptr.joined_at);
         }
         break;
         case co_string:
-            kv["opts." + option.name] = std::get<std::string>(option.value);
+            kv.set(key(f::value), std::get<std::string>(option.value));
             break;
         case co_integer:
-            kv["opts." + option.name] = std::to_string(std::get<int64_t>(option.value));
+            kv.set_number(key(f::value), std::get<int64_t>(option.value));
             break;
         case co_boolean:
-            kv["opts." + option.name] = std::get<bool>(option.value) ? "true" : "false";
+            kv.set(key(f::value), flag(std::get<bool>(option.value)));
             break;
         case co_number:
-            kv["opts." + option.name] = std::to_string(std::get<double>(option.value));
+            kv.set_number(key(f::value), std::get<double>(option.value));
             break;
         case co_attachment:
         {
             snowflake attachment_id = std::get<snowflake>(option.value);
             auto att_ptr = event.command.get_resolved_attachment(attachment_id);
-            kv["opts." + option.name] = att_ptr.url;
-            kv["opts." + option.name + ".id"] = att_ptr.id.str();
-            kv["opts." + option.name + ".filename"] = att_ptr.filename;
-            kv["opts." + option.name + ".size"] = std::to_string(att_ptr.size);
+            kv.set(key(f::value), att_ptr.url);
+            kv.set_number(key(f::id), static_cast<uint64_t>(att_ptr.id));
+            kv.set(key(f::filename), att_ptr.filename);
+            kv.set_number(key(f::size), att_ptr.size);
         }
         break;
+        default:
+            break;
         }
     }
 
-    nlohmann::json json_from_string(const std::string &str)
+    nlohmann::json json_from_string(std::string_view str)
     {
         nlohmann::json j;
         try
         {
-            j = nlohmann::json::parse(str);
+            j = parse_json(str);
         }
         catch (const nlohmann::json::parse_error &e)
         {
-            std::cerr << "JSON parse error: " << e.what() << std::endl;
+            log::error({}, std::string("JSON parse error: ") + e.what());
         }
         return j;
     }
@@ -208,7 +269,7 @@ namespace app
         }
         catch (const nlohmann::json::exception &e)
         {
-            std::cerr << "JSON exception: " << e.what() << std::endl;
+            log::error({}, std::string("JSON exception: ") + e.what());
         }
         return str;
     }
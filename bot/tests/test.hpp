@@ -0,0 +1,76 @@
+// test.hpp
+// A small self-registering test harness for bot-tests.
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace test
+{
+    /**
+     * @brief A failed check; thrown so the rest of the test is skipped
+     */
+    struct failure : std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * @brief Adds a test to the global registry; used through static registrar objects
+     */
+    struct registrar
+    {
+        registrar(std::string name, std::function<void()> body);
+    };
+
+    /**
+     * @brief Runs every registered test whose name contains filter, in name order
+     *
+     * @return The number of tests that failed
+     */
+    int run_all(const std::string &filter);
+
+    [[noreturn]] void fail(const std::string &message, const char *file, int line);
+
+    template <typename A, typename B>
+    void check_equal(const A &actual, const B &expected, const char *expression, const char *file, int line)
+    {
+        if (!(actual == expected))
+        {
+            std::ostringstream out;
+            out << expression << ": got " << actual << ", expected " << expected;
+            fail(out.str(), file, line);
+        }
+    }
+}
+
+#define CHECK(expression)                                                      \
+    do                                                                         \
+    {                                                                          \
+        if (!(expression))                                                     \
+        {                                                                      \
+            ::test::fail("CHECK(" #expression ") failed", __FILE__, __LINE__); \
+        }                                                                      \
+    } while (false)
+
+#define CHECK_EQ(actual, expected) ::test::check_equal((actual), (expected), #actual, __FILE__, __LINE__)
+
+#define CHECK_THROWS(expression, exception_type)                                               \
+    do                                                                                         \
+    {                                                                                          \
+        bool thrown = false;                                                                   \
+        try                                                                                    \
+        {                                                                                      \
+            (void)(expression);                                                                \
+        }                                                                                      \
+        catch (const exception_type &)                                                         \
+        {                                                                                      \
+            thrown = true;                                                                     \
+        }                                                                                      \
+        if (!thrown)                                                                           \
+        {                                                                                      \
+            ::test::fail(#expression " did not throw " #exception_type, __FILE__, __LINE__);   \
+        }                                                                                      \
+    } while (false)
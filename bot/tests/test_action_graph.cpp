@@ -0,0 +1,41 @@
+// test_action_graph.cpp
+// app::action_graph: levels, per-type settings and output keys resolved at compile time.
+#include <string>
+#include "test.hpp"
+#include "../include/action_graph.hpp"
+#include "../include/actions/delete.hpp"
+
+namespace
+{
+    const test::registrar levels("action_graph/levels_follow_after", []
+                                 {
+        auto graph = app::action_graph::compile(nlohmann::json::parse(R"([
+            {"id": "a", "type": "x"},
+            {"id": "b", "type": "x", "after": "a"},
+            {"id": "c", "type": "x", "after": ["a", "b"]},
+            {"id": "d", "type": "x"}
+        ])"));
+        CHECK_EQ(graph.levels().size(), size_t(3));
+        CHECK_EQ(graph.levels()[0].size(), size_t(2));
+        CHECK_THROWS(app::action_graph::compile(nlohmann::json::parse(R"([{"id": "a", "after": "b"}, {"id": "b", "after": "a"}])")), std::invalid_argument); });
+
+    const test::registrar outputs("action_graph/output_keys_interned_at_compile", []
+                                  {
+        auto graph = app::action_graph::compile(nlohmann::json::parse(R"([{"id": "purge", "type": "delete_messages"}, {"id": "other", "type": "unknown"}])"));
+        const auto &purge = graph.nodes()[0];
+        CHECK(purge.settings);
+        CHECK_EQ(purge.output_keys.size(), size_t(1));
+        CHECK_EQ(purge.output_keys[0].first, std::string("deleted"));
+        CHECK_EQ(purge.output_keys[0].second, app::find_key("action.purge.deleted"));
+        CHECK(!graph.nodes()[1].settings);
+        CHECK(graph.nodes()[1].output_keys.empty()); });
+
+    const test::registrar delete_settings("action_graph/delete_settings_checked_at_compile", []
+                                          {
+        auto graph = app::action_graph::compile(nlohmann::json::parse(R"json([{"type": "delete_messages", "max_amount": 50000, "progress": "((deleted))/((amount))"}])json"));
+        const auto &settings = static_cast<const ::delete_settings &>(*graph.nodes()[0].settings);
+        CHECK_EQ(settings.max_amount, uint64_t(10000));
+        CHECK_EQ(settings.progress.keys().size(), size_t(2));
+        CHECK_THROWS(app::action_graph::compile(nlohmann::json::parse(R"([{"type": "delete_messages", "max_amount": "5"}])")), std::invalid_argument);
+        CHECK_THROWS(app::action_graph::compile(nlohmann::json::parse(R"([{"type": "delete_messages", "error": 3}])")), std::invalid_argument); });
+}
@@ -0,0 +1,72 @@
+// test_admission_control.cpp
+// app::admission_policy parsing and the token buckets of app::admission_control.
+#include <string>
+#include "test.hpp"
+#include "../include/admission_control.hpp"
+
+namespace
+{
+    app::admission_policy policy(const char *json)
+    {
+        auto parsed = app::admission_policy::from_json(nlohmann::json::parse(json));
+        CHECK(parsed);
+        return *parsed;
+    }
+
+    const test::registrar parse("admission_control/policy_from_json", []
+                                {
+        auto p = policy(R"({"user": {"count": 2, "per": 10}, "message": "wait ((retryAfter))s"})");
+        CHECK_EQ(p.user.count, 2u);
+        CHECK_EQ(p.user.per_seconds, 10.0);
+        CHECK(!p.guild.enabled());
+        CHECK_EQ(p.message.source(), std::string("wait ((retryAfter))s"));
+        CHECK(!app::admission_policy::from_json(nlohmann::json::object()));
+        CHECK(!app::admission_policy::from_json(nlohmann::json("not an object"))); });
+
+    const test::registrar malformed("admission_control/rejects_malformed_limits", []
+                                    {
+        using app::admission_policy;
+        CHECK_THROWS(admission_policy::from_json(nlohmann::json::parse(R"({"user": {"count": 0, "per": 10}})")), std::invalid_argument);
+        CHECK_THROWS(admission_policy::from_json(nlohmann::json::parse(R"({"user": {"count": -1, "per": 10}})")), std::invalid_argument);
+        CHECK_THROWS(admission_policy::from_json(nlohmann::json::parse(R"({"user": {"count": 5000000000, "per": 10}})")), std::invalid_argument);
+        CHECK_THROWS(admission_policy::from_json(nlohmann::json::parse(R"({"user": {"count": 1}})")), std::invalid_argument);
+        CHECK_THROWS(admission_policy::from_json(nlohmann::json::parse(R"({"guild": {"count": 1, "per": 0}})")), std::invalid_argument);
+        CHECK_THROWS(admission_policy::from_json(nlohmann::json::parse(R"({"command": 3})")), std::invalid_argument); });
+
+    const test::registrar user_bucket("admission_control/user_bucket_empties_and_reports_retry", []
+                                      {
+        app::admission_control admission;
+        auto p = policy(R"({"user": {"count": 2, "per": 10}})");
+        CHECK(admission.admit("ping", p, 1, 100).admitted);
+        CHECK(admission.admit("ping", p, 1, 100).admitted);
+        auto refused = admission.admit("ping", p, 1, 100);
+        CHECK(!refused.admitted);
+        // One token every 5 seconds.
+        CHECK(refused.retry_after > 4.9 && refused.retry_after <= 5.0);
+        // Other users and other commands have their own buckets.
+        CHECK(admission.admit("ping", p, 2, 100).admitted);
+        CHECK(admission.admit("pong", p, 1, 100).admitted); });
+
+    const test::registrar guild_bucket("admission_control/guild_bucket_is_shared_by_members", []
+                                       {
+        app::admission_control admission;
+        auto p = policy(R"({"guild": {"count": 2, "per": 60}})");
+        CHECK(admission.admit("ping", p, 1, 100).admitted);
+        CHECK(admission.admit("ping", p, 2, 100).admitted);
+        CHECK(!admission.admit("ping", p, 3, 100).admitted);
+        CHECK(admission.admit("ping", p, 3, 200).admitted);
+        // DMs have no guild and are never limited by it.
+        CHECK(admission.admit("ping", p, 3, 0).admitted);
+        CHECK(admission.admit("ping", p, 3, 0).admitted);
+        CHECK(admission.admit("ping", p, 3, 0).admitted); });
+
+    const test::registrar give_back("admission_control/refusal_takes_nothing", []
+                                    {
+        app::admission_control admission;
+        auto p = policy(R"({"user": {"count": 1, "per": 60}, "guild": {"count": 1, "per": 60}})");
+        CHECK(admission.admit("ping", p, 1, 100).admitted);
+        // Refused by the guild: user 2's own token is given back...
+        CHECK(!admission.admit("ping", p, 2, 100).admitted);
+        // ...so it is still there in another guild.
+        CHECK(admission.admit("ping", p, 2, 200).admitted); });
+}
@@ -0,0 +1,101 @@
+// test_choice_index.cpp
+// app::choice_index: prefix lookups, ordering and the limits checked when a choice list compiles.
+#include <string>
+#include <vector>
+#include "test.hpp"
+#include "../include/choice_index.hpp"
+#include "../include/command_table.hpp"
+
+namespace
+{
+    // The names of the matches, comma separated.
+    std::string names(const std::vector<const dpp::command_option_choice *> &matches)
+    {
+        std::string out;
+        for (const auto *choice : matches)
+        {
+            out += (out.empty() ? "" : ",") + choice->name;
+        }
+        return out;
+    }
+
+    std::string repeated(const std::string &text, size_t count)
+    {
+        std::string out;
+        for (size_t i = 0; i < count; ++i)
+        {
+            out += text;
+        }
+        return out;
+    }
+
+    const test::registrar prefix("choice_index/prefix_ignores_ascii_case", []
+                                 {
+        auto index = app::choice_index::from_json(nlohmann::json::parse(R"(["Paris", "parma", "Berlin", "PARAGUAY", "Pa", "Bern"])"));
+        CHECK_EQ(names(index.complete("par")), std::string("PARAGUAY,Paris,parma"));
+        CHECK_EQ(names(index.complete("  BER")), std::string("Berlin,Bern"));
+        CHECK_EQ(names(index.complete("pa", 2)), std::string("Pa,PARAGUAY"));
+        CHECK(index.complete("parisx").empty());
+        CHECK(index.complete("z").empty()); });
+
+    const test::registrar empty_typed("choice_index/nothing_typed_keeps_config_order", []
+                                      {
+        auto index = app::choice_index::from_json(nlohmann::json::parse(R"(["b", "a", "c"])"));
+        CHECK_EQ(names(index.complete("")), std::string("b,a,c"));
+        CHECK_EQ(names(index.complete("   ", 1)), std::string("b")); });
+
+    const test::registrar limit("choice_index/at_most_25_matches", []
+                                {
+        nlohmann::json choices = nlohmann::json::array();
+        for (int i = 0; i < 40; ++i)
+        {
+            choices.push_back("item " + std::to_string(100 + i));
+        }
+        auto index = app::choice_index::from_json(choices);
+        auto matches = index.complete("item");
+        CHECK_EQ(matches.size(), app::choice_index::max_choices);
+        CHECK_EQ(matches.front()->name, std::string("item 100"));
+        CHECK_EQ(index.complete("item 13").size(), size_t(10)); });
+
+    const test::registrar values("choice_index/objects_and_numbers", []
+                                 {
+        auto index = app::choice_index::from_json(nlohmann::json::parse(R"([{"name": "Paris", "value": "fr-par"}, 42, {"name": "Pi", "value": 3.5}])"));
+        auto paris = index.complete("paris");
+        CHECK_EQ(paris.size(), size_t(1));
+        CHECK_EQ(std::get<std::string>(paris[0]->value), std::string("fr-par"));
+        CHECK_EQ(std::get<int64_t>(index.complete("4")[0]->value), int64_t(42));
+        CHECK_EQ(std::get<double>(index.complete("pi")[0]->value), 3.5); });
+
+    const test::registrar malformed("choice_index/rejects_malformed_choices", []
+                                    {
+        using app::choice_index;
+        CHECK_THROWS(choice_index::from_json(nlohmann::json::object()), std::invalid_argument);
+        CHECK_THROWS(choice_index::from_json(nlohmann::json::parse(R"([true])")), std::invalid_argument);
+        CHECK_THROWS(choice_index::from_json(nlohmann::json::parse(R"([""])")), std::invalid_argument);
+        CHECK_THROWS(choice_index::from_json(nlohmann::json::parse(R"([{"name": "a"}])")), std::invalid_argument);
+        CHECK_THROWS(choice_index::from_json(nlohmann::json::parse(R"([{"name": 1, "value": 1}])")), std::invalid_argument); });
+
+    const test::registrar length("choice_index/limit_counts_code_points", []
+                                 {
+        using app::choice_index;
+        // 100 characters of 2, 3 and 4 bytes each are within the limit...
+        for (const char *character : {"\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80"})
+        {
+            std::string name = repeated(character, 100);
+            auto index = choice_index::from_json(nlohmann::json::array({name, {{"name", "x"}, {"value", name}}}));
+            CHECK_EQ(index.size(), size_t(2));
+            CHECK_EQ(index.complete(character).size(), size_t(1));
+            // ...101 are not.
+            CHECK_THROWS(choice_index::from_json(nlohmann::json::array({name + character})), std::invalid_argument);
+            CHECK_THROWS(choice_index::from_json(nlohmann::json::array({{{"name", "x"}, {"value", name + character}}})), std::invalid_argument);
+        }
+        CHECK_THROWS(choice_index::from_json(nlohmann::json::array({std::string(101, 'a')})), std::invalid_argument); });
+
+    const test::registrar in_table("choice_index/autocomplete_must_be_an_object", []
+                                   {
+        auto table = app::command_table::build(nlohmann::json::parse(R"({"city": {"autocomplete": {"name": ["Paris", "Berlin"]}}, "none": {"autocomplete": null}})"));
+        CHECK_EQ(table->find("city")->autocomplete.at("name").size(), size_t(2));
+        CHECK(table->find("none")->autocomplete.empty());
+        CHECK_THROWS(app::command_table::build(nlohmann::json::parse(R"({"city": {"autocomplete": ["Paris"]}})")), std::invalid_argument);
+        CHECK_THROWS(app::command_table::build(nlohmann::json::parse(R"({"city": {"autocomplete": "Paris"}})")), std::invalid_argument); });
+}
@@ -0,0 +1,94 @@
+// test_command_table.cpp
+// app::command_table::patch: merge-patch, upsert and delete, and sharing of untouched entries.
+#include <string>
+#include "test.hpp"
+#include "../include/command_table.hpp"
+
+namespace
+{
+    std::shared_ptr<const app::command_table> base_table()
+    {
+        return app::command_table::build(nlohmann::json::parse(R"json({
+            "ping": {"response": "pong", "rate_limit": {"user": {"count": 2, "per": 10}}},
+            "hello": {"response": "Hi ((userName))"},
+            "bye": {"response": "Bye"}
+        })json"));
+    }
+
+    std::string response_of(const app::command_table &table, const std::string &name)
+    {
+        const app::command_entry *entry = table.find(name);
+        CHECK(entry);
+        CHECK(entry->response);
+        return entry->response->source();
+    }
+
+    const test::registrar merge("command_table/patch_merges_into_command", []
+                                {
+        auto table = base_table();
+        auto patched = table->patch(nlohmann::json::parse(R"({"data": {"ping": {"response": "pong!"}}})"));
+        CHECK_EQ(response_of(*patched, "ping"), std::string("pong!"));
+        // Fields the patch doesn't name are kept.
+        CHECK(patched->find("ping")->admission);
+        CHECK_EQ(patched->find("ping")->source["rate_limit"]["user"]["count"].get<int>(), 2);
+        // The original table is left untouched.
+        CHECK_EQ(response_of(*table, "ping"), std::string("pong")); });
+
+    const test::registrar null_field("command_table/patch_null_removes_field", []
+                                     {
+        auto patched = base_table()->patch(nlohmann::json::parse(R"({"data": {"ping": {"rate_limit": null}}})"));
+        CHECK(!patched->find("ping")->admission);
+        CHECK(!patched->find("ping")->source.contains("rate_limit"));
+        CHECK_EQ(response_of(*patched, "ping"), std::string("pong")); });
+
+    const test::registrar null_command("command_table/patch_null_removes_command", []
+                                       {
+        auto patched = base_table()->patch(nlohmann::json::parse(R"({"data": {"bye": null}})"));
+        CHECK(!patched->find("bye"));
+        CHECK_EQ(patched->size(), size_t(2)); });
+
+    const test::registrar new_command("command_table/patch_adds_new_command", []
+                                      {
+        auto patched = base_table()->patch(nlohmann::json::parse(R"({"data": {"new": {"response": "fresh"}}})"));
+        CHECK_EQ(response_of(*patched, "new"), std::string("fresh"));
+        CHECK_EQ(patched->size(), size_t(4)); });
+
+    const test::registrar upsert("command_table/upsert_replaces_whole", []
+                                 {
+        auto patched = base_table()->patch(nlohmann::json::parse(R"({"upsert": {"ping": {"response": "replaced"}}})"));
+        CHECK_EQ(response_of(*patched, "ping"), std::string("replaced"));
+        // Unlike a merge, nothing of the old config survives.
+        CHECK(!patched->find("ping")->admission); });
+
+    const test::registrar order("command_table/patch_applies_data_upsert_delete_in_order", []
+                                {
+        auto patched = base_table()->patch(nlohmann::json::parse(R"({
+            "data": {"hello": {"response": "merged"}},
+            "upsert": {"hello": {"response": "upserted"}},
+            "delete": ["bye", "unknown", 3]
+        })"));
+        CHECK_EQ(response_of(*patched, "hello"), std::string("upserted"));
+        CHECK(!patched->find("bye"));
+        CHECK_EQ(patched->size(), size_t(2)); });
+
+    const test::registrar shared("command_table/patch_shares_untouched_entries", []
+                                 {
+        auto table = base_table();
+        auto patched = table->patch(nlohmann::json::parse(R"({"data": {"ping": {"response": "pong!"}}})"));
+        CHECK(patched->find("hello") == table->find("hello"));
+        CHECK(patched->find("ping") != table->find("ping")); });
+
+    const test::registrar non_object("command_table/patch_rejects_non_object_data", []
+                                     {
+        auto table = base_table();
+        CHECK_THROWS(table->patch(nlohmann::json::parse(R"({"data": []})")), std::invalid_argument);
+        // Neither wipes the table nor skips what comes with it.
+        CHECK_THROWS(table->patch(nlohmann::json::parse(R"({"data": null, "delete": ["bye"]})")), std::invalid_argument);
+        CHECK_EQ(table->size(), size_t(3)); });
+
+    const test::registrar invalid("command_table/patch_rejects_invalid_command", []
+                                  {
+        auto table = base_table();
+        CHECK_THROWS(table->patch(nlohmann::json::parse(R"({"data": {"ping": {"actions": [{"id": "a", "after": "b"}]}}})")), std::invalid_argument);
+        CHECK_EQ(response_of(*table, "ping"), std::string("pong")); });
+}
@@ -0,0 +1,96 @@
+// test_config_reader.cpp
+// app::parse_json against nlohmann::json::parse, and peeking and streaming webhook bodies.
+#include <string>
+#include <vector>
+#include "test.hpp"
+#include "../include/config_reader.hpp"
+
+namespace
+{
+    // The reader must build exactly the value nlohmann would, types included (42 vs 42.0, -1 vs 2^64-1).
+    void check_same(const std::string &text)
+    {
+        nlohmann::json expected = nlohmann::json::parse(text);
+        nlohmann::json actual = app::parse_json(text);
+        CHECK(actual == expected);
+        CHECK_EQ(actual.dump(), expected.dump());
+    }
+
+    const test::registrar scalars("config_reader/scalars_match_nlohmann", []
+                                  {
+        for (const char *text : {"null", "true", "false", "0", "-0", "42", "-42", "18446744073709551615", "-9223372036854775808",
+                                 "1.5", "-0.25", "1e3", "1E-3", "6.02214076e23", "123456789012345678901234567890", " \t\n\r 7 \n"})
+        {
+            check_same(text);
+        } });
+
+    const test::registrar strings("config_reader/strings_match_nlohmann", []
+                                  {
+        check_same(R"("")");
+        check_same(R"("plain")");
+        check_same(R"("\"\\\/\b\f\n\r\t")");
+        check_same(R"("é中😀")");
+        check_same("\"caf\xc3\xa9 \xf0\x9f\x98\x80\"");
+        // Escapes on either side of the 16-byte blocks the reader scans, and runs longer than one block.
+        std::string long_text(40, 'a');
+        for (size_t at : {0, 1, 14, 15, 16, 17, 31, 32, 39})
+        {
+            std::string text = long_text;
+            text.replace(at, 1, "\\n");
+            check_same('"' + text + '"');
+        } });
+
+    const test::registrar structures("config_reader/structures_match_nlohmann", []
+                                     {
+        check_same("[]");
+        check_same("{}");
+        check_same(R"([1, [2, [3, {"a": [4, {}]}]], "x"])");
+        check_same(R"json({"b": 1, "a": {"c": [true, null], "d": "((userName))"}, "": 0})json");
+        // A repeated key keeps its last value, as in nlohmann.
+        check_same(R"({"a": 1, "b": 2, "a": 3})");
+        // Deeper than the reader goes: nlohmann takes over and still parses it.
+        check_same(std::string(300, '[') + std::string(300, ']')); });
+
+    const test::registrar invalid("config_reader/invalid_json_throws_parse_error", []
+                                  {
+        for (const char *text : {"", "{", "[1,]", R"({"a" 1})", R"({"a": 1,})", "tru", "01", "1.", "-", R"("\x")", R"("\ud83d")", "\"open", "[1] 2"})
+        {
+            CHECK_THROWS(app::parse_json(text), nlohmann::json::parse_error);
+        } });
+
+    const test::registrar peek("config_reader/peek_command", []
+                               {
+        CHECK_EQ(app::peek_command(R"({"command": "update", "data": {}})"), std::string("update"));
+        CHECK_EQ(app::peek_command(R"({"data": {"command": "nested", "x": [1, {"y": "z"}]}, "command": "patch"})"), std::string("patch"));
+        CHECK_EQ(app::peek_command(R"({"data": {}})"), std::string());
+        CHECK_EQ(app::peek_command(R"({"command": 3})"), std::string());
+        CHECK_EQ(app::peek_command("not json"), std::string()); });
+
+    const test::registrar update("config_reader/update_streams_into_table", []
+                                 {
+        auto body = app::read_command_body(R"({"command": "update", "data": {"ping": {"response": "pong"}, "hello": {"response": "Hi"}}, "extra": 1})", "update");
+        CHECK(body.table);
+        CHECK_EQ(body.table->size(), size_t(2));
+        CHECK(body.table->find("ping"));
+        CHECK(!body.envelope.contains("data"));
+        CHECK_EQ(body.envelope["extra"].get<int>(), 1);
+        // A `data` that isn't an object is no commands.
+        auto empty = app::read_command_body(R"({"command": "update", "data": []})", "update");
+        CHECK(empty.table);
+        CHECK_EQ(empty.table->size(), size_t(0));
+        CHECK_THROWS(app::read_command_body(R"({"command": "update", "data": {"bad": {"actions": [{"id": "a", "after": "a"}]}}})", "update"), std::invalid_argument); });
+
+    const test::registrar other("config_reader/other_bodies_come_back_whole", []
+                                {
+        auto patch = app::read_command_body(R"({"command": "patch", "data": {"ping": null}})", "patch");
+        CHECK(!patch.table);
+        CHECK(patch.envelope["data"].contains("ping"));
+        // Valid JSON the reader rejects is parsed by nlohmann instead, without a table.
+        std::string deep = R"({"command": "update", "data": {}, "deep": )" + std::string(300, '[') + std::string(300, ']') + "}";
+        auto fallback = app::read_command_body(deep, "update");
+        CHECK(!fallback.table);
+        CHECK(fallback.envelope.contains("data"));
+        auto broken = app::read_command_body(R"({"command": "update", "data": {)", "update");
+        CHECK(!broken.table);
+        CHECK(broken.envelope.is_null()); });
+}
@@ -0,0 +1,139 @@
+// test_http_request_parser.cpp
+// HttpRequestParser: incremental parsing, chunked bodies and the header and body limits.
+#include <string>
+#include "test.hpp"
+#include "../include/http_request_parser.hpp"
+
+namespace
+{
+    using Status = HttpRequestParser::Status;
+
+    // Feeds the request one byte at a time, as a slow client would.
+    Status feed_bytewise(HttpRequestParser &parser, std::string &buffer, size_t &fed)
+    {
+        Status status = Status::Incomplete;
+        while (status == Status::Incomplete && fed < buffer.size())
+        {
+            ++fed;
+            status = parser.parse(buffer.data(), fed);
+        }
+        return status;
+    }
+
+    const test::registrar content_length("http_request_parser/content_length", []
+                                         {
+        std::string raw = "POST /bots/x HTTP/1.1\r\nHost: a\r\ncontent-length: 5\r\n\r\nhello";
+        HttpRequestParser parser;
+        size_t fed = 0;
+        CHECK(feed_bytewise(parser, raw, fed) == Status::Complete);
+        CHECK_EQ(fed, raw.size());
+        const HttpRequest &req = parser.request();
+        CHECK_EQ(req.method, std::string_view("POST"));
+        CHECK_EQ(req.path, std::string_view("/bots/x"));
+        CHECK_EQ(req.header("Content-Length"), std::string_view("5"));
+        CHECK_EQ(req.body, std::string_view("hello"));
+        CHECK_EQ(parser.consumed(), raw.size()); });
+
+    const test::registrar chunked("http_request_parser/chunked_decoded_in_place", []
+                                  {
+        std::string raw = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+        HttpRequestParser parser;
+        size_t fed = 0;
+        CHECK(feed_bytewise(parser, raw, fed) == Status::Complete);
+        CHECK_EQ(parser.request().body, std::string_view("hello world")); });
+
+    const test::registrar pipelined("http_request_parser/pipelined", []
+                                    {
+        std::string raw = "GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\n";
+        HttpRequestParser parser;
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Complete);
+        CHECK_EQ(parser.request().path, std::string_view("/a"));
+        size_t consumed = parser.consumed();
+        parser.reset();
+        CHECK(parser.parse(raw.data() + consumed, raw.size() - consumed) == Status::Complete);
+        CHECK_EQ(parser.request().path, std::string_view("/b")); });
+
+    const test::registrar header_limit("http_request_parser/header_limit", []
+                                       {
+        HttpRequestParser parser(1024, 64);
+        std::string raw = "GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a');
+        // Rejected before the header block is even complete.
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Error);
+        CHECK_EQ(parser.errorStatus(), 431);
+        // And stays rejected.
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Error); });
+
+    const test::registrar body_limit("http_request_parser/body_limit", []
+                                     {
+        HttpRequestParser parser(16, 1024);
+        std::string raw = "POST / HTTP/1.1\r\nContent-Length: 17\r\n\r\n";
+        // Known from the headers alone, before any body byte arrives.
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Error);
+        CHECK_EQ(parser.errorStatus(), 413);
+
+        HttpRequestParser chunked(16, 1024);
+        std::string stream = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n8\r\n12345678\r\n9\r\n";
+        CHECK(chunked.parse(stream.data(), stream.size()) == Status::Error);
+        CHECK_EQ(chunked.errorStatus(), 413); });
+
+    const test::registrar trailer_limit("http_request_parser/chunked_trailer_limit", []
+                                        {
+        // Every trailer line is short; together they are far past the 1 KB header limit.
+        HttpRequestParser parser(1024, 1024);
+        std::string raw = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\na\r\n0\r\n";
+        for (int i = 0; i < 100; ++i)
+        {
+            raw += "X-Trailer: " + std::to_string(i) + "\r\n";
+        }
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Error);
+        CHECK_EQ(parser.errorStatus(), 431);
+
+        // Within the limit, trailers are accepted and skipped.
+        HttpRequestParser small(1024, 1024);
+        std::string ok = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\na\r\n0\r\nX-Trailer: 1\r\n\r\n";
+        CHECK(small.parse(ok.data(), ok.size()) == Status::Complete);
+        CHECK_EQ(small.request().body, std::string_view("a")); });
+
+    const test::registrar chunk_stream_limit("http_request_parser/chunked_stream_limit", []
+                                             {
+        // 1000 one-byte chunks stay under the 1 KB body limit, but their extensions make ~1 MB of framing.
+        HttpRequestParser parser(1024, 1024);
+        std::string raw = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+        for (int i = 0; i < 1000; ++i)
+        {
+            raw += "1;ext=" + std::string(994, 'e') + "\r\na\r\n";
+        }
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Error);
+        CHECK_EQ(parser.errorStatus(), 413); });
+
+    const test::registrar malformed("http_request_parser/malformed", []
+                                    {
+        for (std::string raw : {std::string("GARBAGE\r\n\r\n"), std::string("GET / HTTP/1.1\r\nBad Header: x\r\n\r\n"),
+                                std::string("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n"), std::string("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n")})
+        {
+            HttpRequestParser parser;
+            CHECK(parser.parse(raw.data(), raw.size()) == Status::Error);
+            CHECK(parser.errorStatus() == 400 || parser.errorStatus() == 501);
+        } });
+
+    const test::registrar expected_size("http_request_parser/expected_size", []
+                                        {
+        HttpRequestParser parser;
+        std::string raw = "POST / HTTP/1.1\r\nContent-Length: 1000\r\n\r\nab";
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Incomplete);
+        CHECK_EQ(parser.expectedSize(), raw.size() - 2 + 1000); });
+
+    const test::registrar connection_tokens("http_request_parser/connection_tokens", []
+                                            {
+        std::string raw = "GET / HTTP/1.1\r\nConnection: keep-alive, Upgrade\r\nconnection:  CLOSE \r\nUpgrade: h2c\r\n\r\n";
+        HttpRequestParser parser;
+        CHECK(parser.parse(raw.data(), raw.size()) == Status::Complete);
+        const HttpRequest &req = parser.request();
+        CHECK(req.headerHasToken("Connection", "keep-alive"));
+        CHECK(req.headerHasToken("connection", "upgrade"));
+        // From the second field line, whatever its case.
+        CHECK(req.headerHasToken("Connection", "close"));
+        CHECK(!req.headerHasToken("Connection", "keep"));
+        CHECK(!req.headerHasToken("Connection", "h2c"));
+        CHECK(!req.headerHasToken("Missing", "close")); });
+}
@@ -0,0 +1,61 @@
+// test_main.cpp
+// Runner for bot-tests: runs every registered test and reports the failures.
+//
+// Usage: bot-tests [<substring>]
+// Exits non-zero when a test fails, so ctest reports it.
+#include <iostream>
+#include <map>
+#include "test.hpp"
+
+namespace test
+{
+    namespace
+    {
+        std::map<std::string, std::function<void()>> &registry()
+        {
+            static std::map<std::string, std::function<void()>> tests;
+            return tests;
+        }
+    }
+
+    registrar::registrar(std::string name, std::function<void()> body)
+    {
+        registry().emplace(std::move(name), std::move(body));
+    }
+
+    void fail(const std::string &message, const char *file, int line)
+    {
+        throw failure(std::string(file) + ":" + std::to_string(line) + ": " + message);
+    }
+
+    int run_all(const std::string &filter)
+    {
+        int failed = 0;
+        int ran = 0;
+        for (const auto &[name, body] : registry())
+        {
+            if (name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+            ++ran;
+            try
+            {
+                body();
+                std::cout << "ok    " << name << "\n";
+            }
+            catch (const std::exception &e)
+            {
+                ++failed;
+                std::cout << "FAIL  " << name << "\n      " << e.what() << "\n";
+            }
+        }
+        std::cout << ran - failed << " of " << ran << " tests passed\n";
+        return failed;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    return test::run_all(argc > 1 ? argv[1] : "") == 0 ? 0 : 1;
+}
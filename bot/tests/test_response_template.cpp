@@ -0,0 +1,64 @@
+// test_response_template.cpp
+// app::response_template against app::update_string, the regex renderer it replaced.
+#include <string>
+#include <unordered_map>
+#include "test.hpp"
+#include "../include/response_template.hpp"
+#include "../include/utils.hpp"
+
+namespace
+{
+    std::string render(const std::string &source, const std::unordered_map<std::string, std::string> &values)
+    {
+        app::key_values kv;
+        for (const auto &[key, value] : values)
+        {
+            kv.set(app::intern_key(key), value);
+        }
+        return app::response_template(source).render(kv);
+    }
+
+    // Both renderers must agree on every input; the template is only faster.
+    void check_agrees(const std::string &source, const std::unordered_map<std::string, std::string> &values)
+    {
+        CHECK_EQ(render(source, values), app::update_string(source, values));
+    }
+
+    const test::registrar plain("response_template/plain_text", []
+                                {
+        CHECK_EQ(render("no placeholders", {}), std::string("no placeholders"));
+        CHECK(app::response_template("no placeholders").keys().empty()); });
+
+    const test::registrar fallbacks("response_template/fallback_group", []
+                                    {
+        CHECK_EQ(render("Hi ((nick | userName))!", {{"userName", "ketsuna"}}), std::string("Hi ketsuna!"));
+        CHECK_EQ(render("Hi ((nick|userName))!", {{"nick", "K"}, {"userName", "ketsuna"}}), std::string("Hi K!"));
+        CHECK_EQ(render("[((missing))]", {}), std::string("[]"));
+        app::response_template compiled("((a|b)) and ((c))");
+        CHECK_EQ(compiled.keys().size(), size_t(3)); });
+
+    const test::registrar empty_value("response_template/empty_value_is_set", []
+                                      {
+        app::key_values kv;
+        // A default-constructed view has a null data().
+        kv.set(app::intern_key("nick"), std::string_view{});
+        kv.set(app::intern_key("userName"), "ketsuna");
+        CHECK_EQ(app::response_template("[((nick|userName))]").render(kv), std::string("[]")); });
+
+    const test::registrar line_breaks("response_template/no_placeholder_across_lines", []
+                                      {
+        std::unordered_map<std::string, std::string> values{{"a", "A"}, {"b\nc", "X"}, {"b\rc", "Y"}};
+        check_agrees("((b\nc))", values);
+        check_agrees("((b\rc))", values);
+        check_agrees("line one ((a))\r\nline two ((\r\n((a))", values);
+        CHECK_EQ(render("((b\r\nc)) ((a))", values), std::string("((b\r\nc)) A")); });
+
+    const test::registrar agrees("response_template/agrees_with_update_string", []
+                                 {
+        std::unordered_map<std::string, std::string> values{{"userName", "ketsuna"}, {"opts.amount", "42"}, {"empty", ""}};
+        for (const char *source : {"", "((", "))", "(())", "((userName)", "(((userName)))", "((userName))((opts.amount))",
+                                   "((empty|userName))", "(( userName | x ))", "((|userName))", "((userName|))", "a ((b)) c"})
+        {
+            check_agrees(source, values);
+        } });
+}
@@ -0,0 +1,66 @@
+// test_update_sequencer.cpp
+// app::update_sequencer: config changes take effect in arrival order, whatever order they finish in.
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+#include "test.hpp"
+#include "../include/update_sequencer.hpp"
+
+namespace
+{
+    const test::registrar stale_replace("update_sequencer/older_replace_is_dropped", []
+                                        {
+        app::update_sequencer updates;
+        int table = 0;
+        auto large = updates.arrive();
+        auto small = updates.arrive();
+        // The later, smaller update finishes compiling first...
+        CHECK(updates.replace(small, [&table] { table = 2; }));
+        // ...and the older one must not overwrite it.
+        CHECK(!updates.replace(large, [&table] { table = 1; }));
+        CHECK_EQ(table, 2);
+        CHECK(updates.replace(updates.arrive(), [&table] { table = 3; }));
+        CHECK_EQ(table, 3); });
+
+    const test::registrar amend_waits("update_sequencer/amend_waits_for_earlier_bodies", []
+                                      {
+        app::update_sequencer updates;
+        int table = 0;
+        std::optional<app::update_sequencer::ticket> update = updates.arrive();
+        auto patch = updates.arrive();
+        std::atomic<bool> patched{false};
+        std::thread patching([&]
+                             {
+            updates.amend(patch, [&table] { table = table * 10 + 2; });
+            patched = true; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        // Still compiling the update that arrived first: the patch must not be based on the old table.
+        CHECK(!patched);
+        CHECK(updates.replace(*update, [&table] { table = 1; }));
+        update.reset();
+        patching.join();
+        CHECK_EQ(table, 12); });
+
+    const test::registrar amend_superseded("update_sequencer/amend_superseded_by_later_replace", []
+                                           {
+        app::update_sequencer updates;
+        int table = 0;
+        auto patch = updates.arrive();
+        auto update = updates.arrive();
+        CHECK(updates.replace(update, [&table] { table = 1; }));
+        // The full update that arrived after the patch already holds the newer config.
+        CHECK(!updates.amend(patch, [&table] { table = 2; }));
+        CHECK_EQ(table, 1); });
+
+    const test::registrar failed_body("update_sequencer/failed_body_releases_its_ticket", []
+                                      {
+        app::update_sequencer updates;
+        int table = 0;
+        {
+            // An update that fails to compile never publishes, but must not hold later patches back.
+            auto failed = updates.arrive();
+        }
+        CHECK(updates.amend(updates.arrive(), [&table] { table = 1; }));
+        CHECK_EQ(table, 1); });
+}